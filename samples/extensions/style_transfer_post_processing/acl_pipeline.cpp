@@ -18,29 +18,369 @@
 #include "acl_pipeline.h"
 #include <platform/filesystem.h>
 #include <platform/platform.h>
+#include <common/logging.h>
 #include "acl_utils/tflite_parser.h"
+#include "acl_utils/quantization_calibrator.h"
+#include "acl_utils/cl_program_cache.h"
+#include "acl_utils/graph_optimizer.h"
+#include "acl_utils/precompiled_network.h"
+#include <timer.h>
+#include <arm_compute/core/Utils.h>
+#include <arm_compute/runtime/CL/CLTuner.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <future>
+#include <limits>
 
-ACLPipeline::ACLPipeline(uint32_t width, uint32_t height, uint32_t channels)
+namespace
+{
+// Networks are created for each split row, so only a few of them are kept.
+const size_t MAX_SPLIT_NETWORKS = 4;
+
+// Image sizes whose networks are kept, apart from the current one.
+const size_t MAX_CACHED_NETWORKS = 3;
+
+// The split row moves in steps of this fraction of the image height.
+const uint32_t SPLIT_STEPS = 16;
+
+// Size of the blocks of pixels compared with the last frame when unchanged tiles are skipped.
+const uint32_t CHANGE_DETECTION_BLOCK_SIZE = 8;
+
+// Style of the pipeline when it's created, its model is nn_models/style_transfer.tflite.
+const char* DEFAULT_STYLE = "style_transfer";
+
+// Locks the image for CPU access while the object exists.
+class HardwareBufferLock
+{
+public:
+    explicit HardwareBufferLock(AHardwareBuffer* buffer) :
+        buffer(buffer)
+    {
+        AHardwareBuffer_Desc description{};
+        AHardwareBuffer_describe(buffer, &description);
+        int result = AHardwareBuffer_lock(buffer, AHARDWAREBUFFER_USAGE_CPU_READ_OFTEN | AHARDWAREBUFFER_USAGE_CPU_WRITE_OFTEN, -1, nullptr, &memory);
+        if(result != 0)
+        {
+            throw std::runtime_error("Cannot lock hardware buffer for CPU access. Error: " + std::to_string(result));
+        }
+        // The stride of the buffer is in pixels of the RGBA8 image.
+        row_pitch = static_cast<size_t>(description.stride) * 4;
+    }
+
+    ~HardwareBufferLock()
+    {
+        AHardwareBuffer_unlock(buffer, nullptr);
+    }
+
+    HardwareBufferLock(const HardwareBufferLock&) = delete;
+
+    uint8_t* get_row(uint32_t row) const
+    {
+        return static_cast<uint8_t*>(memory) + row * row_pitch;
+    }
+
+    size_t get_row_pitch() const
+    {
+        return row_pitch;
+    }
+
+private:
+    AHardwareBuffer* buffer;
+
+    void* memory{nullptr};
+
+    size_t row_pitch{0};
+};
+
+// The band tensor contains the image rows starting at band_start.
+uint8_t* get_band_row(const arm_compute::ITensor& band, uint32_t band_start, uint32_t row)
+{
+    const auto& info = *band.info();
+    return band.buffer() + info.offset_first_element_in_bytes() + (row - band_start) * info.strides_in_bytes()[2];
+}
+
+void read_image_rows(const HardwareBufferLock& image, arm_compute::ITensor& band, uint32_t band_start, uint32_t first_row, uint32_t row_count)
+{
+    size_t row_size = band.info()->dimension(0) * band.info()->dimension(1) * band.info()->element_size();
+    for(uint32_t row = first_row; row < first_row + row_count; row++)
+    {
+        memcpy(get_band_row(band, band_start, row), image.get_row(row), row_size);
+    }
+}
+
+void write_image_rows(const HardwareBufferLock& image, const arm_compute::ITensor& band, uint32_t band_start, uint32_t first_row, uint32_t row_count)
+{
+    size_t row_size = band.info()->dimension(0) * band.info()->dimension(1) * band.info()->element_size();
+    for(uint32_t row = first_row; row < first_row + row_count; row++)
+    {
+        memcpy(image.get_row(row), get_band_row(band, band_start, row), row_size);
+    }
+}
+
+uint32_t align_up(uint32_t value, uint32_t alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+// Start of each tile along one axis and its overlap with the previous tile. The last tile is moved to end at the image edge.
+std::vector<std::pair<uint32_t, uint32_t>> get_tile_starts(uint32_t image_size, uint32_t tile_size, uint32_t overlap)
+{
+    std::vector<std::pair<uint32_t, uint32_t>> starts{{0, 0}};
+    uint32_t end = tile_size;
+    while(end < image_size)
+    {
+        uint32_t start = std::min(end - overlap, image_size - tile_size);
+        starts.emplace_back(start, end - start);
+        end = start + tile_size;
+    }
+    return starts;
+}
+
+std::vector<uint8_t> read_tensor_memory(arm_compute::ITensor& tensor)
+{
+    std::vector<uint8_t> data(tensor.info()->total_size());
+    map_tensor(tensor);
+    memcpy(data.data(), tensor.buffer(), data.size());
+    unmap_tensor(tensor);
+    return data;
+}
+
+void write_tensor_memory(arm_compute::ITensor& tensor, const std::vector<uint8_t>& data)
+{
+    map_tensor(tensor);
+    memcpy(tensor.buffer(), data.data(), data.size());
+    unmap_tensor(tensor);
+}
+
+bool is_hardware_buffer_import_supported()
+{
+    auto extensions = arm_compute::CLKernelLibrary::get().get_device().getInfo<CL_DEVICE_EXTENSIONS>();
+    return extensions.find("cl_arm_import_memory_android_hardware_buffer") != std::string::npos;
+}
+
+// Tuned local work sizes depend on the device, the driver and the layers of the model.
+std::string get_tuning_file_path(size_t model_hash)
+{
+    const auto& device = arm_compute::CLKernelLibrary::get().get_device();
+    auto key = device.getInfo<CL_DEVICE_NAME>() + "_" + device.getInfo<CL_DRIVER_VERSION>() + "_" + std::to_string(model_hash);
+    return vkb::fs::path::get(vkb::fs::path::Type::Storage, "cl_tuner_" + std::to_string(std::hash<std::string>()(key)) + ".csv");
+}
+
+// The tuner lives as long as the scheduler it's attached to, so it's never detached. A new pipeline is created while the
+// previous one still exists, and with a tuner per pipeline the one destroyed last could detach the tuner of the other.
+struct AttachedTuner
+{
+    AttachedTuner()
+    {
+        arm_compute::CLScheduler::get().set_tuner(&tuner);
+    }
+
+    arm_compute::CLTuner tuner{false};
+};
+
+arm_compute::CLTuner& get_tuner()
+{
+    static AttachedTuner attached_tuner;
+    return attached_tuner.tuner;
+}
+
+// Convolution methods in the precompiled network are chosen for the backend, so each backend has its own file.
+std::string get_precompiled_network_name(const std::string& style, arm_compute::DataType data_type, const arm_compute::ITensorInfo& info, ACLNetwork::Backend backend)
+{
+    std::string precision = data_type == arm_compute::DataType::F32 ? "fp32" : (data_type == arm_compute::DataType::F16 ? "fp16" : "int8");
+    std::string batch = info.dimension(3) > 1 ? "_b" + std::to_string(info.dimension(3)) : "";
+    std::string suffix = backend == ACLNetwork::Backend::CPU ? "_cpu" : "";
+    return style + "_" + precision + "_" + std::to_string(info.dimension(1)) + "x" + std::to_string(info.dimension(2)) + batch + suffix + ".acln";
+}
+}        // namespace
+
+ACLPipeline::ACLPipeline(uint32_t width,
+                         uint32_t height,
+                         uint32_t channels,
+                         arm_compute::DataType data_type,
+                         TuningMode tuning_mode,
+                         uint32_t tile_width,
+                         uint32_t tile_height) :
+    width(width),
+    height(height),
+    channels(channels),
+    data_type(data_type)
 {
     arm_compute::CLScheduler::get().default_init();
     context = arm_compute::CLScheduler::get().context();
     queue = arm_compute::CLScheduler::get().queue();
 
-    input_tensor = std::make_unique<arm_compute::CLTensor>();
+    // Without the import extension the image memory is locked for CPU access for each run instead.
+    if(!is_hardware_buffer_import_supported())
+    {
+        LOGW("OpenCL device cannot import AHardwareBuffers, the network runs on the CPU.");
+        backend = ACLNetwork::Backend::CPU;
+    }
+    input_tensor = create_image_tensor(width, height);
+    shared_activations = std::make_shared<ACLNetwork::SharedActivations>(ACLNetwork::ActivationMemoryMode::Offset, backend);
+    active_style = DEFAULT_STYLE;
+    styles[active_style].name = active_style;
+    styles[active_style].shared_weights = std::make_shared<ACLNetwork::SharedWeights>(data_type, backend);
 
-    arm_compute::Strides strides(1, channels, width * channels);
-    arm_compute::CLTensor input;
-    arm_compute::TensorShape input_shape(3, width, height);
-    arm_compute::QuantizationInfo quantization_info(1.0f / 1.0f, 0);
-    arm_compute::TensorInfo tensor_info;
-    size_t total_size = width * height * channels;
-    tensor_info.init(input_shape, 1, arm_compute::DataType::QASYMM8, strides, 0, total_size);
-    tensor_info.set_quantization_info(quantization_info);
-    tensor_info.set_data_layout(arm_compute::DataLayout::NHWC);
-    input_tensor->allocator()->init(tensor_info);
+    if(tile_width != 0 && tile_height != 0)
+    {
+        if(backend == ACLNetwork::Backend::CL)
+        {
+            configure_tiles(tile_width, tile_height);
+        }
+        else
+        {
+            LOGW("Tiled inference requires the GPU, the whole image is processed at once.");
+        }
+    }
+
+    // Compiling the kernels takes most of the time needed to create the network, so the built programs are cached.
+    vkb::Timer startup_timer;
+    startup_timer.start();
+    auto program_cache_path = vkb::fs::path::get(vkb::fs::path::Type::Storage, "cl_program_cache.bin");
+    auto restored_programs = CLProgramCache::restore(program_cache_path);
+
+    // The tuner is attached before the first network is created, so that the kernels of all the networks created later (e.g. for
+    // other sizes, styles, split rows or batches) get the tuned local work sizes when they are enqueued. Only apply_tuning() tunes
+    // new kernels, otherwise the tuner just looks up the stored results.
+    if(backend == ACLNetwork::Backend::CL)
+    {
+        get_tuner();
+    }
+    if(tile_tensor)
+    {
+        net = create_network(get_active_style(), *tile_tensor, data_type, ACLNetwork::ActivationMemoryMode::Offset);
+    }
+    else
+    {
+        net = create_network(get_active_style(), *input_tensor, data_type, ACLNetwork::ActivationMemoryMode::Offset);
+    }
+
+    // Weights are reshaped only once here, so that each frame only enqueues the kernels.
+    net->prepare();
+
+    if(backend == ACLNetwork::Backend::CL)
+    {
+        apply_tuning(tuning_mode);
+    }
+
+    auto built_programs = arm_compute::CLKernelLibrary::get().get_built_programs().size();
+    get_active_style().load_milliseconds = static_cast<float>(startup_timer.stop<vkb::Timer::Milliseconds>());
+    LOGI("Network created in {:.2f} ms, {} of {} OpenCL programs restored from the cache",
+         get_active_style().load_milliseconds, restored_programs, built_programs);
+    if(built_programs > restored_programs)
+    {
+        CLProgramCache::save(program_cache_path);
+    }
+}
+
+ACLPipeline::~ACLPipeline()
+{
+    // Callbacks of the batch events write to the promises of the batches.
+    for(auto& batch : dispatched_batches)
+    {
+        batch.end_time.wait();
+    }
+
+    // Networks for a split are created on a background thread which uses the pipeline.
+    if(split_networks_loading.valid())
+    {
+        split_networks_loading.wait();
+    }
+}
+
+void ACLPipeline::apply_tuning(TuningMode tuning_mode)
+{
+    auto& tuner = get_tuner();
+    auto tuning_file = get_tuning_file_path(get_active_style().model_hash);
+    if(tuning_mode == TuningMode::Disabled)
+    {
+        if(vkb::fs::is_file(tuning_file))
+        {
+            tuner.load_from_file(tuning_file);
+            LOGI("Loaded local work sizes of {} kernels from {}", tuner.tuning_params_table().size(), tuning_file);
+        }
+        return;
+    }
+
+    // The network runs on its own input tensor, which doesn't need any memory imported for that.
+    arm_compute::CLTensor tuning_image;
+    tuning_image.allocator()->init(*input_tensor->info());
+    tuning_image.allocator()->allocate();
+    auto& cl_input_tensor = static_cast<arm_compute::CLTensor&>(*input_tensor);
+    cl_input_tensor.allocator()->import_memory(tuning_image.cl_buffer());
+
+    const uint32_t profiling_iterations = 10;
+    net->run();
+    auto default_times = net->profile_layers(profiling_iterations);
+
+    switch(tuning_mode)
+    {
+        case TuningMode::Rapid:
+            tuner.set_tuner_mode(arm_compute::CLTunerMode::RAPID);
+            break;
+        case TuningMode::Normal:
+            tuner.set_tuner_mode(arm_compute::CLTunerMode::NORMAL);
+            break;
+        default:
+            tuner.set_tuner_mode(arm_compute::CLTunerMode::EXHAUSTIVE);
+            break;
+    }
+    tuner.set_tune_new_kernels(true);
+    net->run();
+    arm_compute::CLScheduler::get().sync();
+    tuner.set_tune_new_kernels(false);
+    auto tuned_times = net->profile_layers(profiling_iterations);
+
+    double total_default_time = 0.0;
+    double total_tuned_time = 0.0;
+    for(size_t i = 0; i < tuned_times.size(); i++)
+    {
+        LOGI("{}: {:.3f} ms -> {:.3f} ms ({:.2f}x)",
+             tuned_times[i].name, default_times[i].milliseconds, tuned_times[i].milliseconds, default_times[i].milliseconds / tuned_times[i].milliseconds);
+        total_default_time += default_times[i].milliseconds;
+        total_tuned_time += tuned_times[i].milliseconds;
+    }
+    LOGI("Tuned {} kernels, network time: {:.3f} ms -> {:.3f} ms ({:.2f}x)",
+         tuner.tuning_params_table().size(), total_default_time, total_tuned_time, total_default_time / total_tuned_time);
+
+    if(!tuner.save_to_file(tuning_file))
+    {
+        LOGW("Cannot save tuned local work sizes to {}", tuning_file);
+    }
+
+    compare_cpu_latency(tuned_times);
+    cl_input_tensor.allocator()->free();
+}
+
+void ACLPipeline::compare_cpu_latency(const std::vector<ACLNetwork::LayerTime>& gpu_times)
+{
+    // The CPU network is created from the same graph, so its layers match the layers of the GPU network.
+    arm_compute::Tensor cpu_image;
+    cpu_image.allocator()->init(get_network_info());
+    cpu_image.allocator()->allocate();
+    auto cpu_net = create_network(get_active_style(), cpu_image, data_type, ACLNetwork::ActivationMemoryMode::Offset);
+    cpu_net->prepare();
+    cpu_net->run();
+
+    const uint32_t profiling_iterations = 3;
+    auto cpu_times = cpu_net->profile_layers(profiling_iterations);
+    if(cpu_times.size() != gpu_times.size())
+    {
+        LOGW("CPU network has {} layers, GPU network has {}, layer times are not compared", cpu_times.size(), gpu_times.size());
+        return;
+    }
 
-    auto model_data = vkb::fs::read_asset("nn_models/style_transfer.tflite");
-    net = TFLiteParser::parse_model(model_data, *input_tensor);
+    double total_cpu_time = 0.0;
+    double total_gpu_time = 0.0;
+    for(size_t i = 0; i < cpu_times.size(); i++)
+    {
+        LOGI("{}: GPU {:.3f} ms, CPU {:.3f} ms", gpu_times[i].name, gpu_times[i].milliseconds, cpu_times[i].milliseconds);
+        total_cpu_time += cpu_times[i].milliseconds;
+        total_gpu_time += gpu_times[i].milliseconds;
+    }
+    LOGI("Network time: GPU {:.3f} ms, CPU {:.3f} ms", total_gpu_time, total_cpu_time);
 }
 
 cl_mem import_hardware_buffer_to_opencl(cl_context context, AHardwareBuffer* hardware_buffer)
@@ -61,22 +401,1264 @@ cl_mem import_hardware_buffer_to_opencl(cl_context context, AHardwareBuffer* har
     return imported_memory;
 }
 
+ACLPipeline::Style& ACLPipeline::get_active_style()
+{
+    return styles.at(active_style);
+}
+
+std::unique_ptr<ACLNetwork> ACLPipeline::create_network(Style& style,
+                                                        const arm_compute::ITensor& input_output_tensor,
+                                                        arm_compute::DataType network_data_type,
+                                                        ACLNetwork::ActivationMemoryMode memory_mode)
+{
+    std::lock_guard<std::recursive_mutex> build_lock(CLProgramCache::get_build_mutex());
+    vkb::Timer load_timer;
+    load_timer.start();
+
+    // Networks exported on another device can be shipped in assets, the ones exported on this device are in storage.
+    // Networks of the pipeline share the weights of the style and the activation memory, the others (e.g. the F32 reference
+    // or the CPU network) have their own. Batch networks have their own activation memory too, so the shared pool doesn't keep
+    // the size of a batch after the batch network is released.
+    auto network_backend = ACLNetwork::get_tensor_backend(input_output_tensor);
+    bool is_pipeline_network = network_backend == backend && network_data_type == data_type;
+    bool is_batch_network = input_output_tensor.info()->dimension(3) > 1;
+    auto weights = is_pipeline_network ? style.shared_weights : nullptr;
+    auto activations = is_pipeline_network && !is_batch_network && memory_mode == shared_activations->memory_mode ? shared_activations : nullptr;
+
+    // A precompiled network exported from another version of the model (e.g. after an update of the app) is exported again.
+    const auto& source = get_model(style);
+    auto name = get_precompiled_network_name(style.name, network_data_type, *input_output_tensor.info(), network_backend);
+    auto assets_path = vkb::fs::path::get(vkb::fs::path::Type::Assets) + "nn_models/" + name;
+    for(const auto& path : {assets_path, vkb::fs::path::get(vkb::fs::path::Type::Storage, name)})
+    {
+        if(!vkb::fs::is_file(path))
+        {
+            continue;
+        }
+        ModelFile file(path);
+        if(!PrecompiledNetwork::is_compatible(file, *input_output_tensor.info()) ||
+           PrecompiledNetwork::get_data_type(file) != network_data_type)
+        {
+            LOGW("Precompiled network {} doesn't match the pipeline, ignoring it", path);
+            continue;
+        }
+        if(PrecompiledNetwork::get_source_hash(file) != style.model_hash)
+        {
+            LOGW("Precompiled network {} was exported from another version of {}.tflite, ignoring it", path, style.name);
+            continue;
+        }
+
+        // Networks in assets were exported on another device, so their layers are validated on this one.
+        try
+        {
+            auto network = PrecompiledNetwork::load(file, input_output_tensor, memory_mode, weights, path == assets_path);
+            network->set_shared_activations(activations);
+            LOGI("Precompiled network ({} bytes) loaded in {:.2f} ms", file.size(), load_timer.stop<vkb::Timer::Milliseconds>());
+            return network;
+        }
+        catch(const std::exception& e)
+        {
+            LOGW("Cannot load precompiled network {}: {}", path, e.what());
+        }
+    }
+
+    TFLiteParser::QuantizationTable quantization;
+    if(arm_compute::is_data_type_quantized(network_data_type))
+    {
+        quantization = load_quantization(style);
+    }
+
+    // Weights and biases are stored as F32 in the model, they are converted to the network data type when they are copied to the tensors.
+    auto graph = TFLiteParser::parse_graph(source, *input_output_tensor.info(), network_data_type, quantization);
+    GraphOptimizer::optimize(graph);
+    auto network = graph.create_network(input_output_tensor, network_data_type, memory_mode, true, weights);
+    network->set_shared_activations(activations);
+    LOGI("Model ({} bytes) loaded in {:.2f} ms", source.size(), load_timer.stop<vkb::Timer::Milliseconds>());
+
+    PrecompiledNetwork::save(graph, *network, *input_output_tensor.info(), style.model_hash, vkb::fs::path::get(vkb::fs::path::Type::Storage, name));
+    return network;
+}
+
+const ModelFile& ACLPipeline::get_model(Style& style)
+{
+    // The model is mapped instead of read, the weights are copied from the mapped file directly to the tensors.
+    if(!style.model)
+    {
+        style.model = std::make_unique<ModelFile>(vkb::fs::path::get(vkb::fs::path::Type::Assets) + "nn_models/" + style.name + ".tflite");
+        style.model_hash = style.model->get_hash();
+    }
+    return *style.model;
+}
+
+TFLiteParser::QuantizationTable ACLPipeline::load_quantization(Style& style)
+{
+    TFLiteParser::QuantizationTable quantization;
+    auto table_path = vkb::fs::path::get(vkb::fs::path::Type::Storage, style.name + "_quantization.txt");
+    get_model(style);
+    if(QuantizationCalibrator::load_table(quantization, style.model_hash, table_path))
+    {
+        LOGI("Loaded quantization table from {}", table_path);
+        return quantization;
+    }
+
+    // Calibration is slow, so it's done only once and the result is stored.
+    auto calibration_directory = vkb::fs::path::get(vkb::fs::path::Type::Storage) + "calibration/";
+    auto image_paths = QuantizationCalibrator::find_images(calibration_directory);
+    if(image_paths.empty())
+    {
+        throw std::runtime_error("INT8 inference requires calibration images (e.g. network/dataset/x) in " + calibration_directory);
+    }
+
+    quantization = QuantizationCalibrator::calibrate(get_model(style), get_network_info(), image_paths);
+    QuantizationCalibrator::save_table(quantization, style.model_hash, table_path);
+    return quantization;
+}
+
+void ACLPipeline::prepare(const std::vector<AHardwareBuffer*>& image_buffers)
+{
+    if(backend == ACLNetwork::Backend::CPU)
+    {
+        return;
+    }
+
+    for(auto* image_buffer : image_buffers)
+    {
+        if(imported_buffers.count(image_buffer) == 0)
+        {
+            // The cl::Buffer takes the ownership of the imported memory and releases it when destroyed.
+            imported_buffers.emplace(image_buffer, cl::Buffer(import_hardware_buffer_to_opencl(context.get(), image_buffer)));
+        }
+    }
+}
+
 void ACLPipeline::run(AHardwareBuffer* image_buffer, const VkExtent3D& extent)
 {
-    // First we import AHardwareBuffer into OpenCL using clImportMemoryARM.
-    auto imported_memory = import_hardware_buffer_to_opencl(context.get(), image_buffer);
-    cl::Buffer input_buffer(imported_memory);
+    run_async(image_buffer, extent).wait();
+}
 
-    // Then we can specify imported OpenCL memory as memory for an ACL tensor.
-    auto status = input_tensor->allocator()->import_memory(input_buffer);
-    if(!status)
+cl::Event ACLPipeline::run_async(AHardwareBuffer* image_buffer, const VkExtent3D& extent)
+{
+    // Styles are switched between the runs, so the whole frame is processed with the same style.
+    update_styles();
+    update_style_blend();
+    update_split_networks();
+
+    if(backend == ACLNetwork::Backend::CPU)
     {
-        throw std::runtime_error("Failed to import CLTensor memory, Error: " + status.error_description());
+        // The CPU network is finished when run() returns, so the event is complete already.
+        run_on_cpu(image_buffer);
+        cl::UserEvent event(context);
+        event.setStatus(CL_COMPLETE);
+        return event;
     }
 
-    net->run();
+    // The F32 reference network has only the weights of the active style.
+    bool blending = &get_running_network() != net.get();
+    if(psnr_requested && blending)
+    {
+        LOGW("PSNR is not measured while the styles are blended");
+        psnr_requested = false;
+    }
+
+    // PSNR is measured on the whole frame, so the frame that measures it is not split.
+    // Only the network that blends the styles has the blended weights, so blended frames are not split either.
+    auto* networks = split_execution && !psnr_requested && !blending ? get_split_networks() : nullptr;
+    if(networks)
+    {
+        run_split(image_buffer, *networks);
+        cl::UserEvent event(context);
+        event.setStatus(CL_COMPLETE);
+        return event;
+    }
+
+    if(image_buffer != current_image_buffer)
+    {
+        // The imported OpenCL memory is specified as memory for the input ACL tensor.
+        // Kernels read the memory of the tensor when they are enqueued, so the memory can be switched without reconfiguring the network.
+        auto status = static_cast<arm_compute::CLTensor&>(*input_tensor).allocator()->import_memory(get_imported_buffer(image_buffer));
+        if(!status)
+        {
+            throw std::runtime_error("Failed to import CLTensor memory, Error: " + status.error_description());
+        }
+        current_image_buffer = image_buffer;
+    }
+
+    if(psnr_requested)
+    {
+        psnr_requested = false;
+        psnr = measure_psnr();
+        LOGI("PSNR of {} network output against F32 network: {:.2f} dB", arm_compute::string_from_data_type(data_type), psnr);
+    }
+    else
+    {
+        run_network();
+    }
 
+    auto event = arm_compute::CLScheduler::get().enqueue_sync_event();
     arm_compute::CLScheduler::get().queue().flush();
-    arm_compute::CLScheduler::get().queue().finish();
+    return event;
+}
+
+bool ACLPipeline::is_tiled() const
+{
+    return tile_tensor != nullptr;
+}
+
+void ACLPipeline::configure_tiles(uint32_t tile_width, uint32_t tile_height)
+{
+    requested_tile_width = tile_width;
+    requested_tile_height = tile_height;
+    tile_tensor = create_tile_tensor(*input_tensor->info(), tile_overlap);
+    place_tiles();
+}
+
+std::unique_ptr<arm_compute::CLTensor> ACLPipeline::create_tile_tensor(const arm_compute::ITensorInfo& image_info, uint32_t& overlap)
+{
+    // Kernels of the model are square, so the receptive field is the same in both directions.
+    auto graph = TFLiteParser::parse_graph(get_model(get_active_style()), image_info);
+    uint32_t downsampling = graph.get_vertical_downsampling();
+    uint32_t tile_width = std::min(requested_tile_width, static_cast<uint32_t>(image_info.dimension(1))) / downsampling * downsampling;
+    uint32_t tile_height = std::min(requested_tile_height, static_cast<uint32_t>(image_info.dimension(2))) / downsampling * downsampling;
+    if(tile_width == 0 || tile_height == 0)
+    {
+        throw std::runtime_error("Tiles must be at least " + std::to_string(downsampling) + " pixels wide and high");
+    }
+
+    overlap = graph.get_receptive_field_rows();
+    if(overlap * 2 > std::min(tile_width, tile_height))
+    {
+        overlap = std::min(tile_width, tile_height) / 2;
+        LOGW("Tiles are smaller than the receptive field of the network, their overlap is limited to {} pixels", overlap);
+    }
+
+    arm_compute::TensorInfo tile_info(image_info);
+    tile_info.set_tensor_shape(arm_compute::TensorShape(channels, tile_width, tile_height));
+    auto tensor = std::make_unique<arm_compute::CLTensor>();
+    tensor->allocator()->init(tile_info);
+    tensor->allocator()->allocate();
+    return tensor;
+}
+
+void ACLPipeline::place_tiles()
+{
+    // The tile tensor is never larger than the image, see create_tile_tensor().
+    const auto& tile_info = *tile_tensor->info();
+    auto tile_width = static_cast<uint32_t>(tile_info.dimension(1));
+    auto tile_height = static_cast<uint32_t>(tile_info.dimension(2));
+
+    tiles.clear();
+    for(const auto& row : get_tile_starts(height, tile_height, tile_overlap))
+    {
+        for(const auto& column : get_tile_starts(width, tile_width, tile_overlap))
+        {
+            tiles.push_back({column.first, row.first, column.second, row.second});
+        }
+    }
+
+    source_image.allocator()->free();
+    source_image.allocator()->init(*input_tensor->info());
+    source_image.allocator()->allocate();
+
+    tile_blending.configure(tile_tensor.get(), static_cast<arm_compute::CLTensor*>(input_tensor.get()));
+    if(skip_unchanged_tiles)
+    {
+        configure_tile_cache();
+    }
+    LOGI("{}x{} image is processed in {} tiles of {}x{} with {} pixels of overlap", width, height, tiles.size(), tile_width, tile_height, tile_overlap);
+}
+
+void ACLPipeline::configure_tile_cache()
+{
+    previous_source_image.allocator()->free();
+    previous_source_image.allocator()->init(*source_image.info());
+    previous_source_image.allocator()->allocate();
+    change_detection.configure(&source_image, &previous_source_image, CHANGE_DETECTION_BLOCK_SIZE);
+
+    tile_output_cache = cl::Buffer(context, CL_MEM_READ_WRITE, tiles.size() * tile_tensor->info()->total_size());
+    tile_cache_valid = false;
+}
+
+void ACLPipeline::set_skip_unchanged_tiles(bool enabled)
+{
+    if(enabled && !tile_tensor)
+    {
+        LOGW("Unchanged tiles can be skipped only in tiled mode");
+        return;
+    }
+    if(enabled == skip_unchanged_tiles)
+    {
+        return;
+    }
+
+    if(enabled)
+    {
+        configure_tile_cache();
+    }
+    else
+    {
+        previous_source_image.allocator()->free();
+        tile_output_cache = cl::Buffer();
+        skipped_tile_ratio = 0.0f;
+    }
+    skip_unchanged_tiles = enabled;
+}
+
+bool ACLPipeline::is_skipping_unchanged_tiles() const
+{
+    return skip_unchanged_tiles;
 }
 
+float ACLPipeline::get_skipped_tile_ratio() const
+{
+    return skipped_tile_ratio;
+}
+
+std::unique_ptr<arm_compute::ITensor> ACLPipeline::create_image_tensor(uint32_t image_width, uint32_t image_height) const
+{
+    std::unique_ptr<arm_compute::ITensor> tensor;
+    if(backend == ACLNetwork::Backend::CL)
+    {
+        tensor = std::make_unique<arm_compute::CLTensor>();
+    }
+    else
+    {
+        tensor = std::make_unique<arm_compute::Tensor>();
+    }
+
+    // The tensor covers the whole RGBA8 image, the network reads and writes only the color channels.
+    arm_compute::TensorShape input_shape(channels, image_width, image_height);
+    arm_compute::QuantizationInfo quantization_info(1.0f / 1.0f, 0);
+    arm_compute::TensorInfo tensor_info(input_shape, 1, arm_compute::DataType::QASYMM8, quantization_info);
+    tensor_info.set_data_layout(arm_compute::DataLayout::NHWC);
+    get_tensor_allocator(*tensor).init(tensor_info);
+    return tensor;
+}
+
+void ACLPipeline::set_resolution(uint32_t new_width, uint32_t new_height)
+{
+    if(new_width == width && new_height == height)
+    {
+        return;
+    }
+
+    vkb::Timer switch_timer;
+    switch_timer.start();
+
+    // Styles that are loading use the current input tensor, so they are finished first.
+    for(auto& style : styles)
+    {
+        if(style.second.loading.valid())
+        {
+            style.second.loading.wait();
+        }
+    }
+    update_styles();
+
+    // Submitted frames have the previous size.
+    flush();
+
+    // The imported memory and the split networks belong to the previous size.
+    net->sync();
+    imported_buffers.clear();
+    current_image_buffer = nullptr;
+    discard_split_networks();
+
+    // The new tensors and networks are created first, so the pipeline keeps the previous size if that fails.
+    auto new_input_tensor = create_image_tensor(new_width, new_height);
+    std::unique_ptr<arm_compute::CLTensor> new_tile_tensor;
+    uint32_t new_tile_overlap = tile_overlap;
+    std::unique_ptr<ACLNetwork> new_net;
+    auto cached = cached_networks.end();
+    if(tile_tensor)
+    {
+        // The network processes tiles, so it's created again only when the tiles of the new size are smaller or larger.
+        new_tile_tensor = create_tile_tensor(*new_input_tensor->info(), new_tile_overlap);
+        if(new_tile_tensor->info()->tensor_shape() == tile_tensor->info()->tensor_shape())
+        {
+            new_tile_tensor.reset();
+        }
+        else
+        {
+            new_net = create_network(get_active_style(), *new_tile_tensor, data_type, ACLNetwork::ActivationMemoryMode::Offset);
+            new_net->prepare();
+        }
+    }
+    else
+    {
+        cached = std::find_if(cached_networks.begin(), cached_networks.end(), [&](const CachedNetwork& network)
+        {
+            return network.width == new_width && network.height == new_height;
+        });
+        if(cached == cached_networks.end())
+        {
+            new_net = create_network(get_active_style(), *new_input_tensor, data_type, ACLNetwork::ActivationMemoryMode::Offset);
+            new_net->prepare();
+        }
+    }
+
+    split_balancer.reset();
+    psnr = -1.0f;
+    uint32_t previous_width = width;
+    uint32_t previous_height = height;
+    width = new_width;
+    height = new_height;
+
+    if(tile_tensor && !new_net)
+    {
+        input_tensor = std::move(new_input_tensor);
+        place_tiles();
+        LOGI("Switched to {}x{} in {:.2f} ms", width, height, switch_timer.stop<vkb::Timer::Milliseconds>());
+        return;
+    }
+
+    // Networks of the inactive styles run on the input tensor of the previous size, they are loaded again when selected.
+    // The network that blends the styles is created again in the next run.
+    for(auto& style : styles)
+    {
+        style.second.net.reset();
+    }
+    blend_net.reset();
+    batch_net.reset();
+    batch_tensor.reset();
+
+    bool was_cached = !tile_tensor && !new_net;
+    if(tile_tensor)
+    {
+        // The network refers to the tile tensor, so it's replaced first.
+        net = std::move(new_net);
+        tile_tensor = std::move(new_tile_tensor);
+        tile_overlap = new_tile_overlap;
+        input_tensor = std::move(new_input_tensor);
+        place_tiles();
+    }
+    else if(was_cached)
+    {
+        cached_networks.push_front({previous_width, previous_height, std::move(input_tensor), std::move(net)});
+        input_tensor = std::move(cached->input_tensor);
+        net = std::move(cached->net);
+        cached_networks.erase(cached);
+    }
+    else
+    {
+        cached_networks.push_front({previous_width, previous_height, std::move(input_tensor), std::move(net)});
+        input_tensor = std::move(new_input_tensor);
+        net = std::move(new_net);
+    }
+
+    while(cached_networks.size() > MAX_CACHED_NETWORKS)
+    {
+        cached_networks.pop_back();
+    }
+
+    if(!pending_style.empty())
+    {
+        load_style(pending_style);
+    }
+
+    if(batch_size > 1)
+    {
+        create_batch_network();
+    }
+
+    if(split_execution)
+    {
+        set_split_execution(true);
+    }
+    LOGI("Switched to {}x{} in {:.2f} ms{}", width, height, switch_timer.stop<vkb::Timer::Milliseconds>(), was_cached ? ", using the cached network" : "");
+}
+
+void ACLPipeline::load_style(const std::string& name)
+{
+    auto& style = styles[name];
+    if(name == active_style || style.net || style.loading.valid())
+    {
+        return;
+    }
+    style.name = name;
+    if(!style.shared_weights)
+    {
+        style.shared_weights = std::make_shared<ACLNetwork::SharedWeights>(data_type, backend);
+    }
+
+    // The tensor is replaced only in set_resolution(), which waits for the loading styles.
+    // The background thread uses only the style and the members that don't change while the pipeline exists.
+    // It only creates the network, the weights are uploaded and prepared on the render thread in update_styles(),
+    // so that the queue isn't used by two threads.
+    const arm_compute::ITensor& network_tensor = tile_tensor ? *tile_tensor : *input_tensor;
+    style.loading = std::async(std::launch::async, [this, &style, &network_tensor]() {
+        vkb::Timer load_timer;
+        load_timer.start();
+        auto network = create_network(style, network_tensor, data_type, ACLNetwork::ActivationMemoryMode::Offset);
+        style.load_milliseconds = static_cast<float>(load_timer.stop<vkb::Timer::Milliseconds>());
+        return network;
+    });
+}
+
+void ACLPipeline::set_style(const std::string& name)
+{
+    if(name == active_style)
+    {
+        pending_style.clear();
+        return;
+    }
+    load_style(name);
+    pending_style = name;
+}
+
+const std::string& ACLPipeline::get_style() const
+{
+    return active_style;
+}
+
+std::vector<ACLPipeline::StyleInfo> ACLPipeline::get_styles() const
+{
+    std::vector<StyleInfo> infos;
+    for(const auto& style : styles)
+    {
+        const auto* network = style.first == active_style ? net.get() : style.second.net.get();
+        // The load time is written by the background thread, so it's read only once the style is loaded.
+        bool loading = style.second.loading.valid();
+        infos.push_back({style.first, network != nullptr, loading, loading ? 0.0f : style.second.load_milliseconds,
+                         network ? network->get_weights_memory_size() : 0});
+    }
+    return infos;
+}
+
+void ACLPipeline::set_style_memory_budget(size_t bytes)
+{
+    style_memory_budget = bytes;
+    apply_style_memory_budget();
+}
+
+float ACLPipeline::get_style_switch_milliseconds() const
+{
+    return style_switch_time;
+}
+
+void ACLPipeline::update_styles()
+{
+    bool loaded = false;
+    for(auto& style : styles)
+    {
+        auto& loading = style.second.loading;
+        if(!loading.valid() || loading.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+        {
+            continue;
+        }
+        try
+        {
+            vkb::Timer prepare_timer;
+            prepare_timer.start();
+            auto network = loading.get();
+            network->prepare();
+            style.second.load_milliseconds += static_cast<float>(prepare_timer.stop<vkb::Timer::Milliseconds>());
+            style.second.net = std::move(network);
+            loaded = true;
+            LOGI("Style {} loaded in {:.2f} ms, {} bytes of weights", style.first, style.second.load_milliseconds,
+                 style.second.net->get_weights_memory_size());
+        }
+        catch(const std::exception& e)
+        {
+            LOGE("Cannot load style {}: {}", style.first, e.what());
+            if(pending_style == style.first)
+            {
+                pending_style.clear();
+            }
+        }
+    }
+
+    if(!pending_style.empty() && styles.at(pending_style).net)
+    {
+        switch_style(pending_style);
+    }
+    else if(loaded)
+    {
+        apply_style_memory_budget();
+    }
+}
+
+void ACLPipeline::switch_style(const std::string& name)
+{
+    vkb::Timer switch_timer;
+    switch_timer.start();
+
+    auto& previous = get_active_style();
+    auto& style = styles.at(name);
+    previous.net = std::move(net);
+    previous.last_used = ++style_use_count;
+    net = std::move(style.net);
+    active_style = name;
+    pending_style.clear();
+
+    // Networks of the other sizes and of the split rows, and the cached tiles were created with the previous style.
+    cached_networks.clear();
+    discard_split_networks();
+    tile_cache_valid = false;
+    psnr = -1.0f;
+
+    // The blended network has the weights of the previous style, it's created again for the new one in the next run.
+    // The network of the batches is created again when the next batch is dispatched.
+    blend_net.reset();
+    batch_net.reset();
+
+    style_switch_time = static_cast<float>(switch_timer.stop<vkb::Timer::Milliseconds>());
+    LOGI("Switched to style {} in {:.2f} ms", active_style, style_switch_time);
+    apply_style_memory_budget();
+}
+
+void ACLPipeline::apply_style_memory_budget()
+{
+    if(style_memory_budget == 0)
+    {
+        return;
+    }
+
+    size_t resident_size = 0;
+    for(const auto& info : get_styles())
+    {
+        resident_size += info.weights_memory_size;
+    }
+
+    while(resident_size > style_memory_budget)
+    {
+        Style* least_recently_used = nullptr;
+        for(auto& style : styles)
+        {
+            if(style.second.net && style.first != pending_style &&
+               (!least_recently_used || style.second.last_used < least_recently_used->last_used))
+            {
+                least_recently_used = &style.second;
+            }
+        }
+        if(!least_recently_used)
+        {
+            LOGW("Weights of the active and the requested style ({} bytes) don't fit the style memory budget of {} bytes", resident_size, style_memory_budget);
+            return;
+        }
+
+        LOGI("Style {} released to fit the memory budget, {} bytes of weights", least_recently_used->name, least_recently_used->net->get_weights_memory_size());
+        resident_size -= least_recently_used->net->get_weights_memory_size();
+        least_recently_used->net.reset();
+        least_recently_used->shared_weights.reset();
+        least_recently_used->model.reset();
+    }
+}
+
+void ACLPipeline::set_style_blend(const std::string& name, float factor)
+{
+    if(!name.empty() && (backend != ACLNetwork::Backend::CL || arm_compute::is_data_type_quantized(data_type)))
+    {
+        LOGW("Styles can be blended only by F32 and F16 networks on the GPU");
+        return;
+    }
+
+    factor = std::min(std::max(factor, 0.0f), 1.0f);
+    if(name == blend_style && factor == blend_factor)
+    {
+        return;
+    }
+    if(name != blend_style)
+    {
+        blend_net.reset();
+        blend_style = name;
+    }
+    blend_factor = factor;
+
+    // Outputs of the cached tiles were produced with other weights.
+    tile_cache_valid = false;
+}
+
+const std::string& ACLPipeline::get_style_blend() const
+{
+    return blend_style;
+}
+
+float ACLPipeline::get_style_blend_factor() const
+{
+    return blend_factor;
+}
+
+void ACLPipeline::update_style_blend()
+{
+    if(blend_style.empty() || blend_style == active_style || blend_factor == 0.0f)
+    {
+        return;
+    }
+
+    if(!blend_net)
+    {
+        vkb::Timer create_timer;
+        create_timer.start();
+        try
+        {
+            // The model of a style that is loading is mapped by the background thread.
+            auto& second_style = styles[blend_style];
+            second_style.name = blend_style;
+            if(second_style.loading.valid())
+            {
+                second_style.loading.wait();
+            }
+
+            // Both graphs go through the same passes, so their nodes match when the models have the same architecture.
+            std::lock_guard<std::recursive_mutex> build_lock(CLProgramCache::get_build_mutex());
+            const arm_compute::ITensor& network_tensor = tile_tensor ? *tile_tensor : *input_tensor;
+            auto graph = TFLiteParser::parse_graph(get_model(get_active_style()), *network_tensor.info(), data_type);
+            GraphOptimizer::optimize(graph);
+            auto second_graph = TFLiteParser::parse_graph(get_model(second_style), *network_tensor.info(), data_type);
+            GraphOptimizer::optimize(second_graph);
+            blend_net = graph.create_blended_network(network_tensor, data_type, ACLNetwork::ActivationMemoryMode::Offset, second_graph);
+            blend_net->set_shared_activations(shared_activations);
+            blend_net->prepare();
+        }
+        catch(const std::exception& e)
+        {
+            LOGE("Cannot blend style {} with {}: {}", active_style, blend_style, e.what());
+            blend_net.reset();
+            blend_style.clear();
+            return;
+        }
+        LOGI("Network blending style {} with {} created in {:.2f} ms, {} bytes of weights", active_style, blend_style,
+             create_timer.stop<vkb::Timer::Milliseconds>(), blend_net->get_weights_memory_size());
+    }
+
+    blend_net->set_blend_factor(blend_factor);
+}
+
+ACLNetwork& ACLPipeline::get_running_network()
+{
+    return blend_net && blend_factor > 0.0f ? *blend_net : *net;
+}
+
+void ACLPipeline::set_batch_size(uint32_t new_batch_size, float max_latency_ms)
+{
+    new_batch_size = std::max(new_batch_size, 1u);
+    batch_max_latency = max_latency_ms;
+    if(new_batch_size == batch_size)
+    {
+        return;
+    }
+    if(new_batch_size > 1 && (backend != ACLNetwork::Backend::CL || tile_tensor))
+    {
+        throw std::runtime_error("Batched mode requires the CL backend and cannot be used in tiled mode.");
+    }
+
+    // Frames submitted with the previous batch size are processed by its network.
+    flush();
+    for(const auto& throughput : get_batch_throughput())
+    {
+        LOGI("Batch size {}: {} frames, {:.1f} FPS", throughput.batch_size, throughput.frames, throughput.frames_per_second);
+    }
+
+    batch_net.reset();
+    batch_tensor.reset();
+    batch_size = new_batch_size;
+    if(batch_size > 1)
+    {
+        create_batch_network();
+    }
+}
+
+uint32_t ACLPipeline::get_batch_size() const
+{
+    return batch_size;
+}
+
+void ACLPipeline::submit(AHardwareBuffer* frame)
+{
+    if(!batch_tensor)
+    {
+        throw std::runtime_error("Frames can be submitted only in batched mode, see ACLPipeline::set_batch_size().");
+    }
+    if(batch_frames.empty())
+    {
+        batch_start = Clock::now();
+    }
+
+    // The copy is enqueued after the previous batch is copied back from the same images.
+    size_t image_size = batch_tensor->info()->strides_in_bytes()[3];
+    queue.enqueueCopyBuffer(get_imported_buffer(frame), batch_tensor->cl_buffer(), 0, batch_frames.size() * image_size, image_size);
+    batch_frames.push_back(frame);
+    if(batch_frames.size() == batch_size)
+    {
+        dispatch_batch();
+    }
+}
+
+std::vector<AHardwareBuffer*> ACLPipeline::poll()
+{
+    if(!batch_frames.empty() && std::chrono::duration<float, std::milli>(Clock::now() - batch_start).count() >= batch_max_latency)
+    {
+        dispatch_batch();
+    }
+
+    std::vector<AHardwareBuffer*> processed;
+    while(!dispatched_batches.empty() && dispatched_batches.front().event.getInfo<CL_EVENT_COMMAND_EXECUTION_STATUS>() == CL_COMPLETE)
+    {
+        // The batches run one after another, so a batch starts when the previous one ends, unless the GPU was idle.
+        auto& batch = dispatched_batches.front();
+        auto end = batch.end_time.get();
+        auto start = std::max(batch.dispatch_time, last_batch_end);
+        auto& statistics = batch_statistics[batch.batch_size];
+        statistics.frames += static_cast<uint32_t>(batch.frames.size());
+        statistics.seconds += std::chrono::duration<double>(end - start).count();
+        last_batch_end = end;
+        processed.insert(processed.end(), batch.frames.begin(), batch.frames.end());
+        dispatched_batches.pop_front();
+    }
+    return processed;
+}
+
+void ACLPipeline::flush()
+{
+    if(!batch_frames.empty())
+    {
+        dispatch_batch();
+    }
+    for(auto& batch : dispatched_batches)
+    {
+        batch.end_time.wait();
+    }
+}
+
+std::vector<ACLPipeline::BatchThroughput> ACLPipeline::get_batch_throughput() const
+{
+    std::vector<BatchThroughput> throughput;
+    for(const auto& statistics : batch_statistics)
+    {
+        float frames_per_second = statistics.second.seconds > 0.0 ? static_cast<float>(statistics.second.frames / statistics.second.seconds) : 0.0f;
+        throughput.push_back({statistics.first, statistics.second.frames, frames_per_second});
+    }
+    return throughput;
+}
+
+void ACLPipeline::create_batch_network()
+{
+    vkb::Timer create_timer;
+    create_timer.start();
+
+    // Images of the batch have the layout of the imported images, so each frame is copied with a single copy.
+    arm_compute::TensorInfo tensor_info(arm_compute::TensorShape(channels, width, height, batch_size), 1, arm_compute::DataType::QASYMM8,
+                                        input_tensor->info()->quantization_info());
+    tensor_info.set_data_layout(arm_compute::DataLayout::NHWC);
+    batch_tensor = std::make_unique<arm_compute::CLTensor>();
+    batch_tensor->allocator()->init(tensor_info);
+    batch_net = create_network(get_active_style(), *batch_tensor, data_type, ACLNetwork::ActivationMemoryMode::Offset);
+    batch_net->prepare();
+    batch_tensor->allocator()->allocate();
+    LOGI("Network for batches of {} frames created in {:.2f} ms, {} bytes of activations", batch_size,
+         create_timer.stop<vkb::Timer::Milliseconds>(), batch_net->get_activation_memory_size());
+}
+
+void ACLPipeline::dispatch_batch()
+{
+    // Styles are switched between the batches.
+    update_styles();
+    if(!batch_net)
+    {
+        batch_net = create_network(get_active_style(), *batch_tensor, data_type, ACLNetwork::ActivationMemoryMode::Offset);
+        batch_net->prepare();
+    }
+
+    // Images after the submitted frames still have the frames of the previous batch, they are processed but not copied back.
+    batch_net->run();
+    size_t image_size = batch_tensor->info()->strides_in_bytes()[3];
+    for(size_t i = 0; i < batch_frames.size(); i++)
+    {
+        queue.enqueueCopyBuffer(batch_tensor->cl_buffer(), get_imported_buffer(batch_frames[i]), i * image_size, 0, image_size);
+    }
+
+    DispatchedBatch batch;
+    batch.frames = std::move(batch_frames);
+    batch.batch_size = batch_size;
+    batch.dispatch_time = Clock::now();
+    batch.end = std::make_unique<std::promise<Clock::time_point>>();
+    batch.end_time = batch.end->get_future();
+    batch.event = arm_compute::CLScheduler::get().enqueue_sync_event();
+    batch.event.setCallback(
+        CL_COMPLETE, [](cl_event, cl_int, void* end) { static_cast<std::promise<Clock::time_point>*>(end)->set_value(Clock::now()); }, batch.end.get());
+    queue.flush();
+    dispatched_batches.push_back(std::move(batch));
+    batch_frames.clear();
+}
+
+void ACLPipeline::run_network()
+{
+    if(tile_tensor)
+    {
+        run_tiles();
+    }
+    else
+    {
+        get_running_network().run();
+    }
+}
+
+void ACLPipeline::run_tiles()
+{
+    const auto& image = static_cast<const arm_compute::CLTensor&>(*input_tensor);
+    queue.enqueueCopyBuffer(image.cl_buffer(), source_image.cl_buffer(), 0, 0, image.info()->total_size());
+
+    // A tile sees only its own part of the image, which covers the receptive field of all the pixels it blends,
+    // so a tile whose input didn't change has the same output as in the last frame.
+    // Reading the changed blocks waits for the previous work on the queue, but not for the network of this frame.
+    bool use_cache = skip_unchanged_tiles && tile_cache_valid;
+    if(use_cache)
+    {
+        change_detection.run();
+        change_detection.read_changed_blocks();
+    }
+
+    // Tiles are copied on the queue of the network, so the copies are ordered with its kernels.
+    const auto& tile_info = *tile_tensor->info();
+    size_t image_row_pitch = image.info()->strides_in_bytes()[2];
+    size_t tile_row_pitch = tile_info.strides_in_bytes()[2];
+    size_t tile_size = tile_info.total_size();
+    auto tile_width = static_cast<uint32_t>(tile_info.dimension(1));
+    auto tile_height = static_cast<uint32_t>(tile_info.dimension(2));
+    cl::array<cl::size_type, 3> tile_origin{{0, 0, 0}};
+    cl::array<cl::size_type, 3> tile_region{{tile_width * tile_info.strides_in_bytes()[1], tile_height, 1}};
+    uint32_t skipped_tiles = 0;
+    for(size_t i = 0; i < tiles.size(); i++)
+    {
+        const auto& tile = tiles[i];
+        if(use_cache && !change_detection.is_changed(tile.x, tile.y, tile_width, tile_height))
+        {
+            queue.enqueueCopyBuffer(tile_output_cache, tile_tensor->cl_buffer(), i * tile_size, 0, tile_size);
+            skipped_tiles++;
+        }
+        else
+        {
+            cl::array<cl::size_type, 3> image_origin{{tile.x * image.info()->strides_in_bytes()[1], tile.y, 0}};
+            queue.enqueueCopyBufferRect(source_image.cl_buffer(), tile_tensor->cl_buffer(), image_origin, tile_origin, tile_region,
+                                        image_row_pitch, 0, tile_row_pitch, 0);
+            get_running_network().run();
+            if(skip_unchanged_tiles)
+            {
+                queue.enqueueCopyBuffer(tile_tensor->cl_buffer(), tile_output_cache, 0, i * tile_size, tile_size);
+            }
+        }
+        tile_blending.set_tile(tile.x, tile.y, tile.blend_width, tile.blend_height);
+        tile_blending.run();
+    }
+
+    if(skip_unchanged_tiles)
+    {
+        queue.enqueueCopyBuffer(source_image.cl_buffer(), previous_source_image.cl_buffer(), 0, 0, source_image.info()->total_size());
+        tile_cache_valid = true;
+        skipped_tile_ratio = static_cast<float>(skipped_tiles) / static_cast<float>(tiles.size());
+    }
+}
+
+const arm_compute::ITensorInfo& ACLPipeline::get_network_info() const
+{
+    return tile_tensor ? *tile_tensor->info() : *input_tensor->info();
+}
+
+const cl::Buffer& ACLPipeline::get_imported_buffer(AHardwareBuffer* image_buffer)
+{
+    auto imported_buffer = imported_buffers.find(image_buffer);
+    if(imported_buffer == imported_buffers.end())
+    {
+        LOGW("AHardwareBuffer was not imported in ACLPipeline::prepare(), importing it now.");
+        prepare({image_buffer});
+        imported_buffer = imported_buffers.find(image_buffer);
+    }
+    return imported_buffer->second;
+}
+
+void ACLPipeline::set_split_execution(bool enabled)
+{
+    if(enabled && (backend != ACLNetwork::Backend::CL || tile_tensor))
+    {
+        LOGW("Frames can be split only when the network processes the whole image on the GPU");
+        return;
+    }
+
+    if(enabled && !split_balancer)
+    {
+        // The halo covers the receptive field of the network, so the rows next to the split get the same result as in a whole frame.
+        // Band heights must keep the output size of the strided layers, so the split and the halo are aligned to the downsampling.
+        auto graph = TFLiteParser::parse_graph(get_model(get_active_style()), *input_tensor->info());
+        uint32_t downsampling = graph.get_vertical_downsampling();
+        uint32_t halo_rows = align_up(graph.get_receptive_field_rows(), downsampling);
+        uint32_t row_step = align_up(std::max(height / SPLIT_STEPS, 1u), downsampling);
+        split_balancer = std::make_unique<SplitBalancer>(height, row_step, halo_rows, height / 2 / row_step * row_step);
+        failed_split_row = 0;
+        LOGI("Frames are split with a halo of {} rows, the split moves in steps of {} rows", halo_rows, row_step);
+    }
+    split_execution = enabled;
+}
+
+bool ACLPipeline::is_split_execution() const
+{
+    return split_execution;
+}
+
+float ACLPipeline::get_gpu_split_ratio() const
+{
+    return split_balancer ? split_balancer->get_gpu_ratio() : 1.0f;
+}
+
+void ACLPipeline::load_split_networks(uint32_t split_row)
+{
+    // Band tensors have the layout of the image tensor, only with fewer rows.
+    arm_compute::TensorInfo gpu_band_info(*input_tensor->info());
+    gpu_band_info.set_tensor_shape(arm_compute::TensorShape(channels, width, split_balancer->get_gpu_band_rows(split_row)));
+    arm_compute::TensorInfo cpu_band_info(*input_tensor->info());
+    cpu_band_info.set_tensor_shape(arm_compute::TensorShape(channels, width, height - split_balancer->get_cpu_band_start(split_row)));
+
+    // The networks are discarded before the style or the image size changes, see discard_split_networks().
+    // The CPU network is prepared here, the GPU network is prepared on the render thread when it's taken.
+    auto& style = get_active_style();
+    loading_split_row = split_row;
+    split_networks_loading = std::async(std::launch::async, [this, &style, split_row, gpu_band_info, cpu_band_info]() {
+        vkb::Timer creation_timer;
+        creation_timer.start();
+
+        SplitNetworks networks;
+        networks.gpu_tensor = std::make_unique<arm_compute::CLTensor>();
+        networks.gpu_tensor->allocator()->init(gpu_band_info);
+        networks.gpu_net = create_network(style, *networks.gpu_tensor, data_type, ACLNetwork::ActivationMemoryMode::Offset);
+
+        networks.cpu_tensor = std::make_unique<arm_compute::Tensor>();
+        networks.cpu_tensor->allocator()->init(cpu_band_info);
+        networks.cpu_tensor->allocator()->allocate();
+        networks.cpu_net = create_network(style, *networks.cpu_tensor, data_type, ACLNetwork::ActivationMemoryMode::Offset);
+        networks.cpu_net->prepare();
+        LOGI("Networks for the split at row {} created in {:.2f} ms", split_row, creation_timer.stop<vkb::Timer::Milliseconds>());
+        return networks;
+    });
+}
+
+void ACLPipeline::take_split_networks()
+{
+    auto networks = split_networks_loading.get();
+    networks.gpu_net->prepare();
+
+    if(split_network_order.size() >= MAX_SPLIT_NETWORKS)
+    {
+        split_networks.erase(split_network_order.front());
+        split_network_order.pop_front();
+    }
+    split_network_order.push_back(loading_split_row);
+    split_networks.emplace(loading_split_row, std::move(networks));
+}
+
+void ACLPipeline::discard_split_networks()
+{
+    if(split_networks_loading.valid())
+    {
+        try
+        {
+            split_networks_loading.get();
+        }
+        catch(const std::exception& e)
+        {
+            LOGW("Networks for the split at row {} were not created: {}", loading_split_row, e.what());
+        }
+    }
+    split_networks.clear();
+    split_network_order.clear();
+}
+
+void ACLPipeline::update_split_networks()
+{
+    if(!split_balancer)
+    {
+        return;
+    }
+
+    // Networks that fail to load keep the frames at the current split (or whole), and their row is not loaded again.
+    if(split_networks_loading.valid() && split_networks_loading.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+    {
+        try
+        {
+            take_split_networks();
+        }
+        catch(const std::exception& e)
+        {
+            LOGE("Cannot create the networks for the split at row {}: {}", loading_split_row, e.what());
+            failed_split_row = loading_split_row;
+        }
+    }
+
+    // The split moves to the balanced row once its networks are ready.
+    uint32_t split_row = split_balancer->get_split_row();
+    uint32_t balanced_row = split_balancer->get_balanced_row();
+    if(balanced_row != split_row && split_networks.count(balanced_row) > 0)
+    {
+        split_balancer->apply_balanced_row();
+        split_row = balanced_row;
+    }
+
+    // Networks for the current split are loaded first, frames are processed whole until they're ready.
+    uint32_t missing_row = split_networks.count(split_row) == 0 ? split_row : balanced_row;
+    if(split_networks.count(missing_row) == 0 && !split_networks_loading.valid() && missing_row != failed_split_row)
+    {
+        load_split_networks(missing_row);
+    }
+}
+
+ACLPipeline::SplitNetworks* ACLPipeline::get_split_networks()
+{
+    uint32_t split_row = split_balancer->get_split_row();
+    auto networks = split_networks.find(split_row);
+    if(networks == split_networks.end())
+    {
+        return nullptr;
+    }
+
+    split_network_order.erase(std::find(split_network_order.begin(), split_network_order.end(), split_row));
+    split_network_order.push_back(split_row);
+    return &networks->second;
+}
+
+void ACLPipeline::run_split(AHardwareBuffer* image_buffer, SplitNetworks& networks)
+{
+    uint32_t split_row = split_balancer->get_split_row();
+    uint32_t cpu_band_start = split_balancer->get_cpu_band_start();
+
+    // The CPU band is copied before the GPU starts, as the GPU band overwrites the halo rows below the split.
+    {
+        HardwareBufferLock image(image_buffer);
+        read_image_rows(image, *networks.cpu_tensor, cpu_band_start, cpu_band_start, height - cpu_band_start);
+    }
+
+    // The GPU band uses the beginning of the imported image memory.
+    auto status = networks.gpu_tensor->allocator()->import_memory(get_imported_buffer(image_buffer));
+    if(!status)
+    {
+        throw std::runtime_error("Failed to import CLTensor memory, Error: " + status.error_description());
+    }
+
+    // The GPU band can finish before or after the CPU band, so its end is taken in the event callback.
+    // The callback owns the promise and releases it, so the promise outlives this function if the CPU band throws.
+    auto start = Clock::now();
+    networks.gpu_net->run();
+    auto gpu_event = arm_compute::CLScheduler::get().enqueue_sync_event();
+    auto gpu_end = std::make_unique<std::promise<Clock::time_point>>();
+    auto gpu_end_time = gpu_end->get_future();
+    gpu_event.setCallback(
+        CL_COMPLETE,
+        [](cl_event, cl_int, void* end) {
+            std::unique_ptr<std::promise<Clock::time_point>> promise(static_cast<std::promise<Clock::time_point>*>(end));
+            promise->set_value(Clock::now());
+        },
+        gpu_end.get());
+    gpu_end.release();
+    arm_compute::CLScheduler::get().queue().flush();
+
+    networks.cpu_net->run();
+    auto cpu_time = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    auto gpu_time = std::chrono::duration<double, std::milli>(gpu_end_time.get() - start).count();
+
+    // Rows below the split come from the CPU band, including the halo rows written by the GPU band.
+    {
+        HardwareBufferLock image(image_buffer);
+        write_image_rows(image, *networks.cpu_tensor, cpu_band_start, split_row, height - split_row);
+    }
+
+    if(split_balancer->update(gpu_time, cpu_time))
+    {
+        LOGI("GPU band {:.2f} ms, CPU band {:.2f} ms, split at row {} balanced at row {}",
+             gpu_time, cpu_time, split_row, split_balancer->get_balanced_row());
+    }
+}
+
+void ACLPipeline::run_on_cpu(AHardwareBuffer* image_buffer)
+{
+    HardwareBufferLock image(image_buffer);
+
+    // The address of the locked memory can change between the runs, so it's imported each time.
+    // Rows of the locked image can be padded, the tensor then processes a copy with packed rows, like the bands of a split frame.
+    auto& tensor = static_cast<arm_compute::Tensor&>(*input_tensor);
+    bool packed_rows = image.get_row_pitch() == tensor.info()->strides_in_bytes()[2];
+    if(!packed_rows)
+    {
+        cpu_image_copy.resize(tensor.info()->total_size());
+    }
+    auto status = tensor.allocator()->import_memory(packed_rows ? image.get_row(0) : cpu_image_copy.data());
+    if(!status)
+    {
+        throw std::runtime_error("Failed to import Tensor memory, Error: " + status.error_description());
+    }
+    if(!packed_rows)
+    {
+        read_image_rows(image, tensor, 0, 0, height);
+    }
+
+    if(psnr_requested)
+    {
+        psnr_requested = false;
+        psnr = measure_psnr();
+        LOGI("PSNR of {} CPU network output against F32 network: {:.2f} dB", arm_compute::string_from_data_type(data_type), psnr);
+    }
+    else
+    {
+        net->run();
+    }
+
+    if(!packed_rows)
+    {
+        write_image_rows(image, tensor, 0, 0, height);
+    }
+}
+
+void ACLPipeline::request_psnr_measurement()
+{
+    psnr_requested = true;
+}
+
+float ACLPipeline::get_psnr() const
+{
+    return psnr;
+}
+
+arm_compute::DataType ACLPipeline::get_data_type() const
+{
+    return data_type;
+}
+
+ACLNetwork::Backend ACLPipeline::get_backend() const
+{
+    return backend;
+}
+
+float ACLPipeline::measure_psnr()
+{
+    auto input_data = read_tensor_memory(*input_tensor);
+
+    // The reference network processes a copy of the input, because the networks write the result to their input tensor.
+    arm_compute::CLTensor reference_tensor;
+    reference_tensor.allocator()->init(*input_tensor->info());
+    reference_tensor.allocator()->allocate();
+    write_tensor_memory(reference_tensor, input_data);
+
+    auto reference_net = create_network(get_active_style(), reference_tensor, arm_compute::DataType::F32, ACLNetwork::ActivationMemoryMode::Dedicated);
+    reference_net->prepare();
+    reference_net->run();
+    run_network();
+    reference_net->sync();
+    net->sync();
+
+    auto reference_data = read_tensor_memory(reference_tensor);
+    auto output_data = read_tensor_memory(*input_tensor);
+
+    // Only color channels are compared, alpha channel is not processed by the network.
+    double squared_error = 0.0;
+    for(size_t pixel = 0; pixel < width * height; pixel++)
+    {
+        for(size_t c = 0; c < 3; c++)
+        {
+            double difference = (double)output_data[pixel * channels + c] - (double)reference_data[pixel * channels + c];
+            squared_error += difference * difference;
+        }
+    }
+
+    double mse = squared_error / (width * height * 3);
+    if(mse == 0.0)
+    {
+        return std::numeric_limits<float>::infinity();
+    }
+    return (float)(10.0 * std::log10(255.0 * 255.0 / mse));
+}
\ No newline at end of file
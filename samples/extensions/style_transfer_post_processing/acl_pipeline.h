@@ -24,7 +24,17 @@
 #include <arm_compute/runtime/CL/CLScheduler.h>
 #include <arm_compute/runtime/CL/functions/CLActivationLayer.h>
 #include <CL/cl2.hpp>
+#include <chrono>
+#include <deque>
+#include <future>
+#include <list>
+#include <map>
+#include <unordered_map>
 #include "acl_utils/acl_network.h"
+#include "acl_utils/cl_change_detection.h"
+#include "acl_utils/cl_tile_blending.h"
+#include "acl_utils/split_balancer.h"
+#include "acl_utils/tflite_parser.h"
 
 /*
  * Post-processing pipeline that uses Arm Compute Library (ACL) for running neural network inference.
@@ -32,16 +42,473 @@
 class ACLPipeline
 {
 public:
-    ACLPipeline(uint32_t width, uint32_t height, uint32_t channels);
+    // Tuning of the local work sizes of the OpenCL kernels, see arm_compute::CLTuner.
+    enum class TuningMode
+    {
+        // The stored tuning results are used if there are any, no kernels are tuned.
+        Disabled,
+        Rapid,
+        Normal,
+        Exhaustive
+    };
 
+    // The data type (F32, F16 or QASYMM8) defines the precision of the neural network.
+    // QASYMM8 uses the stored quantization table, or calibrates the network if there is none.
+    // Tuning modes other than Disabled tune all the kernels of the network and store the results for later launches.
+    // The network runs on the CPU if the GPU cannot import AHardwareBuffers (cl_arm_import_memory_android_hardware_buffer).
+    // A non-zero tile size creates the network for a tile instead of the whole image, so that the activation memory doesn't
+    // depend on the image size. The image is then processed tile by tile on the GPU, see configure_tiles().
+    ACLPipeline(uint32_t width,
+                uint32_t height,
+                uint32_t channels,
+                arm_compute::DataType data_type = arm_compute::DataType::F32,
+                TuningMode tuning_mode = TuningMode::Disabled,
+                uint32_t tile_width = 0,
+                uint32_t tile_height = 0);
+
+    // Waits for the batches that are being processed.
+    ~ACLPipeline();
+
+    // Imports the images that are going to be processed into OpenCL, so that run() only switches the memory of the input tensor.
+    void prepare(const std::vector<AHardwareBuffer*>& image_buffers);
+
+    // Runs the inference and waits until the image is processed.
     void run(AHardwareBuffer* image_buffer, const VkExtent3D& extent);
 
+    // Enqueues the inference without waiting for it. The returned event is complete when the image is processed.
+    cl::Event run_async(AHardwareBuffer* image_buffer, const VkExtent3D& extent);
+
+    // The next run will also process the image with an F32 network and compare both results.
+    void request_psnr_measurement();
+
+    // PSNR (in dB) of the last measured output against the F32 network, negative if it wasn't measured yet.
+    float get_psnr() const;
+
+    arm_compute::DataType get_data_type() const;
+
+    ACLNetwork::Backend get_backend() const;
+
+    // Splits each frame into two bands, the GPU processes the top band while the CPU processes the bottom one.
+    // The split row follows the time of both bands, see SplitBalancer. Frames can be split only on the CL backend.
+    void set_split_execution(bool enabled);
+
+    bool is_split_execution() const;
+
+    // Fraction of the image rows processed by the GPU when the frames are split.
+    float get_gpu_split_ratio() const;
+
+    bool is_tiled() const;
+
+    // Compares the input of each tile with the last frame, and reuses the cached output of the tiles that didn't change.
+    // Unchanged tiles can be skipped only in tiled mode.
+    void set_skip_unchanged_tiles(bool enabled);
+
+    bool is_skipping_unchanged_tiles() const;
+
+    // Fraction of the tiles of the last frame which reused their cached output.
+    float get_skipped_tile_ratio() const;
+
+    // Switches to another image size, the images of the new size must be prepared afterwards.
+    // Networks for all the sizes share the weights, so only the activations and the layers are created for a new size.
+    // Networks of the recently used sizes are kept, so switching back to them is immediate. In tiled mode only the tiles change.
+    void set_resolution(uint32_t width, uint32_t height);
+
+    // Styles are models with the architecture of nn_models/style_transfer.tflite, stored as nn_models/<name>.tflite.
+    // Creates the network of the style on a background thread, for the same input tensor as the current network, and prepares
+    // it on the render thread once it's created, so that switching to the style only swaps the networks. Networks of all the styles share one activation memory pool.
+    void load_style(const std::string& name);
+
+    // Switches to the style at the start of the next run. A style that isn't loaded is loaded first and used once it's ready.
+    void set_style(const std::string& name);
+
+    const std::string& get_style() const;
+
+    struct StyleInfo
+    {
+        std::string name;
+
+        // The network of the style is resident and the style can be switched to immediately.
+        bool loaded;
+
+        bool loading;
+
+        // Time to create the network of the style on the background thread and to prepare it on the render thread.
+        float load_milliseconds;
+
+        size_t weights_memory_size;
+    };
+
+    // Styles that were loaded, ordered by name.
+    std::vector<StyleInfo> get_styles() const;
+
+    // Networks of the inactive styles are released, starting with the least recently used one, until the weights of the
+    // resident styles fit the budget. The released styles are loaded again when they are selected. 0 keeps all the styles.
+    void set_style_memory_budget(size_t bytes);
+
+    // Time that the last switch of the style took in the run that switched it.
+    float get_style_switch_milliseconds() const;
+
+    // Interpolates the weights of the active style towards another style of the same architecture, 0 keeps the active style and 1
+    // gives the other one. A network with the weights of both styles is created in the next run after another style is selected,
+    // changing only the factor blends its weights on the GPU before the next run. An empty name stops blending.
+    // Styles are blended only by F32 and F16 networks on the GPU, and the frames are not split while they are blended.
+    void set_style_blend(const std::string& name, float factor);
+
+    const std::string& get_style_blend() const;
+
+    float get_style_blend_factor() const;
+
+    // Batched mode for offline rendering (e.g. replays and trailers): frames queued with submit() are copied into the images of
+    // a tensor with a batch dimension, and the network processes the whole batch in the same dispatches, which keeps the GPU busier
+    // and reads the weights once per batch. A batch that isn't full is processed once its first frame waited max_latency_ms.
+    // The network of the batch has the weights of the active style and the activations of the other networks of the pipeline.
+    // Frames are processed in place on the GPU, so the batched mode requires the CL backend and isn't used in tiled mode.
+    // The submitted frames are finished before the batch size changes, 1 ends the batched mode.
+    void set_batch_size(uint32_t batch_size, float max_latency_ms);
+
+    uint32_t get_batch_size() const;
+
+    // Queues the frame, which must not be used until poll() returns it. The batch is processed as soon as it's full.
+    void submit(AHardwareBuffer* frame);
+
+    // Processes the batch if its latency cap expired and returns the processed frames in the order they were submitted.
+    std::vector<AHardwareBuffer*> poll();
+
+    // Processes the frames in the queue even if the batch isn't full and waits until all the submitted frames are processed,
+    // the next poll() returns them.
+    void flush();
+
+    struct BatchThroughput
+    {
+        uint32_t batch_size;
+
+        uint32_t frames;
+
+        float frames_per_second;
+    };
+
+    // Throughput of each batch size used so far, measured on the GPU timeline from the end of the previous batch, or from the
+    // submission of the batch if the GPU was idle, to the end of the batch.
+    std::vector<BatchThroughput> get_batch_throughput() const;
+
 private:
+    // Position of a tile in the image and its overlap with the tiles on the left and above it.
+    struct Tile
+    {
+        uint32_t x;
+
+        uint32_t y;
+
+        uint32_t blend_width;
+
+        uint32_t blend_height;
+    };
+
+    // Tiles overlap by the receptive field of the network and are blended across the overlap.
+    // Tile size is aligned to the downsampling of the network and limited to the image size.
+    void configure_tiles(uint32_t tile_width, uint32_t tile_height);
+
+    // Allocates a tile tensor of the requested tile size, limited to the size of the image, and sets its overlap.
+    std::unique_ptr<arm_compute::CLTensor> create_tile_tensor(const arm_compute::ITensorInfo& image_info, uint32_t& overlap);
+
+    // Places the tiles over the current image size, the last tile in each row and column ends at the image edge.
+    void place_tiles();
+
+    // Tensor for an image of the given size on the backend of the pipeline, without any memory.
+    std::unique_ptr<arm_compute::ITensor> create_image_tensor(uint32_t image_width, uint32_t image_height) const;
+
+    // Processes the image with the network, tile by tile in tiled mode.
+    void run_network();
+
+    // Copies each tile from the unprocessed image, runs the network on it and blends the result into the image.
+    // When unchanged tiles are skipped, their cached output is blended instead.
+    void run_tiles();
+
+    // Allocates the input of the last frame and the output cache for the current tiles.
+    void configure_tile_cache();
+
+    // The tile in tiled mode, otherwise the whole image.
+    const arm_compute::ITensorInfo& get_network_info() const;
+
+    // Networks for the bands of a split frame. The tensors are kept here, because the networks refer to them.
+    struct SplitNetworks
+    {
+        // Top rows of the image including the halo, its memory is the imported image.
+        std::unique_ptr<arm_compute::CLTensor> gpu_tensor;
+
+        std::unique_ptr<ACLNetwork> gpu_net;
+
+        // Copy of the bottom rows of the image including the halo, as the GPU band overwrites the halo rows in place.
+        std::unique_ptr<arm_compute::Tensor> cpu_tensor;
+
+        std::unique_ptr<ACLNetwork> cpu_net;
+    };
+
+    // Creates the networks for a split row on a background thread, the GPU network is prepared when they're taken.
+    void load_split_networks(uint32_t split_row);
+
+    // Waits for the networks being loaded, prepares them and keeps them for their split row.
+    void take_split_networks();
+
+    // Drops the networks of all split rows, called before the style or the image size changes.
+    void discard_split_networks();
+
+    // Takes the loaded networks, moves the split to the balanced row when its networks are ready, and loads the missing ones.
+    void update_split_networks();
+
+    // Returns the networks for the current split row, or null while they're being created.
+    SplitNetworks* get_split_networks();
+
+    // Runs both bands of the frame and waits for them, then balances the split according to the time of each band.
+    void run_split(AHardwareBuffer* image_buffer, SplitNetworks& networks);
+
+    // Returns the OpenCL memory of the image, importing it if it wasn't imported in prepare().
+    const cl::Buffer& get_imported_buffer(AHardwareBuffer* image_buffer);
+
+    // Loads the stored local work sizes into the tuner, or tunes the kernels of the network and stores the results.
+    void apply_tuning(TuningMode tuning_mode);
+
+    // Profiles the same network on the CPU and logs its layer times next to the GPU layer times.
+    void compare_cpu_latency(const std::vector<ACLNetwork::LayerTime>& gpu_times);
+
+    // Runs the network on the CPU, with the image memory locked for CPU access.
+    void run_on_cpu(AHardwareBuffer* image_buffer);
+
+    // Model of a style and the network of the style for the current input tensor, the network of the active style is in net.
+    struct Style
+    {
+        // The model is nn_models/<name>.tflite, the files stored for the style (e.g. precompiled networks) start with the name.
+        std::string name;
+
+        std::unique_ptr<ModelFile> model;
+
+        // Hash of the model, computed when the model is mapped. It identifies the stored tuning results, quantization and
+        // precompiled networks of the model.
+        size_t model_hash{0};
+
+        // Kernels and biases of the networks with the data type and the backend of the pipeline, for all the image sizes.
+        std::shared_ptr<ACLNetwork::SharedWeights> shared_weights;
+
+        std::unique_ptr<ACLNetwork> net;
+
+        // Network which is being created on the background thread.
+        std::future<std::unique_ptr<ACLNetwork>> loading;
+
+        float load_milliseconds{0.0f};
+
+        // Inactive styles with the lowest value were used least recently.
+        uint64_t last_used{0};
+    };
+
+    Style& get_active_style();
+
+    // Prepares the networks that finished loading and switches to the requested style if its network is ready.
+    void update_styles();
+
+    // Swaps the networks, the networks of the other image sizes and split rows are created again for the new style.
+    void switch_style(const std::string& name);
+
+    void apply_style_memory_budget();
+
+    // Creates the network that blends the styles if it's missing and passes it the blend factor.
+    void update_style_blend();
+
+    // The network that blends the styles runs instead of net while the blend factor isn't 0.
+    ACLNetwork& get_running_network();
+
+    // Creates the tensor for a batch of images of the current size and the network for it.
+    void create_batch_network();
+
+    // Runs the network on the frames copied into the batch tensor and copies the results back to the frames.
+    void dispatch_batch();
+
+    // Loads the precompiled network of the style for the image size and the data type from assets or storage if there is one.
+    // Otherwise the network is created from the model and exported to storage, so that the next launch can load it.
+    // A precompiled network replaces only the creation of this network, the model must still be in the assets: its hash
+    // identifies the precompiled networks, and tiling, split execution, blending and calibration parse the model itself.
+    // Networks can be created on any thread, kernels are configured under the build mutex of CLProgramCache.
+    std::unique_ptr<ACLNetwork> create_network(Style& style,
+                                               const arm_compute::ITensor& input_output_tensor,
+                                               arm_compute::DataType network_data_type,
+                                               ACLNetwork::ActivationMemoryMode memory_mode);
+
+    // The model is mapped only when a network is created from it.
+    const ModelFile& get_model(Style& style);
+
+    // Loads quantization of the model tensors from storage, or calibrates it using the images in storage 'calibration/' directory.
+    TFLiteParser::QuantizationTable load_quantization(Style& style);
+
+    // Runs the network and an F32 reference network on the current input and returns PSNR of the output.
+    float measure_psnr();
+
+    uint32_t width;
+
+    uint32_t height;
+
+    uint32_t channels;
+
+    arm_compute::DataType data_type;
+
+    bool psnr_requested{false};
+
+    float psnr{-1.0f};
+
     cl::Context context;
 
     cl::CommandQueue queue;
 
     std::unique_ptr<ACLNetwork> net;
 
-    std::unique_ptr<arm_compute::CLTensor> input_tensor;
+    // Activation memory of the networks with the data type and the backend of the pipeline, which run one at a time.
+    std::shared_ptr<ACLNetwork::SharedActivations> shared_activations;
+
+    // Network for an image size that was used before, with its input tensor.
+    struct CachedNetwork
+    {
+        uint32_t width;
+
+        uint32_t height;
+
+        std::unique_ptr<arm_compute::ITensor> input_tensor;
+
+        std::unique_ptr<ACLNetwork> net;
+    };
+
+    // Networks of the recently used image sizes, from the most recently used.
+    std::list<CachedNetwork> cached_networks;
+
+    ACLNetwork::Backend backend{ACLNetwork::Backend::CL};
+
+    // CLTensor for the CL backend, Tensor for the CPU backend.
+    std::unique_ptr<arm_compute::ITensor> input_tensor;
+
+    // Memory of the CPU input tensor when the rows of the locked image are padded.
+    std::vector<uint8_t> cpu_image_copy;
+
+    // OpenCL memory imported from each AHardwareBuffer. The memory is released when the pipeline is destroyed.
+    std::unordered_map<AHardwareBuffer*, cl::Buffer> imported_buffers;
+
+    // AHardwareBuffer currently used as the memory of the input tensor.
+    AHardwareBuffer* current_image_buffer{nullptr};
+
+    bool split_execution{false};
+
+    // Created when the frames are split for the first time.
+    std::unique_ptr<SplitBalancer> split_balancer;
+
+    // Networks for the recently used split rows, ordered from the least recently used.
+    std::unordered_map<uint32_t, SplitNetworks> split_networks;
+
+    std::deque<uint32_t> split_network_order;
+
+    // Networks for one split row are created at a time, off the render thread.
+    std::future<SplitNetworks> split_networks_loading;
+
+    uint32_t loading_split_row{0};
+
+    // Split row whose networks couldn't be created, they're not loaded again until the split is reset.
+    uint32_t failed_split_row{0};
+
+    // Input and output of the network in tiled mode.
+    std::unique_ptr<arm_compute::CLTensor> tile_tensor;
+
+    // Copy of the unprocessed image in tiled mode, as processed tiles overwrite the overlap that the next tiles read.
+    arm_compute::CLTensor source_image;
+
+    CLTileBlending tile_blending;
+
+    std::vector<Tile> tiles;
+
+    // Overlap of neighbouring tiles in pixels.
+    uint32_t tile_overlap{0};
+
+    // Tile size set by configure_tiles(), the tiles are smaller when the image is.
+    uint32_t requested_tile_width{0};
+
+    uint32_t requested_tile_height{0};
+
+    bool skip_unchanged_tiles{false};
+
+    // Copy of the unprocessed image of the last frame, which is compared with the current one.
+    arm_compute::CLTensor previous_source_image;
+
+    CLChangeDetection change_detection;
+
+    // Output of the network for each tile in the last frame, in the order of the tiles.
+    cl::Buffer tile_output_cache;
+
+    // The cache is filled by the first frame after the tiles are placed.
+    bool tile_cache_valid{false};
+
+    float skipped_tile_ratio{0.0f};
+
+    std::string active_style;
+
+    // Style to switch to once its network is loaded, empty if there is none.
+    std::string pending_style;
+
+    size_t style_memory_budget{0};
+
+    float style_switch_time{0.0f};
+
+    uint64_t style_use_count{0};
+
+    // Style whose weights are blended with the weights of the active style, empty if there is none.
+    std::string blend_style;
+
+    float blend_factor{0.0f};
+
+    // Created for the active style and the current network tensor, it has its own copy of the weights of both styles.
+    std::unique_ptr<ACLNetwork> blend_net;
+
+    using Clock = std::chrono::steady_clock;
+
+    uint32_t batch_size{1};
+
+    float batch_max_latency{0.0f};
+
+    // Images of all the frames of a batch, the frames are copied to it and back on the queue of the network.
+    std::unique_ptr<arm_compute::CLTensor> batch_tensor;
+
+    // Created again for the active style when the style is switched.
+    std::unique_ptr<ACLNetwork> batch_net;
+
+    // Frames copied into the batch tensor which is not dispatched yet.
+    std::vector<AHardwareBuffer*> batch_frames;
+
+    Clock::time_point batch_start;
+
+    struct DispatchedBatch
+    {
+        std::vector<AHardwareBuffer*> frames;
+
+        uint32_t batch_size;
+
+        Clock::time_point dispatch_time;
+
+        // Complete when the frames are copied back.
+        cl::Event event;
+
+        // Set by the callback of the event, the promise is kept in its own allocation because the callback refers to it.
+        std::unique_ptr<std::promise<Clock::time_point>> end;
+
+        std::future<Clock::time_point> end_time;
+    };
+
+    std::deque<DispatchedBatch> dispatched_batches;
+
+    // End of the last batch that poll() returned.
+    Clock::time_point last_batch_end;
+
+    struct BatchStatistics
+    {
+        uint32_t frames{0};
+
+        double seconds{0.0};
+    };
+
+    std::map<uint32_t, BatchStatistics> batch_statistics;
+
+    // Declared last, so that the styles which are still loading are finished before the rest of the pipeline is destroyed.
+    std::map<std::string, Style> styles;
 };
\ No newline at end of file
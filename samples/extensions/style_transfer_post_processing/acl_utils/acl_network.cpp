@@ -18,77 +18,923 @@
 #include "acl_network.h"
 #include "tensor_utils.h"
 #include "common/logging.h"
+#include <timer.h>
+#include <arm_compute/core/utils/misc/ShapeCalculator.h>
+#include <arm_compute/runtime/CL/CLScheduler.h>
+#include <arm_compute/runtime/Scheduler.h>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace
+{
+// Functions of both backends take non-const tensors also for the tensors they only read.
+arm_compute::ICLTensor* as_cl_tensor(const arm_compute::ITensor& tensor)
+{
+    return static_cast<arm_compute::ICLTensor*>(const_cast<arm_compute::ITensor*>(&tensor));
+}
 
-uint32_t calculate_conv_output_size(uint32_t input_size, uint32_t kernel_size, uint32_t pad, uint32_t stride, uint32_t dilation)
+arm_compute::ITensor* as_cpu_tensor(const arm_compute::ITensor& tensor)
 {
-    return std::ceil((float)(input_size + 2 * pad - dilation * (kernel_size - 1)) / (float)(stride));
+    return const_cast<arm_compute::ITensor*>(&tensor);
 }
 
-uint32_t calculate_deconv_output_size(uint32_t input_size, uint32_t kernel_size, uint32_t pad, uint32_t stride)
+// Creates the function of the backend, the configure callback receives the function and a cast to the tensor type the function takes.
+// CL and CPU functions used by the network have the same configure() and validate() parameters apart from the tensor types.
+template <typename CLFunction, typename CPUFunction, typename Configure>
+std::unique_ptr<arm_compute::IFunction> create_function(ACLNetwork::Backend backend, Configure&& configure)
 {
-    return (input_size - 1) * stride - 2 * pad + kernel_size;
+    if(backend == ACLNetwork::Backend::CL)
+    {
+        auto function = std::make_unique<CLFunction>();
+        configure(*function, as_cl_tensor);
+        return std::move(function);
+    }
+    auto function = std::make_unique<CPUFunction>();
+    configure(*function, as_cpu_tensor);
+    return std::move(function);
 }
 
-void ACLNetwork::run()
+void check_layer(const char* name, const arm_compute::Status& status)
+{
+    if(!status)
+    {
+        LOGE("{} error, description: {}", name, status.error_description().c_str());
+    }
+}
+
+// Validates a convolution method chosen before the layer is configured, e.g. on another device.
+arm_compute::Status validate_convolution_method(arm_compute::ConvolutionMethod method,
+                                                const arm_compute::ITensorInfo* input,
+                                                const arm_compute::ITensorInfo* kernel,
+                                                const arm_compute::ITensorInfo* bias,
+                                                const arm_compute::ITensorInfo* output,
+                                                const arm_compute::PadStrideInfo& pad_stride_info,
+                                                const arm_compute::WeightsInfo& weights_info,
+                                                const arm_compute::Size2D& dilation,
+                                                const arm_compute::ActivationLayerInfo& activation_info)
 {
-    for(const auto& function : functions)
+    switch(method)
     {
-        function->prepare();
-        function->run();
+        case arm_compute::ConvolutionMethod::GEMM:
+            return arm_compute::CLGEMMConvolutionLayer::validate(input, kernel, bias, output, pad_stride_info, weights_info, dilation, activation_info);
+        case arm_compute::ConvolutionMethod::DIRECT:
+            return arm_compute::CLDirectConvolutionLayer::validate(input, kernel, bias, output, pad_stride_info, activation_info);
+        case arm_compute::ConvolutionMethod::WINOGRAD:
+            return arm_compute::CLWinogradConvolutionLayer::validate(input, kernel, bias, output, pad_stride_info, activation_info);
+        default:
+            return arm_compute::Status{};
     }
 }
 
-arm_compute::CLTensor& ACLNetwork::create_tensor(const std::vector<uint32_t> &dims)
+arm_compute::TensorShape get_tensor_shape(const std::vector<uint32_t>& dims)
 {
     arm_compute::TensorShape shape;
-    for(int i = 0; i < dims.size(); i++)
+    for(size_t i = 0; i < dims.size(); i++)
     {
         shape.set(i, dims[i], false);
     }
+    return shape;
+}
+
+// Layers give the dimensions of a single image (channels, width, height), activations have the batch size of the layer input.
+std::vector<uint32_t> get_batched_dims(std::vector<uint32_t> dims, const arm_compute::ITensor& input)
+{
+    auto batch_size = static_cast<uint32_t>(input.info()->dimension(3));
+    if(batch_size > 1)
+    {
+        dims.push_back(batch_size);
+    }
+    return dims;
+}
+
+std::shared_ptr<arm_compute::ISimpleLifetimeManager> create_lifetime_manager(ACLNetwork::ActivationMemoryMode memory_mode)
+{
+    switch(memory_mode)
+    {
+        case ACLNetwork::ActivationMemoryMode::Blob:
+            return std::make_shared<arm_compute::BlobLifetimeManager>();
+        case ACLNetwork::ActivationMemoryMode::Offset:
+            return std::make_shared<arm_compute::OffsetLifetimeManager>();
+        default:
+            return nullptr;
+    }
+}
+
+// Reverses the kernel of a transposed convolution in both spatial dimensions, which gives the kernel of the equivalent convolution.
+// Values are ordered as [output_features][kernel_height][kernel_width][input_features], the shape is in ACL order.
+ConstantValues flip_kernel_values(const ConstantValues& values, const arm_compute::TensorShape& shape)
+{
+    size_t input_features = shape[0];
+    size_t kernel_width = shape[1];
+    size_t kernel_height = shape[2];
+    size_t output_features = shape[3];
+    if(values.get_data_type() != arm_compute::DataType::F32 || values.size() != shape.total_size())
+    {
+        throw std::runtime_error("Only F32 kernels with the shape of the layer can be flipped.");
+    }
+
+    std::vector<float> flipped(values.size());
+    for(size_t o = 0; o < output_features; o++)
+    {
+        for(size_t y = 0; y < kernel_height; y++)
+        {
+            for(size_t x = 0; x < kernel_width; x++)
+            {
+                const float* source = values.data() + ((o * kernel_height + y) * kernel_width + x) * input_features;
+                float* destination = flipped.data() + ((o * kernel_height + kernel_height - 1 - y) * kernel_width + kernel_width - 1 - x) * input_features;
+                std::copy(source, source + input_features, destination);
+            }
+        }
+    }
+    return ConstantValues(std::move(flipped));
+}
+
+// Allocator of the activation memory pools, CLBufferAllocator or the CPU Allocator.
+std::unique_ptr<arm_compute::IAllocator> create_allocator(ACLNetwork::Backend backend)
+{
+    if(backend == ACLNetwork::Backend::CL)
+    {
+        return std::make_unique<arm_compute::CLBufferAllocator>();
+    }
+    return std::make_unique<arm_compute::Allocator>();
+}
+}        // namespace
+
+ACLNetwork::SharedWeights::SharedWeights(arm_compute::DataType data_type, Backend backend) :
+    data_type(data_type),
+    backend(backend)
+{}
+
+ACLNetwork::SharedActivations::SharedActivations(ActivationMemoryMode memory_mode, Backend backend) :
+    memory_mode(memory_mode),
+    backend(backend),
+    allocator(create_allocator(backend)),
+    lifetime_manager(create_lifetime_manager(memory_mode))
+{
+    if(!lifetime_manager)
+    {
+        throw std::runtime_error("Only planned (Blob or Offset) activation memory can be shared.");
+    }
+    memory_manager = std::make_shared<arm_compute::MemoryManagerOnDemand>(lifetime_manager, std::make_shared<arm_compute::PoolManager>());
+}
+
+ACLNetwork::ACLNetwork(arm_compute::DataType data_type, ActivationMemoryMode memory_mode, Backend backend) :
+    data_type(data_type),
+    memory_mode(memory_mode),
+    backend(backend)
+{
+    if(data_type != arm_compute::DataType::F32 && data_type != arm_compute::DataType::F16 && data_type != arm_compute::DataType::QASYMM8)
+    {
+        throw std::runtime_error("ACLNetwork supports only F32, F16 and QASYMM8 data types.");
+    }
+
+    lifetime_manager = create_lifetime_manager(memory_mode);
+    allocator = create_allocator(backend);
+    if(lifetime_manager)
+    {
+        auto pool_manager = std::make_shared<arm_compute::PoolManager>();
+        memory_manager = std::make_shared<arm_compute::MemoryManagerOnDemand>(lifetime_manager, pool_manager);
+        memory_group = arm_compute::MemoryGroup(memory_manager);
+    }
+}
+
+ACLNetwork::~ACLNetwork()
+{
+    // The shared lifetime manager keeps the plan of each memory group until the group is released.
+    if(shared_activations)
+    {
+        std::lock_guard<std::mutex> lock(shared_activations->mutex);
+        shared_activations->lifetime_manager->release_group(&memory_group);
+    }
+}
+
+ACLNetwork::Backend ACLNetwork::get_tensor_backend(const arm_compute::ITensor& tensor)
+{
+    return dynamic_cast<const arm_compute::ICLTensor*>(&tensor) ? Backend::CL : Backend::CPU;
+}
+
+void ACLNetwork::set_cpu_thread_count(uint32_t count)
+{
+    arm_compute::Scheduler::get().set_num_threads(count);
+}
+
+void ACLNetwork::prepare()
+{
+    if(prepared)
+    {
+        return;
+    }
+
+    allocate_activations();
+
+    // Blending functions need the buffers of both sets, which are allocated when their values are set.
+    for(auto& weights : blended_weights)
+    {
+        if(weights->second_kernel->info()->is_resizable())
+        {
+            throw std::runtime_error("The second set of weights must be set for all the blended layers before the network is prepared.");
+        }
+        weights->kernel_blending.configure(as_cl_tensor(*weights->first_kernel), as_cl_tensor(*weights->second_kernel), as_cl_tensor(*weights->kernel));
+        weights->bias_blending.configure(as_cl_tensor(*weights->first_bias), as_cl_tensor(*weights->second_bias), as_cl_tensor(*weights->bias));
+    }
+
+    upload_weights();
+    if(weight_blending)
+    {
+        blend_weights();
+    }
+
+    // Functions mark the weights as unused once they are prepared, the shared weights are still used by this network.
+    if(shared_weights)
+    {
+        for(const auto& tensor : shared_weights->tensors)
+        {
+            tensor->mark_as_used();
+        }
+    }
+
+    {
+        auto lock = lock_activations();
+        arm_compute::MemoryGroupResourceScope scope(memory_group);
+        for(const auto& layer : layers)
+        {
+            layer.function->prepare();
+        }
+    }
+
+    // Weights reshaping must be finished before the original weights can be released.
+    sync();
+
+    // Functions keep a prepared copy of about the same size for each constant tensor they don't use directly,
+    // the shared tensors are kept next to their copies.
+    size_t released_size = 0;
+    weights_memory_size = 0;
+    for(auto* tensor : constant_tensors)
+    {
+        weights_memory_size += tensor->info()->total_size();
+        if(!tensor->is_used())
+        {
+            released_size += tensor->info()->total_size();
+            get_tensor_allocator(*tensor).free();
+        }
+    }
+    if(shared_weights)
+    {
+        for(size_t i = 0; i < shared_weights_used; i++)
+        {
+            weights_memory_size += shared_weights->tensors[i]->info()->total_size();
+        }
+    }
+    LOGI("ACLNetwork prepared, released {} bytes of unused constant tensors.", released_size);
+
+    prepared = true;
+}
+
+void ACLNetwork::sync() const
+{
+    if(backend == Backend::CL)
+    {
+        arm_compute::CLScheduler::get().sync();
+    }
+}
+
+void ACLNetwork::run()
+{
+    if(!prepared)
+    {
+        throw std::runtime_error("ACLNetwork must be prepared before running.");
+    }
+
+    // Kernels of the last run are finished before the blend, as they are on the same queue.
+    if(blend_pending)
+    {
+        blend_weights();
+    }
+
+    auto lock = lock_activations();
+    arm_compute::MemoryGroupResourceScope scope(memory_group);
+    for(const auto& layer : layers)
+    {
+        layer.function->run();
+    }
+}
+
+std::vector<ACLNetwork::LayerTime> ACLNetwork::profile_layers(uint32_t iterations)
+{
+    if(!prepared)
+    {
+        throw std::runtime_error("ACLNetwork must be prepared before profiling.");
+    }
+
+    // Each layer is run on its own and waited for, so the times include the overhead of the synchronization.
+    auto lock = lock_activations();
+    arm_compute::MemoryGroupResourceScope scope(memory_group);
+    sync();
+
+    std::vector<LayerTime> layer_times;
+    for(const auto& layer : layers)
+    {
+        vkb::Timer timer;
+        timer.start();
+        for(uint32_t i = 0; i < iterations; i++)
+        {
+            layer.function->run();
+        }
+        sync();
+        layer_times.push_back({layer.name, timer.stop<vkb::Timer::Milliseconds>() / iterations});
+    }
+    return layer_times;
+}
+
+bool ACLNetwork::is_prepared() const
+{
+    return prepared;
+}
+
+ACLNetwork::Backend ACLNetwork::get_backend() const
+{
+    return backend;
+}
+
+arm_compute::DataType ACLNetwork::get_data_type() const
+{
+    return data_type;
+}
+
+arm_compute::DataType ACLNetwork::get_float_data_type() const
+{
+    // Quantized networks use F32 for the layers that are not quantized.
+    return data_type == arm_compute::DataType::F16 ? arm_compute::DataType::F16 : arm_compute::DataType::F32;
+}
+
+void ACLNetwork::set_model_tensor(int32_t index, arm_compute::ITensor &tensor)
+{
+    model_tensors[index] = &tensor;
+}
+
+void ACLNetwork::set_layer_validation(bool enabled)
+{
+    validate_layers = enabled;
+}
+
+void ACLNetwork::set_shared_weights(std::shared_ptr<SharedWeights> weights)
+{
+    if(!layers.empty())
+    {
+        throw std::runtime_error("Shared weights must be set before the layers are added.");
+    }
+    if(weights && (weights->data_type != data_type || weights->backend != backend))
+    {
+        throw std::runtime_error("Shared weights were created for another data type or backend.");
+    }
+    if(weights && weight_blending)
+    {
+        throw std::runtime_error("Networks that blend the weights cannot share them.");
+    }
+    shared_weights = std::move(weights);
+    shared_weights_used = 0;
+}
+
+void ACLNetwork::set_shared_activations(std::shared_ptr<SharedActivations> activations)
+{
+    if(prepared)
+    {
+        throw std::runtime_error("Shared activations must be set before the network is prepared.");
+    }
+    if(activations && (activations->memory_mode != memory_mode || activations->backend != backend))
+    {
+        throw std::runtime_error("Shared activations were created for another memory mode or backend.");
+    }
+
+    shared_activations = std::move(activations);
+    if(shared_activations)
+    {
+        lifetime_manager = shared_activations->lifetime_manager;
+        memory_manager = shared_activations->memory_manager;
+        memory_group = arm_compute::MemoryGroup(memory_manager);
+    }
+}
+
+void ACLNetwork::enable_weight_blending()
+{
+    if(!layers.empty())
+    {
+        throw std::runtime_error("Weight blending must be enabled before the layers are added.");
+    }
+    if(backend != Backend::CL || arm_compute::is_data_type_quantized(data_type))
+    {
+        throw std::runtime_error("Weights can be blended only in F32 and F16 networks on the CL backend.");
+    }
+    if(shared_weights)
+    {
+        throw std::runtime_error("Networks that share the weights cannot blend them.");
+    }
+    weight_blending = true;
+}
+
+bool ACLNetwork::is_blending_weights() const
+{
+    return weight_blending;
+}
+
+size_t ACLNetwork::get_blended_layer_count() const
+{
+    return blended_weights.size();
+}
+
+void ACLNetwork::set_blend_weights(size_t layer, const ConstantValues& kernel_values, const ConstantValues& bias_values)
+{
+    if(prepared)
+    {
+        throw std::runtime_error("Blended weights must be set before the network is prepared.");
+    }
+    auto& weights = *blended_weights.at(layer);
+    if(!weights.second_kernel->info()->is_resizable())
+    {
+        throw std::runtime_error("The second set of weights of layer " + std::to_string(layer) + " is already set.");
+    }
+    if(kernel_values.size() != weights.kernel->info()->tensor_shape().total_size() || bias_values.size() != weights.bias->info()->tensor_shape().total_size())
+    {
+        throw std::runtime_error("The second set of weights doesn't match blended layer " + std::to_string(layer) + ".");
+    }
+
+    if(weights.flip_kernel)
+    {
+        set_weights_values(*weights.input, *weights.second_kernel, flip_kernel_values(kernel_values, weights.kernel->info()->tensor_shape()),
+                           *weights.second_bias, bias_values, weights.channel_inner_size);
+    }
+    else
+    {
+        set_weights_values(*weights.input, *weights.second_kernel, kernel_values, *weights.second_bias, bias_values, weights.channel_inner_size);
+    }
+}
+
+void ACLNetwork::set_blend_factor(float factor)
+{
+    if(!weight_blending)
+    {
+        throw std::runtime_error("Weight blending is not enabled.");
+    }
+    factor = std::min(std::max(factor, 0.0f), 1.0f);
+    if(factor != blend_factor)
+    {
+        blend_factor = factor;
+        blend_pending = true;
+    }
+}
+
+float ACLNetwork::get_blend_factor() const
+{
+    return blend_factor;
+}
+
+const std::vector<arm_compute::ConvolutionMethod>& ACLNetwork::get_convolution_methods() const
+{
+    return convolution_methods;
+}
+
+const std::unordered_map<int32_t, arm_compute::ITensor*>& ACLNetwork::get_model_tensors() const
+{
+    return model_tensors;
+}
+
+size_t ACLNetwork::get_activation_memory_size() const
+{
+    return activation_memory_size;
+}
+
+size_t ACLNetwork::get_weights_memory_size() const
+{
+    return weights_memory_size;
+}
+
+void ACLNetwork::add_function(std::unique_ptr<arm_compute::IFunction> function,
+                              const std::string& name,
+                              const std::vector<const arm_compute::ITensor*>& inputs,
+                              const std::vector<const arm_compute::ITensor*>& outputs)
+{
+    layers.push_back({std::move(function), name + " " + std::to_string(layers.size()), inputs, outputs});
+}
+
+void ACLNetwork::allocate_activations()
+{
+    size_t unplanned_size = 0;
+    for(auto* tensor : activation_tensors)
+    {
+        unplanned_size += tensor->info()->total_size();
+    }
+
+    if(memory_mode == ActivationMemoryMode::Dedicated)
+    {
+        for(auto* tensor : activation_tensors)
+        {
+            get_tensor_allocator(*tensor).allocate();
+        }
+        activation_memory_size = unplanned_size;
+        LOGI("Activation memory: {} bytes in {} dedicated buffers.", activation_memory_size, activation_tensors.size());
+        return;
+    }
+
+    // Lifetime of a tensor starts at the layer that produces it and ends at the last layer that reads it.
+    // ACL lifetime managers track it between MemoryGroup::manage() and allocate() calls, so the calls are replayed in the execution order.
+    auto lock = lock_activations();
+    std::unordered_map<const arm_compute::ITensor*, arm_compute::ITensor*> activations;
+    std::unordered_map<const arm_compute::ITensor*, size_t> last_use;
+    for(auto* tensor : activation_tensors)
+    {
+        activations[tensor] = tensor;
+    }
+    for(size_t i = 0; i < layers.size(); i++)
+    {
+        for(const auto* tensor : layers[i].outputs)
+        {
+            last_use[tensor] = i;
+        }
+        for(const auto* tensor : layers[i].inputs)
+        {
+            last_use[tensor] = i;
+        }
+    }
+
+    // Layers running in place have the same tensor as input and output, it's managed only by the layer that produces it first.
+    std::unordered_set<const arm_compute::ITensor*> managed;
+    for(size_t i = 0; i < layers.size(); i++)
+    {
+        for(const auto* tensor : layers[i].outputs)
+        {
+            auto activation = activations.find(tensor);
+            if(activation != activations.end() && managed.insert(tensor).second)
+            {
+                memory_group.manage(dynamic_cast<arm_compute::IMemoryManageable*>(activation->second));
+            }
+        }
+
+        // Outputs that are never read still end their lifetime here, they need memory only while the layer runs.
+        std::vector<const arm_compute::ITensor*> used_tensors = layers[i].inputs;
+        used_tensors.insert(used_tensors.end(), layers[i].outputs.begin(), layers[i].outputs.end());
+        for(const auto* tensor : used_tensors)
+        {
+            auto activation = activations.find(tensor);
+            if(activation != activations.end() && last_use.at(tensor) == i)
+            {
+                get_tensor_allocator(*activation->second).allocate();
+                activations.erase(activation);
+            }
+        }
+    }
+
+    if(!shared_activations)
+    {
+        memory_manager->populate(*allocator, 1);
+    }
+
+    if(memory_mode == ActivationMemoryMode::Blob)
+    {
+        activation_memory_size = 0;
+        for(const auto& blob : std::static_pointer_cast<arm_compute::BlobLifetimeManager>(lifetime_manager)->info())
+        {
+            activation_memory_size += blob.size;
+        }
+    }
+    else
+    {
+        activation_memory_size = std::static_pointer_cast<arm_compute::OffsetLifetimeManager>(lifetime_manager)->info().size;
+    }
+
+    // The pool of shared activations is populated again only when this network needs more memory than the other networks.
+    if(shared_activations && activation_memory_size > shared_activations->pool_size)
+    {
+        if(shared_activations->pool_size > 0)
+        {
+            memory_manager->clear();
+        }
+        memory_manager->populate(*shared_activations->allocator, 1);
+        shared_activations->pool_size = activation_memory_size;
+    }
+
+    // A shared lifetime manager keeps the largest plan of all its groups, the plan of this network alone is not exposed by ACL.
+    if(shared_activations)
+    {
+        LOGI("Activation memory: {} bytes in the shared pool, {} tensors of this network need {} bytes without planning.",
+             activation_memory_size, activation_tensors.size(), unplanned_size);
+    }
+    else
+    {
+        LOGI("Activation memory: {} bytes planned for {} tensors, {} bytes without planning.", activation_memory_size, activation_tensors.size(), unplanned_size);
+    }
+}
+
+std::unique_lock<std::mutex> ACLNetwork::lock_activations()
+{
+    if(shared_activations)
+    {
+        return std::unique_lock<std::mutex>(shared_activations->mutex);
+    }
+    return std::unique_lock<std::mutex>();
+}
 
-    auto tensor = std::make_unique<arm_compute::CLTensor>();
-    tensor->allocator()->init(arm_compute::TensorInfo(shape, 1, arm_compute::DataType::F32, arm_compute::DataLayout::NHWC));
-    tensors.push_back(std::move(tensor));
+std::unique_ptr<arm_compute::ITensor> ACLNetwork::new_tensor(const std::vector<uint32_t> &dims,
+                                                              arm_compute::DataType tensor_data_type,
+                                                              const arm_compute::QuantizationInfo &quantization_info) const
+{
+    auto shape = get_tensor_shape(dims);
+    std::unique_ptr<arm_compute::ITensor> tensor;
+    if(backend == Backend::CL)
+    {
+        tensor = std::make_unique<arm_compute::CLTensor>();
+    }
+    else
+    {
+        tensor = std::make_unique<arm_compute::Tensor>();
+    }
+    get_tensor_allocator(*tensor).init(arm_compute::TensorInfo(shape, 1, tensor_data_type, quantization_info).set_data_layout(arm_compute::DataLayout::NHWC));
+    return tensor;
+}
+
+arm_compute::ITensor& ACLNetwork::make_tensor(const std::vector<uint32_t> &dims,
+                                               arm_compute::DataType tensor_data_type,
+                                               const arm_compute::QuantizationInfo &quantization_info)
+{
+    tensors.push_back(new_tensor(dims, tensor_data_type, quantization_info));
     return *tensors.back();
 }
 
-arm_compute::CLTensor &ACLNetwork::add_addition(const arm_compute::CLTensor &input_a,
-                                                const arm_compute::CLTensor &input_b,
-                                                arm_compute::ActivationLayerInfo::ActivationFunction activation)
+arm_compute::ITensor& ACLNetwork::create_tensor(const std::vector<uint32_t> &dims,
+                                                 arm_compute::DataType tensor_data_type,
+                                                 const arm_compute::QuantizationInfo &quantization_info)
+{
+    auto& tensor = make_tensor(dims, tensor_data_type, quantization_info);
+    activation_tensors.push_back(&tensor);
+    return tensor;
+}
+
+arm_compute::ITensor& ACLNetwork::create_output_tensor(const arm_compute::ITensor &input,
+                                                        const std::vector<uint32_t> &dims,
+                                                        const arm_compute::QuantizationInfo &quantization_info)
+{
+    // Output of a layer has the data type of its input. Quantized outputs keep quantization of the input if it's not specified.
+    const auto& input_info = *input.info();
+    bool keep_quantization = quantization_info.empty() && arm_compute::is_data_type_quantized(input_info.data_type());
+    return create_tensor(get_batched_dims(dims, input), input_info.data_type(), keep_quantization ? input_info.quantization_info() : quantization_info);
+}
+
+arm_compute::ITensor& ACLNetwork::create_constant_tensor(const std::vector<uint32_t> &dims,
+                                                          arm_compute::DataType tensor_data_type,
+                                                          const arm_compute::QuantizationInfo &quantization_info)
+{
+    if(shared_weights)
+    {
+        // The first network that creates the layer adds its tensors, the later networks take them in the same order.
+        auto& shared_tensors = shared_weights->tensors;
+        if(shared_weights_used == shared_tensors.size())
+        {
+            shared_tensors.push_back(new_tensor(dims, tensor_data_type, quantization_info));
+        }
+        auto& tensor = *shared_tensors[shared_weights_used++];
+        if(tensor.info()->tensor_shape() != get_tensor_shape(dims) || tensor.info()->data_type() != tensor_data_type)
+        {
+            throw std::runtime_error("Shared weights don't match the layers of the network.");
+        }
+        return tensor;
+    }
+
+    auto& tensor = make_tensor(dims, tensor_data_type, quantization_info);
+    constant_tensors.push_back(&tensor);
+    return tensor;
+}
+
+arm_compute::ITensor& ACLNetwork::create_kernel_tensor(const arm_compute::ITensor &input,
+                                                        const std::vector<uint32_t> &dims,
+                                                        const ConstantValues &values,
+                                                        uint32_t channels,
+                                                        uint32_t channel_inner_size)
+{
+    if(arm_compute::is_data_type_quantized(input.info()->data_type()))
+    {
+        // Weights of a precompiled network are already quantized.
+        auto scales = values.get_data_type() == arm_compute::DataType::QSYMM8_PER_CHANNEL ? values.get_scales() : calculate_per_channel_scales(values, channels, channel_inner_size);
+        return create_constant_tensor(dims, arm_compute::DataType::QSYMM8_PER_CHANNEL, arm_compute::QuantizationInfo(scales));
+    }
+    return create_constant_tensor(dims, input.info()->data_type());
+}
+
+arm_compute::ITensor& ACLNetwork::create_bias_tensor(const arm_compute::ITensor &input, const std::vector<uint32_t> &dims)
+{
+    if(arm_compute::is_data_type_quantized(input.info()->data_type()))
+    {
+        return create_constant_tensor(dims, arm_compute::DataType::S32);
+    }
+    return create_constant_tensor(dims, input.info()->data_type());
+}
+
+uint8_t* ACLNetwork::stage_constant_tensor(arm_compute::ITensor& tensor)
+{
+    if(backend == Backend::CPU)
+    {
+        return tensor.buffer();
+    }
+
+    // Regions are aligned to cache lines, so that the copies don't share them.
+    const size_t alignment = 64;
+    size_t offset = (weights_staging.size() + alignment - 1) / alignment * alignment;
+    weights_staging.resize(offset + tensor.info()->total_size());
+    staged_tensors.push_back({&tensor, offset});
+    return weights_staging.data() + offset;
+}
+
+void ACLNetwork::upload_weights()
+{
+    if(staged_tensors.empty())
+    {
+        return;
+    }
+
+    vkb::Timer timer;
+    timer.start();
+
+    // Mapping each tensor blocks the queue for every kernel and bias. Instead, the staging buffer is written once
+    // and the tensors are filled by copies on the device, which are only enqueued.
+    auto& scheduler = arm_compute::CLScheduler::get();
+    cl::Buffer staging_buffer(scheduler.context(), CL_MEM_READ_ONLY | CL_MEM_ALLOC_HOST_PTR, weights_staging.size());
+    scheduler.queue().enqueueWriteBuffer(staging_buffer, CL_FALSE, 0, weights_staging.size(), weights_staging.data());
+    for(const auto& staged : staged_tensors)
+    {
+        scheduler.queue().enqueueCopyBuffer(staging_buffer, as_cl_tensor(*staged.tensor)->cl_buffer(), staged.offset, 0, staged.tensor->info()->total_size());
+    }
+    scheduler.sync();
+
+    LOGI("Weights: {} bytes uploaded to {} tensors in {:.2f} ms ({:.2f} ms converting), 1 host transfer instead of {} map/unmap round trips.",
+         weights_staging.size(), staged_tensors.size(), weights_staging_time + timer.stop<vkb::Timer::Milliseconds>(), weights_staging_time,
+         staged_tensors.size());
+
+    // The staging memory is needed only once.
+    std::vector<uint8_t>().swap(weights_staging);
+    staged_tensors.clear();
+}
+
+void ACLNetwork::add_blended_weights(const arm_compute::ITensor& input,
+                                     arm_compute::ITensor& kernel,
+                                     const ConstantValues& kernel_values,
+                                     arm_compute::ITensor& bias,
+                                     const ConstantValues& bias_values,
+                                     uint32_t channel_inner_size,
+                                     bool flip_kernel)
+{
+    // Both sets have the layout of the tensors the layer reads, including the padding the function may have added.
+    auto copy_tensor = [this](const arm_compute::ITensor& tensor) -> arm_compute::ITensor&
+    {
+        auto& copy = make_tensor({}, tensor.info()->data_type(), tensor.info()->quantization_info());
+        get_tensor_allocator(copy).init(arm_compute::TensorInfo(*tensor.info()));
+        constant_tensors.push_back(&copy);
+        return copy;
+    };
+
+    auto weights = std::make_unique<BlendedWeights>();
+    weights->input = &input;
+    weights->channel_inner_size = channel_inner_size;
+    weights->flip_kernel = flip_kernel;
+    weights->kernel = &kernel;
+    weights->bias = &bias;
+    weights->first_kernel = &copy_tensor(kernel);
+    weights->first_bias = &copy_tensor(bias);
+    weights->second_kernel = &copy_tensor(kernel);
+    weights->second_bias = &copy_tensor(bias);
+
+    // The tensors the layer reads are written only by the blending.
+    get_tensor_allocator(kernel).allocate();
+    get_tensor_allocator(bias).allocate();
+    if(flip_kernel)
+    {
+        set_weights_values(input, *weights->first_kernel, flip_kernel_values(kernel_values, kernel.info()->tensor_shape()),
+                           *weights->first_bias, bias_values, channel_inner_size);
+    }
+    else
+    {
+        set_weights_values(input, *weights->first_kernel, kernel_values, *weights->first_bias, bias_values, channel_inner_size);
+    }
+    blended_weights.push_back(std::move(weights));
+}
+
+void ACLNetwork::blend_weights()
+{
+    for(auto& weights : blended_weights)
+    {
+        weights->kernel_blending.set_factor(blend_factor);
+        weights->kernel_blending.run();
+        weights->bias_blending.set_factor(blend_factor);
+        weights->bias_blending.run();
+    }
+    blend_pending = false;
+}
+
+void ACLNetwork::set_weights_values(const arm_compute::ITensor &input,
+                                    arm_compute::ITensor &kernel,
+                                    const ConstantValues &kernel_values,
+                                    arm_compute::ITensor &bias,
+                                    const ConstantValues &bias_values,
+                                    uint32_t channel_inner_size)
+{
+    // Shared weights that another network created are already allocated and uploaded.
+    if(!kernel.info()->is_resizable() && !bias.info()->is_resizable())
+    {
+        return;
+    }
+
+    get_tensor_allocator(kernel).allocate();
+    get_tensor_allocator(bias).allocate();
+
+    vkb::Timer timer;
+    timer.start();
+    auto* kernel_staging = stage_constant_tensor(kernel);
+    auto* bias_staging = stage_constant_tensor(bias);
+
+    // Values that are already converted (precompiled network) are only copied.
+    bool kernel_converted = kernel_values.get_data_type() == kernel.info()->data_type();
+    bool bias_converted = bias_values.get_data_type() == bias.info()->data_type();
+    if(kernel_converted && bias_converted)
+    {
+        write_tensor_raw_values(*kernel.info(), kernel_staging, kernel_values.raw_data());
+        write_tensor_raw_values(*bias.info(), bias_staging, bias_values.raw_data());
+    }
+    else if(kernel_values.get_data_type() != arm_compute::DataType::F32 || bias_values.get_data_type() != arm_compute::DataType::F32)
+    {
+        throw std::runtime_error("Weights don't match the data type of the network.");
+    }
+    // Values are converted while they are copied from the model to the staging buffer, without any other intermediate buffers.
+    else if(arm_compute::is_data_type_quantized(input.info()->data_type()))
+    {
+        const auto& scales = kernel.info()->quantization_info().scale();
+        float input_scale = input.info()->quantization_info().uniform().scale;
+        std::vector<float> bias_scales(scales.size());
+        for(size_t i = 0; i < scales.size(); i++)
+        {
+            bias_scales[i] = input_scale * scales[i];
+        }
+        write_tensor_quantized_values(*kernel.info(), kernel_staging, kernel_values.data(), scales, channel_inner_size);
+        write_tensor_quantized_values(*bias.info(), bias_staging, bias_values.data(), bias_scales, 1);
+    }
+    else
+    {
+        write_tensor_values(*kernel.info(), kernel_staging, kernel_values.data());
+        write_tensor_values(*bias.info(), bias_staging, bias_values.data());
+    }
+    weights_staging_time += timer.stop<vkb::Timer::Milliseconds>();
+}
+
+arm_compute::ITensor &ACLNetwork::add_addition(const arm_compute::ITensor &input_a,
+                                                const arm_compute::ITensor &input_b,
+                                                arm_compute::ActivationLayerInfo::ActivationFunction activation,
+                                                const arm_compute::QuantizationInfo &output_quantization)
 {
     auto input_shape = input_a.info()->tensor_shape();
 
-    auto& output = create_tensor({(uint32_t)input_shape[0], (uint32_t)input_shape[1], (uint32_t)input_shape[2]});
+    auto& output = create_output_tensor(input_a, {(uint32_t)input_shape[0], (uint32_t)input_shape[1], (uint32_t)input_shape[2]}, output_quantization);
 
+    // Quantized addition requires saturation.
+    auto convert_policy = arm_compute::is_data_type_quantized(input_a.info()->data_type()) ? arm_compute::ConvertPolicy::SATURATE : arm_compute::ConvertPolicy::WRAP;
     arm_compute::ActivationLayerInfo activation_info(activation);
-    auto add = std::make_unique<arm_compute::CLArithmeticAddition>();
-    add->configure((arm_compute::ICLTensor *) &input_a, (arm_compute::ICLTensor *) &input_b, &output, arm_compute::ConvertPolicy(), activation_info);
-    functions.push_back(std::move(add));
-
-    output.allocator()->allocate();
+    auto add = create_function<arm_compute::CLArithmeticAddition, arm_compute::NEArithmeticAddition>(backend, [&](auto& function, auto tensor)
+    {
+        function.configure(tensor(input_a), tensor(input_b), tensor(output), convert_policy, activation_info);
+    });
+    add_function(std::move(add), "Addition", {&input_a, &input_b}, {&output});
 
     return output;
 }
 
-arm_compute::CLTensor &ACLNetwork::add_activation(const arm_compute::CLTensor &input,
+arm_compute::ITensor &ACLNetwork::add_activation(const arm_compute::ITensor &input,
                                                   arm_compute::ActivationLayerInfo::ActivationFunction activation,
                                                   float a,
-                                                  float b)
+                                                  float b,
+                                                  const arm_compute::QuantizationInfo &output_quantization,
+                                                  bool in_place)
 {
     auto input_shape = input.info()->tensor_shape();
 
-    auto& output = create_tensor({(uint32_t)input_shape[0], (uint32_t)input_shape[1], (uint32_t)input_shape[2]});
-
-    auto add = std::make_unique<arm_compute::CLActivationLayer>();
-    add->configure((arm_compute::ICLTensor *) &input, &output, arm_compute::ActivationLayerInfo(activation, a, b));
-    functions.push_back(std::move(add));
+    arm_compute::ActivationLayerInfo activation_info(activation, a, b);
+    if(in_place)
+    {
+        // The result overwrites the input, so no output tensor is created.
+        auto& output = const_cast<arm_compute::ITensor&>(input);
+        auto activation_layer = create_function<arm_compute::CLActivationLayer, arm_compute::NEActivationLayer>(backend, [&](auto& function, auto tensor)
+        {
+            function.configure(tensor(output), nullptr, activation_info);
+        });
+        add_function(std::move(activation_layer), "Activation", {&input}, {&output});
+        return output;
+    }
 
-    output.allocator()->allocate();
+    auto& output = create_output_tensor(input, {(uint32_t)input_shape[0], (uint32_t)input_shape[1], (uint32_t)input_shape[2]}, output_quantization);
+    auto activation_layer = create_function<arm_compute::CLActivationLayer, arm_compute::NEActivationLayer>(backend, [&](auto& function, auto tensor)
+    {
+        function.configure(tensor(input), tensor(output), activation_info);
+    });
+    add_function(std::move(activation_layer), "Activation", {&input}, {&output});
 
     return output;
 }
 
-arm_compute::CLTensor &ACLNetwork::add_pad(const arm_compute::CLTensor &input, uint32_t pad_x, uint32_t pad_y)
+arm_compute::ITensor &ACLNetwork::add_pad(const arm_compute::ITensor &input, uint32_t pad_x, uint32_t pad_y)
 {
     auto input_shape = input.info()->tensor_shape();
     uint32_t output_width = input_shape[1] + pad_x * 2;
@@ -99,16 +945,19 @@ arm_compute::CLTensor &ACLNetwork::add_pad(const arm_compute::CLTensor &input, u
     padding_list.push_back(arm_compute::PaddingInfo{pad_x, pad_x});
     padding_list.push_back(arm_compute::PaddingInfo{pad_y, pad_y});
 
-    auto& output = create_tensor({(uint32_t)input_shape[0], output_width, output_height});
-    auto pad = std::make_unique<arm_compute::CLPadLayer>();
-    pad->configure((arm_compute::ICLTensor *) &input, &output, padding_list);
-    functions.push_back(std::move(pad));
+    auto& output = create_output_tensor(input, {(uint32_t)input_shape[0], output_width, output_height});
+    // Quantized tensors are padded with the zero point, so that the padding still represents 0.
+    arm_compute::PixelValue pad_value(0.0, input.info()->data_type(), input.info()->quantization_info());
+    auto pad = create_function<arm_compute::CLPadLayer, arm_compute::NEPadLayer>(backend, [&](auto& function, auto tensor)
+    {
+        function.configure(tensor(input), tensor(output), padding_list, pad_value);
+    });
+    add_function(std::move(pad), "Pad", {&input}, {&output});
 
-    output.allocator()->allocate();
     return output;
 }
 
-arm_compute::CLTensor &ACLNetwork::add_conv2d(const arm_compute::CLTensor& input,
+arm_compute::ITensor &ACLNetwork::add_conv2d(const arm_compute::ITensor& input,
                                               uint32_t kernel_width,
                                               uint32_t kernel_height,
                                               uint32_t output_features,
@@ -118,11 +967,13 @@ arm_compute::CLTensor &ACLNetwork::add_conv2d(const arm_compute::CLTensor& input
                                               uint32_t pad_y_back,
                                               uint32_t stride_x,
                                               uint32_t stride_y,
-                                              const std::vector<float>& kernel_values,
-                                              const std::vector<float>& bias_values,
+                                              const ConstantValues& kernel_values,
+                                              const ConstantValues& bias_values,
                                               arm_compute::ActivationLayerInfo::ActivationFunction activation,
                                               uint32_t dilation_x,
-                                              uint32_t dilation_y)
+                                              uint32_t dilation_y,
+                                              const arm_compute::QuantizationInfo &output_quantization,
+                                              const arm_compute::ConvolutionMethod *convolution_method)
 {
     arm_compute::TensorShape input_shape = input.info()->tensor_shape();
 
@@ -134,35 +985,117 @@ arm_compute::CLTensor &ACLNetwork::add_conv2d(const arm_compute::CLTensor& input
                                                         std::max(pad_y_front, pad_y_back), stride_y,
                                                         dilation_y);
 
-    auto& kernel = create_tensor({ input_features, kernel_width, kernel_height, output_features });
-    auto& bias = create_tensor({output_features});
-    auto& output = create_tensor({output_features, output_width, output_height});
+    // Kernel values are ordered as [output_features][kernel_height][kernel_width][input_features].
+    uint32_t channel_inner_size = input_features * kernel_width * kernel_height;
+    auto& kernel = create_kernel_tensor(input, { input_features, kernel_width, kernel_height, output_features }, kernel_values, output_features, channel_inner_size);
+    auto& bias = create_bias_tensor(input, {output_features});
+    auto& output = create_output_tensor(input, {output_features, output_width, output_height}, output_quantization);
 
-    auto conv = std::make_unique<arm_compute::CLConvolutionLayer>();
     arm_compute::PadStrideInfo pad_stride_info(stride_x, stride_y, pad_x_front, pad_x_back, pad_y_front, pad_y_back, arm_compute::DimensionRoundingType::FLOOR);
     arm_compute::WeightsInfo weights_info;
     arm_compute::Size2D dilation(dilation_x, dilation_y);
     arm_compute::ActivationLayerInfo activation_info(activation);
 
-    auto status = conv->validate(input.info(), kernel.info(), bias.info(), output.info(), pad_stride_info, weights_info, dilation, activation_info);
-    if(!status)
+    if(backend == Backend::CPU)
     {
-        LOGE("Conv2D error, description: {}", status.error_description().c_str());
+        // Stored methods were chosen for the GPU, NEConvolutionLayer chooses the method for the CPU itself.
+        if(validate_layers)
+        {
+            check_layer("Conv2D", arm_compute::NEConvolutionLayer::validate(input.info(), kernel.info(), bias.info(), output.info(), pad_stride_info, weights_info, dilation, activation_info));
+        }
+        auto conv = std::make_unique<arm_compute::NEConvolutionLayer>();
+        conv->configure(as_cpu_tensor(input), &kernel, &bias, &output, pad_stride_info, weights_info, dilation, activation_info);
+        add_function(std::move(conv), "Conv2D", {&input, &kernel, &bias}, {&output});
+        convolution_methods.push_back(arm_compute::NEConvolutionLayer::get_convolution_method(input.info(), kernel.info(), output.info(), pad_stride_info,
+                                                                                              weights_info, dilation, activation_info));
+        set_weights_values(input, kernel, kernel_values, bias, bias_values, channel_inner_size);
+        return output;
     }
-    conv->configure((arm_compute::ICLTensor*)&input, &kernel, &bias, &output, pad_stride_info, weights_info, dilation, activation_info);
-    functions.push_back(std::move(conv));
 
-    output.allocator()->allocate();
-    kernel.allocator()->allocate();
-    bias.allocator()->allocate();
+    if(validate_layers)
+    {
+        check_layer("Conv2D", arm_compute::CLConvolutionLayer::validate(input.info(), kernel.info(), bias.info(), output.info(), pad_stride_info, weights_info, dilation, activation_info));
+    }
+
+    // Blended weights change after the functions are prepared, only the direct convolution reads them in each run.
+    if(weight_blending)
+    {
+        if(dilation_x != 1 || dilation_y != 1)
+        {
+            throw std::runtime_error("Conv2D layers with dilation cannot blend the weights.");
+        }
+        auto status = arm_compute::CLDirectConvolutionLayer::validate(input.info(), kernel.info(), bias.info(), output.info(), pad_stride_info, activation_info);
+        if(!status)
+        {
+            throw std::runtime_error("Conv2D cannot blend the weights: " + status.error_description());
+        }
+    }
+
+    // A method that was chosen on another device is replaced by the one CLConvolutionLayer chooses if this device doesn't support it.
+    if(validate_layers && convolution_method && !weight_blending)
+    {
+        auto status = validate_convolution_method(*convolution_method, input.info(), kernel.info(), bias.info(), output.info(), pad_stride_info,
+                                                  weights_info, dilation, activation_info);
+        if(!status)
+        {
+            LOGW("Stored Conv2D method is not supported ({}), the method is chosen again", status.error_description());
+            convolution_method = nullptr;
+        }
+    }
 
-    set_tensor_values(kernel, kernel_values);
-    set_tensor_values(bias, bias_values);
+    // The method is the one CLConvolutionLayer would choose, unless it was already chosen (e.g. for a precompiled network).
+    auto method = weight_blending ? arm_compute::ConvolutionMethod::DIRECT :
+                  convolution_method ? *convolution_method :
+                                       arm_compute::CLConvolutionLayer::get_convolution_method(input.info(), kernel.info(), output.info(), pad_stride_info, weights_info,
+                                                                                               activation_info, arm_compute::CLScheduler::get().target(), dilation);
+    auto* cl_input = as_cl_tensor(input);
+    auto* cl_kernel = as_cl_tensor(kernel);
+    auto* cl_bias = as_cl_tensor(bias);
+    auto* cl_output = as_cl_tensor(output);
+    switch(method)
+    {
+        case arm_compute::ConvolutionMethod::GEMM:
+        {
+            auto conv = std::make_unique<arm_compute::CLGEMMConvolutionLayer>();
+            conv->configure(cl_input, cl_kernel, cl_bias, cl_output, pad_stride_info, weights_info, dilation, activation_info);
+            add_function(std::move(conv), "Conv2D GEMM", {&input, &kernel, &bias}, {&output});
+            break;
+        }
+        case arm_compute::ConvolutionMethod::DIRECT:
+        {
+            auto conv = std::make_unique<arm_compute::CLDirectConvolutionLayer>();
+            conv->configure(cl_input, cl_kernel, cl_bias, cl_output, pad_stride_info, activation_info);
+            add_function(std::move(conv), "Conv2D Direct", {&input, &kernel, &bias}, {&output});
+            break;
+        }
+        case arm_compute::ConvolutionMethod::WINOGRAD:
+        {
+            auto conv = std::make_unique<arm_compute::CLWinogradConvolutionLayer>();
+            conv->configure(cl_input, cl_kernel, cl_bias, cl_output, pad_stride_info, activation_info);
+            add_function(std::move(conv), "Conv2D Winograd", {&input, &kernel, &bias}, {&output});
+            break;
+        }
+        default:
+        {
+            auto conv = std::make_unique<arm_compute::CLConvolutionLayer>();
+            conv->configure(cl_input, cl_kernel, cl_bias, cl_output, pad_stride_info, weights_info, dilation, activation_info);
+            add_function(std::move(conv), "Conv2D", {&input, &kernel, &bias}, {&output});
+            break;
+        }
+    }
+    convolution_methods.push_back(method);
+
+    if(weight_blending)
+    {
+        add_blended_weights(input, kernel, kernel_values, bias, bias_values, channel_inner_size, false);
+        return output;
+    }
+    set_weights_values(input, kernel, kernel_values, bias, bias_values, channel_inner_size);
 
     return output;
 }
 
-arm_compute::CLTensor &ACLNetwork::add_depthwise_conv2d(const arm_compute::CLTensor &input,
+arm_compute::ITensor &ACLNetwork::add_depthwise_conv2d(const arm_compute::ITensor &input,
                                                         uint32_t kernel_width,
                                                         uint32_t kernel_height,
                                                         uint32_t pad_x_front,
@@ -171,11 +1104,12 @@ arm_compute::CLTensor &ACLNetwork::add_depthwise_conv2d(const arm_compute::CLTen
                                                         uint32_t pad_y_back,
                                                         uint32_t stride_x,
                                                         uint32_t stride_y,
-                                                        const std::vector<float> &kernel_values,
-                                                        const std::vector<float> &bias_values,
+                                                        const ConstantValues &kernel_values,
+                                                        const ConstantValues &bias_values,
                                                         arm_compute::ActivationLayerInfo::ActivationFunction activation,
                                                         uint32_t dilation_x,
-                                                        uint32_t dilation_y)
+                                                        uint32_t dilation_y,
+                                                        const arm_compute::QuantizationInfo &output_quantization)
 {
     arm_compute::TensorShape input_shape = input.info()->tensor_shape();
 
@@ -187,34 +1121,38 @@ arm_compute::CLTensor &ACLNetwork::add_depthwise_conv2d(const arm_compute::CLTen
                                                         std::max(pad_y_front, pad_y_back), stride_y,
                                                         dilation_y);
 
-    auto& kernel = create_tensor({ input_features, kernel_width, kernel_height });
-    auto& bias = create_tensor({input_features});
-    auto& output = create_tensor({input_features, output_width, output_height});
+    // Kernel values are ordered as [kernel_height][kernel_width][input_features].
+    uint32_t channel_inner_size = 1;
+    auto& kernel = create_kernel_tensor(input, { input_features, kernel_width, kernel_height }, kernel_values, input_features, channel_inner_size);
+    auto& bias = create_bias_tensor(input, {input_features});
+    auto& output = create_output_tensor(input, {input_features, output_width, output_height}, output_quantization);
 
-    auto conv = std::make_unique<arm_compute::CLDepthwiseConvolutionLayer>();
     arm_compute::PadStrideInfo pad_stride_info(stride_x, stride_y, pad_x_front, pad_x_back, pad_y_front, pad_y_back, arm_compute::DimensionRoundingType::FLOOR);
     arm_compute::ActivationLayerInfo activation_info(activation);
     arm_compute::Size2D dilations(dilation_x, dilation_y);
 
-    auto status = conv->validate(input.info(), kernel.info(), bias.info(), output.info(), pad_stride_info, 1, activation_info, dilations);
-    if(!status)
+    auto conv = create_function<arm_compute::CLDepthwiseConvolutionLayer, arm_compute::NEDepthwiseConvolutionLayer>(backend, [&](auto& function, auto tensor)
+    {
+        if(validate_layers)
+        {
+            check_layer("DepthwiseConv2D", function.validate(input.info(), kernel.info(), bias.info(), output.info(), pad_stride_info, 1, activation_info, dilations));
+        }
+        function.configure(tensor(input), tensor(kernel), tensor(bias), tensor(output), pad_stride_info, 1, activation_info, dilations);
+    });
+    add_function(std::move(conv), "DepthwiseConv2D", {&input, &kernel, &bias}, {&output});
+
+    // The NHWC function reads the weights in each run, so they can be blended.
+    if(weight_blending)
     {
-        LOGE("DepthwiseConv2D error, description: {}", status.error_description().c_str());
+        add_blended_weights(input, kernel, kernel_values, bias, bias_values, channel_inner_size, false);
+        return output;
     }
-    conv->configure((arm_compute::ICLTensor*)&input, &kernel, &bias, &output, pad_stride_info, 1, activation_info, dilations);
-    functions.push_back(std::move(conv));
-
-    output.allocator()->allocate();
-    kernel.allocator()->allocate();
-    bias.allocator()->allocate();
-
-    set_tensor_values(kernel, kernel_values);
-    set_tensor_values(bias, bias_values);
+    set_weights_values(input, kernel, kernel_values, bias, bias_values, channel_inner_size);
 
     return output;
 }
 
-arm_compute::CLTensor &ACLNetwork::add_conv2d_transpose(const arm_compute::CLTensor &input,
+arm_compute::ITensor &ACLNetwork::add_conv2d_transpose(const arm_compute::ITensor &input,
                                                         uint32_t kernel_width,
                                                         uint32_t kernel_height,
                                                         uint32_t output_features,
@@ -224,8 +1162,9 @@ arm_compute::CLTensor &ACLNetwork::add_conv2d_transpose(const arm_compute::CLTen
                                                         uint32_t pad_y_back,
                                                         uint32_t stride_x,
                                                         uint32_t stride_y,
-                                                        const std::vector<float> &kernel_values,
-                                                        const std::vector<float> &bias_values)
+                                                        const ConstantValues &kernel_values,
+                                                        const ConstantValues &bias_values,
+                                                        const arm_compute::QuantizationInfo &output_quantization)
 {
     arm_compute::TensorShape input_shape = input.info()->tensor_shape();
 
@@ -237,110 +1176,124 @@ arm_compute::CLTensor &ACLNetwork::add_conv2d_transpose(const arm_compute::CLTen
                                                           std::max(pad_y_front, pad_y_back),
                                                           stride_y);
 
-    auto& kernel = create_tensor({ input_features, kernel_width, kernel_height, output_features });
-    auto& bias = create_tensor({output_features});
-    auto& output = create_tensor({output_features, output_width, output_height});
+    // Kernel values are ordered as [output_features][kernel_height][kernel_width][input_features].
+    uint32_t channel_inner_size = input_features * kernel_width * kernel_height;
+    auto& kernel = create_kernel_tensor(input, { input_features, kernel_width, kernel_height, output_features }, kernel_values, output_features, channel_inner_size);
+    auto& bias = create_bias_tensor(input, {output_features});
+    auto& output = create_output_tensor(input, {output_features, output_width, output_height}, output_quantization);
 
-    auto deconv = std::make_unique<arm_compute::CLDeconvolutionLayer>();
     arm_compute::PadStrideInfo pad_stride_info(stride_x, stride_y, pad_x_front, pad_x_back, pad_y_front, pad_y_back, arm_compute::DimensionRoundingType::FLOOR);
 
-    auto status = deconv->validate(input.info(), kernel.info(), bias.info(), output.info(), pad_stride_info);
-    if(!status)
+    // CLDeconvolutionLayer flips the weights when it's prepared, so blended weights are flipped on the host instead and the layer
+    // is split into the upsampling and the direct convolution the same way CLDirectDeconvolutionLayer does it.
+    if(weight_blending)
     {
-        LOGE("Conv2DTranspose error, description: {}", status.error_description().c_str());
+        auto output_dims = arm_compute::deconvolution_output_dimensions(input_shape[1], input_shape[2], kernel_width, kernel_height, pad_stride_info);
+        uint32_t deconv_pad_x = 0;
+        uint32_t deconv_pad_y = 0;
+        auto upsampled_shape = arm_compute::misc::shape_calculator::compute_deconvolution_upsampled_shape(*input.info(), *kernel.info(), stride_x, stride_y,
+                                                                                                         output_dims, deconv_pad_x, deconv_pad_y);
+
+        uint32_t pad_left = pad_x_back > pad_x_front ? pad_x_back - pad_x_front : 0;
+        uint32_t pad_right = pad_x_front > pad_x_back ? pad_x_front - pad_x_back : 0;
+        uint32_t pad_top = pad_y_back > pad_y_front ? pad_y_back - pad_y_front : 0;
+        uint32_t pad_bottom = pad_y_front > pad_y_back ? pad_y_front - pad_y_back : 0;
+        deconv_pad_x -= pad_left + pad_right;
+        deconv_pad_y -= pad_top + pad_bottom;
+        pad_left += deconv_pad_x / 2;
+        pad_right += deconv_pad_x / 2;
+        pad_top += deconv_pad_y / 2;
+        pad_bottom += deconv_pad_y / 2;
+
+        auto& upsampled = create_output_tensor(input, {input_features, (uint32_t)upsampled_shape[1], (uint32_t)upsampled_shape[2]});
+        arm_compute::PadStrideInfo upsample_info(stride_x, stride_y, pad_left, pad_right, pad_top, pad_bottom, arm_compute::DimensionRoundingType::FLOOR);
+        arm_compute::PadStrideInfo conv_info(1, 1, 0, 0, 0, 0, arm_compute::DimensionRoundingType::CEIL);
+        if(validate_layers)
+        {
+            check_layer("Conv2DTranspose", arm_compute::CLDeconvolutionLayerUpsample::validate(input.info(), upsampled.info(), upsample_info));
+            check_layer("Conv2DTranspose", arm_compute::CLDirectConvolutionLayer::validate(upsampled.info(), kernel.info(), bias.info(), output.info(), conv_info));
+        }
+
+        auto upsample = std::make_unique<arm_compute::CLDeconvolutionLayerUpsample>();
+        upsample->configure(as_cl_tensor(input), as_cl_tensor(upsampled), upsample_info);
+        add_function(std::move(upsample), "TransposeConv2D Upsample", {&input}, {&upsampled});
+
+        auto conv = std::make_unique<arm_compute::CLDirectConvolutionLayer>();
+        conv->configure(as_cl_tensor(upsampled), as_cl_tensor(kernel), as_cl_tensor(bias), as_cl_tensor(output), conv_info);
+        add_function(std::move(conv), "TransposeConv2D Direct", {&upsampled, &kernel, &bias}, {&output});
+
+        add_blended_weights(input, kernel, kernel_values, bias, bias_values, channel_inner_size, true);
+        return output;
     }
-    deconv->configure((arm_compute::ICLTensor *) &input, &kernel, &bias, &output, pad_stride_info);
-    functions.push_back(std::move(deconv));
 
-    output.allocator()->allocate();
-    kernel.allocator()->allocate();
-    bias.allocator()->allocate();
+    auto deconv = create_function<arm_compute::CLDeconvolutionLayer, arm_compute::NEDeconvolutionLayer>(backend, [&](auto& function, auto tensor)
+    {
+        if(validate_layers)
+        {
+            check_layer("Conv2DTranspose", function.validate(input.info(), kernel.info(), bias.info(), output.info(), pad_stride_info));
+        }
+        function.configure(tensor(input), tensor(kernel), tensor(bias), tensor(output), pad_stride_info);
+    });
+    add_function(std::move(deconv), "TransposeConv2D", {&input, &kernel, &bias}, {&output});
 
-    set_tensor_values(kernel, kernel_values);
-    set_tensor_values(bias, bias_values);
+    set_weights_values(input, kernel, kernel_values, bias, bias_values, channel_inner_size);
 
     return output;
 }
 
-arm_compute::CLTensor &ACLNetwork::add_dequantization(const arm_compute::CLTensor &input)
+arm_compute::ITensor &ACLNetwork::add_dequantization(const arm_compute::ITensor &input)
 {
     auto input_shape = input.info()->tensor_shape();
 
-    auto& output = create_tensor({(uint32_t)input_shape[0], (uint32_t)input_shape[1], (uint32_t)input_shape[2]});
-    auto dequantization = std::make_unique<arm_compute::CLDequantizationLayer>();
-    dequantization->configure(&input, &output);
-    functions.push_back(std::move(dequantization));
+    auto& output = create_tensor(get_batched_dims({(uint32_t)input_shape[0], (uint32_t)input_shape[1], (uint32_t)input_shape[2]}, input), get_float_data_type());
+    auto dequantization = create_function<arm_compute::CLDequantizationLayer, arm_compute::NEDequantizationLayer>(backend, [&](auto& function, auto tensor)
+    {
+        function.configure(tensor(input), tensor(output));
+    });
+    add_function(std::move(dequantization), "Dequantization", {&input}, {&output});
 
-    output.allocator()->allocate();
     return output;
 }
 
-void ACLNetwork::add_quantization(const arm_compute::CLTensor &input, const arm_compute::CLTensor &output)
-{
-    auto quantization = std::make_unique<arm_compute::CLQuantizationLayer>();
-    quantization->configure(&input, (arm_compute::ICLTensor *) &output);
-    functions.push_back(std::move(quantization));
-}
-
-arm_compute::CLTensor &ACLNetwork::add_linear_to_srgb(const arm_compute::CLTensor &input)
+arm_compute::ITensor &ACLNetwork::add_quantization(const arm_compute::ITensor &input, const arm_compute::QuantizationInfo &quantization_info)
 {
-    // We first need to normalize values to [0, 1] (during this step we also multiply all the values by 'brightness_adjustment' to make the image brighter).
-    // Then the values are calculated as (x ** (1 / 2.4)) * 269.025 - 14.025. These values are again in range [0, 255].
-
-    arm_compute::TensorShape input_shape = input.info()->tensor_shape();
-
-    float brightness_adjustment = 1.7f;
-    auto& input_normalized = add_activation(input, arm_compute::ActivationLayerInfo::ActivationFunction::LINEAR, 1.0f / 255.0f * brightness_adjustment, 0.0f);
-
-    auto& output = create_tensor({(uint32_t)input_shape[0], (uint32_t)input_shape[1], (uint32_t)input_shape[2]});
-    auto& multiplier = create_tensor({1});
-
-    arm_compute::ActivationLayerInfo act_info(arm_compute::ActivationLayerInfo::ActivationFunction::LINEAR, 269.025, -14.025);
-
-    auto elementwise_pow = std::make_unique<arm_compute::CLElementwisePower>();
-    auto status = elementwise_pow->validate(input_normalized.info(), multiplier.info(), output.info(), act_info);
-    if(!status)
-    {
-        LOGE("ElementwisePower error, description: {}", status.error_description().c_str());
-    }
-    elementwise_pow->configure((arm_compute::ICLTensor *) &input_normalized, &multiplier, &output, act_info);
-    functions.push_back(std::move(elementwise_pow));
-
-    multiplier.allocator()->allocate();
-    output.allocator()->allocate();
+    auto input_shape = input.info()->tensor_shape();
 
-    set_tensor_values(multiplier, {1.0f / 2.4f});
+    auto& output = create_tensor(get_batched_dims({(uint32_t)input_shape[0], (uint32_t)input_shape[1], (uint32_t)input_shape[2]}, input),
+                                 arm_compute::DataType::QASYMM8, quantization_info);
+    add_quantization(input, output);
 
     return output;
 }
 
-arm_compute::CLTensor &ACLNetwork::add_srgb_to_linear(const arm_compute::CLTensor &input)
+void ACLNetwork::add_quantization(const arm_compute::ITensor &input, const arm_compute::ITensor &output)
 {
-    // We first need to normalize values to [0, 1].
-    // Then the values are calculated as (((x + 0.055) / 1.055) ** 2.4) * 255. These values are again in range [0, 255].
+    auto quantization = create_function<arm_compute::CLQuantizationLayer, arm_compute::NEQuantizationLayer>(backend, [&](auto& function, auto tensor)
+    {
+        function.configure(tensor(input), tensor(output));
+    });
+    add_function(std::move(quantization), "Quantization", {&input}, {&output});
+}
 
+arm_compute::ITensor &ACLNetwork::add_color_conversion(const arm_compute::ITensor &input,
+                                                        uint32_t channels,
+                                                        const ColorConversionInfo &info,
+                                                        arm_compute::DataType output_data_type,
+                                                        const arm_compute::QuantizationInfo &output_quantization)
+{
     arm_compute::TensorShape input_shape = input.info()->tensor_shape();
-    auto& output = create_tensor({(uint32_t)input_shape[0], (uint32_t)input_shape[1], (uint32_t)input_shape[2]});
 
-    auto& input_normalized = add_activation(input, arm_compute::ActivationLayerInfo::ActivationFunction::LINEAR, 1.0f / 255.0f, 0.055f);
-    auto& input_divided = add_activation(input, arm_compute::ActivationLayerInfo::ActivationFunction::LINEAR, 1.0f / 1.055f, 0.0f);
+    auto& output = create_tensor(get_batched_dims({channels, (uint32_t)input_shape[1], (uint32_t)input_shape[2]}, input), output_data_type, output_quantization);
+    add_color_conversion(input, output, info);
 
-    arm_compute::ActivationLayerInfo act_info(arm_compute::ActivationLayerInfo::ActivationFunction::LINEAR, 255.0f, 0);
+    return output;
+}
 
-    auto& multiplier = create_tensor({1});
-    auto elementwise_pow = std::make_unique<arm_compute::CLElementwisePower>();
-    auto status = elementwise_pow->validate(input_normalized.info(), multiplier.info(), output.info(), act_info);
-    if(!status)
+void ACLNetwork::add_color_conversion(const arm_compute::ITensor &input, const arm_compute::ITensor &output, const ColorConversionInfo &info)
+{
+    auto color_conversion = create_function<CLColorConversion, NEColorConversion>(backend, [&](auto& function, auto tensor)
     {
-        LOGE("ElementwisePower error, description: {}", status.error_description().c_str());
-    }
-    elementwise_pow->configure((arm_compute::ICLTensor *) &input_normalized, &multiplier, &output, act_info);
-    functions.push_back(std::move(elementwise_pow));
-
-    multiplier.allocator()->allocate();
-    output.allocator()->allocate();
-
-    set_tensor_values(multiplier, {2.4f});
-
-    return output;
+        function.configure(tensor(input), tensor(output), info);
+    });
+    add_function(std::move(color_conversion), "ColorConversion", {&input}, {&output});
 }
@@ -19,32 +19,194 @@
 
 #include <arm_compute/runtime/CL/CLTensor.h>
 #include <arm_compute/runtime/CL/CLFunctions.h>
+#include <arm_compute/runtime/CL/CLBufferAllocator.h>
+#include <arm_compute/runtime/NEON/NEFunctions.h>
+#include <arm_compute/runtime/Allocator.h>
+#include <arm_compute/runtime/Tensor.h>
+#include <arm_compute/runtime/BlobLifetimeManager.h>
+#include <arm_compute/runtime/OffsetLifetimeManager.h>
+#include <arm_compute/runtime/MemoryGroup.h>
+#include <arm_compute/runtime/MemoryManagerOnDemand.h>
+#include <arm_compute/runtime/PoolManager.h>
+#include "cl_color_conversion.h"
+#include "cl_weight_blending.h"
+#include "ne_color_conversion.h"
+#include "tensor_utils.h"
+#include <mutex>
+#include <string>
+#include <unordered_map>
 
 class ACLNetwork
 {
 public:
-    ACLNetwork() = default;
+    // Runtime the layers are created for, the tensors of the network are CLTensors for CL and Tensors for CPU.
+    enum class Backend
+    {
+        // OpenCL functions running on the GPU.
+        CL,
+        // NEON functions running on the CPU cores, in threads of the ACL scheduler.
+        CPU
+    };
 
-    ~ACLNetwork() = default;
+    // Defines how the memory for intermediate (activation) tensors is allocated.
+    enum class ActivationMemoryMode
+    {
+        // Every activation tensor has its own buffer.
+        Dedicated,
+        // Activation tensors with non-overlapping lifetimes share buffers (blobs).
+        Blob,
+        // Activation tensors are placed at offsets within a single buffer, which is reused when lifetimes don't overlap.
+        Offset
+    };
+
+    // Kernels and biases in the order the layers create them. Networks created from the same graph for other image sizes
+    // use the same tensors, so the weights are converted and uploaded only once. Shared tensors keep the original values,
+    // because each network prepares (e.g. reshapes) them for its own layers, so prepare() doesn't release them.
+    struct SharedWeights
+    {
+        SharedWeights(arm_compute::DataType data_type, Backend backend);
+
+        arm_compute::DataType data_type;
+
+        Backend backend;
+
+        std::vector<std::unique_ptr<arm_compute::ITensor>> tensors;
+    };
+
+    // Activation memory of networks that never run at the same time, e.g. networks of several styles for the same image.
+    // The networks plan their activations in one lifetime manager, so a single pool sized for the largest of them serves all.
+    // Networks can be prepared on other threads, so planning, prepare() and run() of the networks are serialized by the mutex.
+    struct SharedActivations
+    {
+        SharedActivations(ActivationMemoryMode memory_mode, Backend backend);
+
+        ActivationMemoryMode memory_mode;
+
+        Backend backend;
+
+        std::unique_ptr<arm_compute::IAllocator> allocator;
+
+        std::shared_ptr<arm_compute::ISimpleLifetimeManager> lifetime_manager;
+
+        std::shared_ptr<arm_compute::MemoryManagerOnDemand> memory_manager;
+
+        // Size of the populated pool, it grows when a network needs a larger one.
+        size_t pool_size{0};
+
+        std::mutex mutex;
+    };
+
+    // The data type (F32, F16 or QASYMM8) is used for the weights and activations of the network.
+    // Quantized networks keep per-channel QSYMM8 weights and S32 biases, and use F32 for the color space conversion.
+    explicit ACLNetwork(arm_compute::DataType data_type = arm_compute::DataType::F32,
+                        ActivationMemoryMode memory_mode = ActivationMemoryMode::Offset,
+                        Backend backend = Backend::CL);
+
+    // Backend which can use the tensor, CLTensors are used by the CL backend and other tensors by the CPU backend.
+    static Backend get_tensor_backend(const arm_compute::ITensor& tensor);
+
+    // Number of threads the CPU backend runs the layers in, 0 uses one thread per CPU core.
+    static void set_cpu_thread_count(uint32_t count);
+
+    ~ACLNetwork();
 
     ACLNetwork(const ACLNetwork&) = delete;
 
     ACLNetwork(ACLNetwork&&) = delete;
 
+    // Uploads the weights, prepares all the functions (e.g. reshapes the weights) and releases the constant tensors that are no longer used.
+    // It must be called once after all the layers are added and before the first run().
+    void prepare();
+
+    // Only enqueues the functions on the CL backend, the CPU backend returns when the layers are finished.
+    // The network must be prepared beforehand.
     void run();
 
-    arm_compute::CLTensor& add_pad(const arm_compute::CLTensor& input, uint32_t pad_x, uint32_t pad_y);
+    // Waits until the layers that were run are finished.
+    void sync() const;
+
+    struct LayerTime
+    {
+        std::string name;
+
+        double milliseconds;
+    };
+
+    // Runs each layer separately and returns its average time.
+    std::vector<LayerTime> profile_layers(uint32_t iterations);
+
+    bool is_prepared() const;
+
+    Backend get_backend() const;
+
+    arm_compute::DataType get_data_type() const;
+
+    // Data type of the layers which are not quantized.
+    arm_compute::DataType get_float_data_type() const;
 
-    arm_compute::CLTensor& add_addition(const arm_compute::CLTensor& input_a,
-                                        const arm_compute::CLTensor& input_b,
-                                        arm_compute::ActivationLayerInfo::ActivationFunction activation);
+    // Associates a tensor with its index in the source model, e.g. to collect statistics for quantization.
+    void set_model_tensor(int32_t index, arm_compute::ITensor& tensor);
 
-    arm_compute::CLTensor& add_activation(const arm_compute::CLTensor& input,
+    const std::unordered_map<int32_t, arm_compute::ITensor*>& get_model_tensors() const;
+
+    // Layers are validated before they are configured, unless the network is known to be valid (e.g. a precompiled network).
+    void set_layer_validation(bool enabled);
+
+    // The weights must have the data type and the backend of the network. It must be called before any layer is added.
+    void set_shared_weights(std::shared_ptr<SharedWeights> weights);
+
+    // The activations must have the memory mode (Blob or Offset) and the backend of the network. It must be called before prepare().
+    void set_shared_activations(std::shared_ptr<SharedActivations> activations);
+
+    // Blend mode: Conv2D, DepthwiseConv2D and TransposeConv2D layers keep two sets of weights and biases (e.g. of two styles
+    // of the same model) and use weights interpolated between them on the GPU, see set_blend_factor().
+    // The layers read their weights in each run instead of preparing them once: Conv2D layers use the direct convolution
+    // and TransposeConv2D layers upsample the input and convolve it with a flipped kernel, like CLDirectDeconvolutionLayer.
+    // Only F32 and F16 networks on the CL backend can blend the weights. It must be called before any layer is added.
+    void enable_weight_blending();
+
+    bool is_blending_weights() const;
+
+    // Number of layers with blended weights, in the order the layers were added.
+    size_t get_blended_layer_count() const;
+
+    // Sets the second set of weights of a blended layer, the first set are the values the layer was added with.
+    // The values have the layout of the first set. It must be called for all the blended layers before prepare().
+    void set_blend_weights(size_t layer, const ConstantValues& kernel_values, const ConstantValues& bias_values);
+
+    // 0 uses the first set of weights and 1 the second one. The weights are interpolated again only when the factor changes,
+    // with one kernel per weight tensor enqueued before the next run.
+    void set_blend_factor(float factor);
+
+    float get_blend_factor() const;
+
+    // Methods used by the Conv2D layers, in the order the layers were added.
+    const std::vector<arm_compute::ConvolutionMethod>& get_convolution_methods() const;
+
+    // Size of the memory used by activation tensors, it is known after the network is prepared.
+    // With shared activations it's the size of the shared pool, which is planned for the largest of the networks sharing it.
+    size_t get_activation_memory_size() const;
+
+    // Approximate size of the memory used by the prepared weights and biases, it is known after the network is prepared.
+    size_t get_weights_memory_size() const;
+
+    // Layers get the dimensions of a single image, the fourth dimension of the input is the batch (e.g. N frames processed
+    // by the same dispatches), and the outputs of the layers have the batch size of their inputs.
+    arm_compute::ITensor& add_pad(const arm_compute::ITensor& input, uint32_t pad_x, uint32_t pad_y);
+
+    arm_compute::ITensor& add_addition(const arm_compute::ITensor& input_a,
+                                        const arm_compute::ITensor& input_b,
+                                        arm_compute::ActivationLayerInfo::ActivationFunction activation,
+                                        const arm_compute::QuantizationInfo& output_quantization = arm_compute::QuantizationInfo());
+
+    arm_compute::ITensor& add_activation(const arm_compute::ITensor& input,
                                           arm_compute::ActivationLayerInfo::ActivationFunction activation,
                                           float a = 0.0f,
-                                          float b = 0.0f);
+                                          float b = 0.0f,
+                                          const arm_compute::QuantizationInfo& output_quantization = arm_compute::QuantizationInfo(),
+                                          bool in_place = false);
 
-    arm_compute::CLTensor& add_conv2d(const arm_compute::CLTensor& input,
+    arm_compute::ITensor& add_conv2d(const arm_compute::ITensor& input,
                                       uint32_t kernel_width,
                                       uint32_t kernel_height,
                                       uint32_t output_features,
@@ -54,13 +216,15 @@ public:
                                       uint32_t pad_y_back,
                                       uint32_t stride_x,
                                       uint32_t stride_y,
-                                      const std::vector<float>& kernel_values,
-                                      const std::vector<float>& bias_values,
+                                      const ConstantValues& kernel_values,
+                                      const ConstantValues& bias_values,
                                       arm_compute::ActivationLayerInfo::ActivationFunction activation,
                                       uint32_t dilation_x = 1,
-                                      uint32_t dilation_y = 1);
+                                      uint32_t dilation_y = 1,
+                                      const arm_compute::QuantizationInfo& output_quantization = arm_compute::QuantizationInfo(),
+                                      const arm_compute::ConvolutionMethod* convolution_method = nullptr);
 
-    arm_compute::CLTensor& add_depthwise_conv2d(const arm_compute::CLTensor& input,
+    arm_compute::ITensor& add_depthwise_conv2d(const arm_compute::ITensor& input,
                                                 uint32_t kernel_width,
                                                 uint32_t kernel_height,
                                                 uint32_t pad_x_front,
@@ -69,13 +233,14 @@ public:
                                                 uint32_t pad_y_back,
                                                 uint32_t stride_x,
                                                 uint32_t stride_y,
-                                                const std::vector<float>& kernel_values,
-                                                const std::vector<float>& bias_values,
+                                                const ConstantValues& kernel_values,
+                                                const ConstantValues& bias_values,
                                                 arm_compute::ActivationLayerInfo::ActivationFunction activation,
                                                 uint32_t dilation_x = 1,
-                                                uint32_t dilation_y = 1);
+                                                uint32_t dilation_y = 1,
+                                                const arm_compute::QuantizationInfo& output_quantization = arm_compute::QuantizationInfo());
 
-    arm_compute::CLTensor& add_conv2d_transpose(const arm_compute::CLTensor& input,
+    arm_compute::ITensor& add_conv2d_transpose(const arm_compute::ITensor& input,
                                                 uint32_t kernel_width,
                                                 uint32_t kernel_height,
                                                 uint32_t output_features,
@@ -85,23 +250,202 @@ public:
                                                 uint32_t pad_y_back,
                                                 uint32_t stride_x,
                                                 uint32_t stride_y,
-                                                const std::vector<float>& kernel_values,
-                                                const std::vector<float>& bias_values);
+                                                const ConstantValues& kernel_values,
+                                                const ConstantValues& bias_values,
+                                                const arm_compute::QuantizationInfo& output_quantization = arm_compute::QuantizationInfo());
 
-    // Additional layers that convert the image to sRGB color space.
-    arm_compute::CLTensor& add_linear_to_srgb(const arm_compute::CLTensor& input);
+    // Converts colors of the image in a single kernel (e.g. between the processed RGBA8 image and the network tensors).
+    // The result has the given number of channels and data type.
+    arm_compute::ITensor& add_color_conversion(const arm_compute::ITensor& input,
+                                                uint32_t channels,
+                                                const ColorConversionInfo& info,
+                                                arm_compute::DataType output_data_type,
+                                                const arm_compute::QuantizationInfo& output_quantization = arm_compute::QuantizationInfo());
 
-    // Additinal layers that convert the image back to linear color space.
-    arm_compute::CLTensor& add_srgb_to_linear(const arm_compute::CLTensor& input);
+    void add_color_conversion(const arm_compute::ITensor& input, const arm_compute::ITensor& output, const ColorConversionInfo& info);
 
-    arm_compute::CLTensor& add_dequantization(const arm_compute::CLTensor &input);
+    arm_compute::ITensor& add_dequantization(const arm_compute::ITensor &input);
 
-    void add_quantization(const arm_compute::CLTensor &input, const arm_compute::CLTensor &output);
+    // Quantizes the input to a new QASYMM8 tensor.
+    arm_compute::ITensor& add_quantization(const arm_compute::ITensor &input, const arm_compute::QuantizationInfo &quantization_info);
 
-    arm_compute::CLTensor& create_tensor(const std::vector<uint32_t>& dims);
+    void add_quantization(const arm_compute::ITensor &input, const arm_compute::ITensor &output);
+
+    arm_compute::ITensor& create_tensor(const std::vector<uint32_t>& dims,
+                                         arm_compute::DataType tensor_data_type,
+                                         const arm_compute::QuantizationInfo& quantization_info = arm_compute::QuantizationInfo());
 
 private:
-    std::vector<std::unique_ptr<arm_compute::CLTensor>> tensors;
+    struct Layer
+    {
+        std::unique_ptr<arm_compute::IFunction> function;
+
+        std::string name;
+
+        std::vector<const arm_compute::ITensor*> inputs;
+
+        std::vector<const arm_compute::ITensor*> outputs;
+    };
+
+    void add_function(std::unique_ptr<arm_compute::IFunction> function,
+                      const std::string& name,
+                      const std::vector<const arm_compute::ITensor*>& inputs,
+                      const std::vector<const arm_compute::ITensor*>& outputs);
+
+    // Allocates activation tensors according to the memory mode, using the order of the layers to find tensor lifetimes.
+    void allocate_activations();
+
+    // Locks the shared activations, the lock is empty if the network has its own activation memory.
+    std::unique_lock<std::mutex> lock_activations();
+
+    // Creates a tensor of the backend, which is not owned by the network.
+    std::unique_ptr<arm_compute::ITensor> new_tensor(const std::vector<uint32_t>& dims,
+                                                     arm_compute::DataType tensor_data_type,
+                                                     const arm_compute::QuantizationInfo& quantization_info) const;
+
+    arm_compute::ITensor& make_tensor(const std::vector<uint32_t>& dims,
+                                       arm_compute::DataType tensor_data_type,
+                                       const arm_compute::QuantizationInfo& quantization_info);
+
+    // Creates an output tensor of a layer with the same data type and batch size as its input.
+    arm_compute::ITensor& create_output_tensor(const arm_compute::ITensor& input,
+                                                const std::vector<uint32_t>& dims,
+                                                const arm_compute::QuantizationInfo& quantization_info = arm_compute::QuantizationInfo());
+
+    arm_compute::ITensor& create_constant_tensor(const std::vector<uint32_t>& dims,
+                                                  arm_compute::DataType tensor_data_type,
+                                                  const arm_compute::QuantizationInfo& quantization_info = arm_compute::QuantizationInfo());
+
+    // Creates a kernel tensor, which is quantized per output channel if the input is quantized.
+    arm_compute::ITensor& create_kernel_tensor(const arm_compute::ITensor& input,
+                                                const std::vector<uint32_t>& dims,
+                                                const ConstantValues& values,
+                                                uint32_t channels,
+                                                uint32_t channel_inner_size);
+
+    arm_compute::ITensor& create_bias_tensor(const arm_compute::ITensor& input, const std::vector<uint32_t>& dims);
+
+    // Reserves a region of the weights staging buffer for the tensor and returns the host memory to write its values to.
+    // Constant tensors of the CPU backend are written directly.
+    uint8_t* stage_constant_tensor(arm_compute::ITensor& tensor);
+
+    // Copies the staged values of all the constant tensors to the GPU, with a single host transfer for the whole staging buffer.
+    void upload_weights();
+
+    // Creates both sets of weights of a blended layer, the layer reads the kernel and the bias interpolated from them.
+    // The first set is written from the values the layer was added with.
+    void add_blended_weights(const arm_compute::ITensor& input,
+                             arm_compute::ITensor& kernel,
+                             const ConstantValues& kernel_values,
+                             arm_compute::ITensor& bias,
+                             const ConstantValues& bias_values,
+                             uint32_t channel_inner_size,
+                             bool flip_kernel);
+
+    // Enqueues the interpolation of all the blended weights with the current factor.
+    void blend_weights();
+
+    // Allocates kernel and bias and writes them to the staging buffer, converting the values if they are not converted yet.
+    void set_weights_values(const arm_compute::ITensor& input,
+                            arm_compute::ITensor& kernel,
+                            const ConstantValues& kernel_values,
+                            arm_compute::ITensor& bias,
+                            const ConstantValues& bias_values,
+                            uint32_t channel_inner_size);
+
+    arm_compute::DataType data_type;
+
+    ActivationMemoryMode memory_mode;
+
+    Backend backend;
+
+    // Allocator of the activation memory pools, CLBufferAllocator or the CPU Allocator.
+    std::unique_ptr<arm_compute::IAllocator> allocator;
+
+    std::shared_ptr<arm_compute::ISimpleLifetimeManager> lifetime_manager;
+
+    std::shared_ptr<arm_compute::MemoryManagerOnDemand> memory_manager;
+
+    arm_compute::MemoryGroup memory_group;
+
+    size_t activation_memory_size{0};
+
+    size_t weights_memory_size{0};
+
+    std::shared_ptr<SharedActivations> shared_activations;
+
+    std::vector<std::unique_ptr<arm_compute::ITensor>> tensors;
+
+    // Tensors which are produced by the layers.
+    std::vector<arm_compute::ITensor*> activation_tensors;
+
+    // Weights, biases and other tensors which are filled during network creation.
+    std::vector<arm_compute::ITensor*> constant_tensors;
+
+    bool prepared{false};
+
+    std::unordered_map<int32_t, arm_compute::ITensor*> model_tensors;
+
+    std::vector<Layer> layers;
+
+    bool validate_layers{true};
+
+    std::vector<arm_compute::ConvolutionMethod> convolution_methods;
+
+    std::shared_ptr<SharedWeights> shared_weights;
+
+    // Number of the shared tensors used by the layers of this network.
+    size_t shared_weights_used{0};
+
+    struct StagedTensor
+    {
+        arm_compute::ITensor* tensor;
+
+        size_t offset;
+    };
+
+    // Values of the constant tensors, laid out with the tensor padding, which are waiting for upload_weights().
+    std::vector<uint8_t> weights_staging;
+
+    std::vector<StagedTensor> staged_tensors;
+
+    // Time spent converting the weights into the staging buffer.
+    double weights_staging_time{0.0};
+
+    bool weight_blending{false};
+
+    struct BlendedWeights
+    {
+        const arm_compute::ITensor* input;
+
+        uint32_t channel_inner_size;
+
+        // Kernels of transposed convolutions are flipped when their values are written.
+        bool flip_kernel;
+
+        // Weights read by the layer.
+        arm_compute::ITensor* kernel;
+
+        arm_compute::ITensor* bias;
+
+        arm_compute::ITensor* first_kernel;
+
+        arm_compute::ITensor* first_bias;
+
+        // Second set of weights, it is allocated when its values are set.
+        arm_compute::ITensor* second_kernel;
+
+        arm_compute::ITensor* second_bias;
+
+        CLWeightBlending kernel_blending;
+
+        CLWeightBlending bias_blending;
+    };
+
+    std::vector<std::unique_ptr<BlendedWeights>> blended_weights;
+
+    float blend_factor{0.0f};
 
-    std::vector<std::unique_ptr<arm_compute::IFunction>> functions;
+    // The factor changed since the weights were interpolated.
+    bool blend_pending{false};
 };
\ No newline at end of file
@@ -0,0 +1,128 @@
+/* Copyright (c) 2022, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 the "License";
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "cl_change_detection.h"
+#include "cl_program_cache.h"
+#include <arm_compute/runtime/CL/CLScheduler.h>
+#include <algorithm>
+
+namespace
+{
+const char* CHANGE_DETECTION_SOURCE = R"(
+__kernel void change_detection(__global const uchar* image,
+                               uint image_offset,
+                               uint image_stride_x,
+                               uint image_stride_y,
+                               __global const uchar* previous_image,
+                               uint previous_offset,
+                               uint previous_stride_x,
+                               uint previous_stride_y,
+                               __global uchar* changed_blocks,
+                               uint blocks_x)
+{
+    uint x = get_global_id(0);
+    uint y = get_global_id(1);
+    __global const uchar* current = image + image_offset + x * image_stride_x + y * image_stride_y;
+    __global const uchar* previous = previous_image + previous_offset + x * previous_stride_x + y * previous_stride_y;
+
+    // All the work items of a changed block write the same value, so the writes don't need to be atomic.
+    for(uint c = 0; c < CHANNELS; c++)
+    {
+        if(current[c] != previous[c])
+        {
+            changed_blocks[(y / BLOCK_SIZE) * blocks_x + x / BLOCK_SIZE] = 1;
+            return;
+        }
+    }
+}
+)";
+
+void set_tensor_arguments(cl::Kernel& kernel, uint32_t index, const arm_compute::ICLTensor& tensor)
+{
+    const auto& info = *tensor.info();
+    const auto& strides = info.strides_in_bytes();
+    kernel.setArg(index++, tensor.cl_buffer());
+    kernel.setArg<cl_uint>(index++, static_cast<cl_uint>(info.offset_first_element_in_bytes()));
+    kernel.setArg<cl_uint>(index++, static_cast<cl_uint>(strides[1]));
+    kernel.setArg<cl_uint>(index, static_cast<cl_uint>(strides[2]));
+}
+}        // namespace
+
+void CLChangeDetection::configure(const arm_compute::ICLTensor* image, const arm_compute::ICLTensor* previous_image, uint32_t block_size)
+{
+    this->image = image;
+    this->previous_image = previous_image;
+    this->block_size = block_size;
+
+    const auto& shape = image->info()->tensor_shape();
+    if(image->info()->element_size() != 1 || previous_image->info()->element_size() != 1 || shape != previous_image->info()->tensor_shape())
+    {
+        throw std::runtime_error("CLChangeDetection requires two 8-bit images of the same shape.");
+    }
+    if(block_size == 0)
+    {
+        throw std::runtime_error("CLChangeDetection requires a non-zero block size.");
+    }
+
+    std::string options = "-DCHANNELS=" + std::to_string(std::min<size_t>(shape[0], 3)) + " -DBLOCK_SIZE=" + std::to_string(block_size);
+    auto program = CLProgramCache::get_program("change_detection" + options, CHANGE_DETECTION_SOURCE, options);
+    kernel = cl::Kernel(program, "change_detection");
+
+    blocks_x = static_cast<uint32_t>((shape[1] + block_size - 1) / block_size);
+    blocks_y = static_cast<uint32_t>((shape[2] + block_size - 1) / block_size);
+    changed_blocks.assign(blocks_x * blocks_y, 1);
+    cleared_blocks.assign(blocks_x * blocks_y, 0);
+    changed_blocks_buffer = cl::Buffer(arm_compute::CLScheduler::get().context(), CL_MEM_READ_WRITE, changed_blocks.size());
+    kernel.setArg(8, changed_blocks_buffer);
+    kernel.setArg<cl_uint>(9, blocks_x);
+
+    global_size = cl::NDRange(shape[1], shape[2]);
+}
+
+void CLChangeDetection::run()
+{
+    // The map is cleared from a host buffer, as fill commands require OpenCL 1.2.
+    auto& queue = arm_compute::CLScheduler::get().queue();
+    queue.enqueueWriteBuffer(changed_blocks_buffer, CL_FALSE, 0, cleared_blocks.size(), cleared_blocks.data());
+
+    // The memory of the image is imported for each frame, so the buffers are set for each run.
+    set_tensor_arguments(kernel, 0, *image);
+    set_tensor_arguments(kernel, 4, *previous_image);
+    queue.enqueueNDRangeKernel(kernel, cl::NullRange, global_size, cl::NullRange);
+}
+
+void CLChangeDetection::read_changed_blocks()
+{
+    arm_compute::CLScheduler::get().queue().enqueueReadBuffer(changed_blocks_buffer, CL_TRUE, 0, changed_blocks.size(), changed_blocks.data());
+}
+
+bool CLChangeDetection::is_changed(uint32_t x, uint32_t y, uint32_t width, uint32_t height) const
+{
+    uint32_t last_x = std::min((x + width - 1) / block_size, blocks_x - 1);
+    uint32_t last_y = std::min((y + height - 1) / block_size, blocks_y - 1);
+    for(uint32_t block_y = y / block_size; block_y <= last_y; block_y++)
+    {
+        for(uint32_t block_x = x / block_size; block_x <= last_x; block_x++)
+        {
+            if(changed_blocks[block_y * blocks_x + block_x])
+            {
+                return true;
+            }
+        }
+    }
+    return false;
+}
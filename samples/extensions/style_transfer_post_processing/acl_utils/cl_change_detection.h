@@ -0,0 +1,65 @@
+/* Copyright (c) 2022, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 the "License";
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <arm_compute/core/CL/ICLTensor.h>
+#include <arm_compute/core/CL/OpenCL.h>
+#include <arm_compute/runtime/IFunction.h>
+#include <vector>
+
+/*
+ * Compares an RGBA8 NHWC image with a previous image in a single OpenCL kernel and marks the blocks of pixels that differ.
+ * The map of changed blocks is small enough to be read on the host, which decides what to process again.
+ * The alpha channel is not compared, as it is not processed by the network.
+ */
+class CLChangeDetection : public arm_compute::IFunction
+{
+public:
+    // Both images must have the same shape, the blocks are squares of block_size pixels.
+    void configure(const arm_compute::ICLTensor* image, const arm_compute::ICLTensor* previous_image, uint32_t block_size);
+
+    void run() override;
+
+    // Waits for the last run and reads the map of changed blocks.
+    void read_changed_blocks();
+
+    // Whether any block covering the given rectangle of pixels changed, according to the last read map.
+    bool is_changed(uint32_t x, uint32_t y, uint32_t width, uint32_t height) const;
+
+private:
+    const arm_compute::ICLTensor* image{nullptr};
+
+    const arm_compute::ICLTensor* previous_image{nullptr};
+
+    uint32_t block_size{0};
+
+    uint32_t blocks_x{0};
+
+    uint32_t blocks_y{0};
+
+    cl::Kernel kernel;
+
+    cl::NDRange global_size;
+
+    cl::Buffer changed_blocks_buffer;
+
+    std::vector<uint8_t> changed_blocks;
+
+    // Zeros written to the map before each run, kept here until the write completes.
+    std::vector<uint8_t> cleared_blocks;
+};
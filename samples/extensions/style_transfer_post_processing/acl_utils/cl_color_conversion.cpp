@@ -0,0 +1,151 @@
+/* Copyright (c) 2022, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 the "License";
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "cl_color_conversion.h"
+#include "cl_program_cache.h"
+#include <arm_compute/core/CL/CLKernelLibrary.h>
+#include <arm_compute/core/Utils.h>
+#include <arm_compute/runtime/CL/CLScheduler.h>
+#include <algorithm>
+
+namespace
+{
+const char* COLOR_CONVERSION_SOURCE = R"(
+#if defined(INPUT_F32)
+#define LOAD(ptr) (*(__global const float*)(ptr))
+#elif defined(INPUT_F16)
+#define LOAD(ptr) vload_half(0, (__global const half*)(ptr))
+#else
+#define LOAD(ptr) (((float)(*(ptr)) - input_zero_point) * input_scale)
+#endif
+
+#if defined(OUTPUT_F32)
+#define STORE(value, ptr) *(__global float*)(ptr) = (value)
+#elif defined(OUTPUT_F16)
+#define STORE(value, ptr) vstore_half((value), 0, (__global half*)(ptr))
+#else
+#define STORE(value, ptr) *(ptr) = convert_uchar_sat_rte((value) / output_scale + output_zero_point)
+#endif
+
+__kernel void color_conversion(__global const uchar* input,
+                               uint input_offset,
+                               uint input_stride_c,
+                               uint input_stride_x,
+                               uint input_stride_y,
+                               uint input_stride_n,
+                               float input_scale,
+                               int input_zero_point,
+                               __global uchar* output,
+                               uint output_offset,
+                               uint output_stride_c,
+                               uint output_stride_x,
+                               uint output_stride_y,
+                               uint output_stride_n,
+                               float output_scale,
+                               int output_zero_point,
+                               float pre_scale,
+                               float pre_bias,
+                               float exponent,
+                               float post_scale,
+                               float post_bias)
+{
+    uint x = get_global_id(0);
+    uint y = get_global_id(1);
+    uint n = get_global_id(2);
+    __global const uchar* src = input + input_offset + x * input_stride_x + y * input_stride_y + n * input_stride_n;
+    __global uchar* dst = output + output_offset + x * output_stride_x + y * output_stride_y + n * output_stride_n;
+
+    for(uint c = 0; c < CHANNELS; c++)
+    {
+        float value = LOAD(src + c * input_stride_c) * pre_scale + pre_bias;
+        // Negative values are clamped, pow() of a negative base is undefined.
+        value = pow(max(value, 0.0f), exponent) * post_scale + post_bias;
+        STORE(value, dst + c * output_stride_c);
+    }
+}
+)";
+
+std::string get_type_option(const std::string& prefix, arm_compute::DataType data_type)
+{
+    switch(data_type)
+    {
+        case arm_compute::DataType::F32:
+            return " -D" + prefix + "_F32";
+        case arm_compute::DataType::F16:
+            return " -D" + prefix + "_F16";
+        case arm_compute::DataType::QASYMM8:
+        case arm_compute::DataType::U8:
+            return " -D" + prefix + "_QASYMM8";
+        default:
+            throw std::runtime_error("CLColorConversion does not support " + arm_compute::string_from_data_type(data_type) + " tensors.");
+    }
+}
+
+void set_tensor_arguments(cl::Kernel& kernel, uint32_t index, const arm_compute::ICLTensor& tensor)
+{
+    const auto& info = *tensor.info();
+    const auto& strides = info.strides_in_bytes();
+    auto quantization = info.quantization_info().uniform();
+    kernel.setArg(index++, tensor.cl_buffer());
+    kernel.setArg<cl_uint>(index++, static_cast<cl_uint>(info.offset_first_element_in_bytes()));
+    kernel.setArg<cl_uint>(index++, static_cast<cl_uint>(strides[0]));
+    kernel.setArg<cl_uint>(index++, static_cast<cl_uint>(strides[1]));
+    kernel.setArg<cl_uint>(index++, static_cast<cl_uint>(strides[2]));
+    kernel.setArg<cl_uint>(index++, static_cast<cl_uint>(strides[3]));
+    kernel.setArg<cl_float>(index++, quantization.scale == 0.0f ? 1.0f : quantization.scale);
+    kernel.setArg<cl_int>(index, quantization.offset);
+}
+}        // namespace
+
+void CLColorConversion::configure(const arm_compute::ICLTensor* input, arm_compute::ICLTensor* output, const ColorConversionInfo& info)
+{
+    this->input = input;
+    this->output = output;
+
+    const auto& input_shape = input->info()->tensor_shape();
+    const auto& output_shape = output->info()->tensor_shape();
+    if(input_shape[1] != output_shape[1] || input_shape[2] != output_shape[2] || input_shape[3] != output_shape[3])
+    {
+        throw std::runtime_error("CLColorConversion requires input and output of the same size and batch size.");
+    }
+
+    std::string options = "-DCHANNELS=" + std::to_string(std::min(input_shape[0], output_shape[0]));
+    options += get_type_option("INPUT", input->info()->data_type());
+    options += get_type_option("OUTPUT", output->info()->data_type());
+
+    // The program is kept with the ACL programs, so it is built once for each set of options and stored in the program cache.
+    auto program = CLProgramCache::get_program("color_conversion" + options, COLOR_CONVERSION_SOURCE, options);
+    kernel = cl::Kernel(program, "color_conversion");
+
+    kernel.setArg<cl_float>(16, info.pre_scale);
+    kernel.setArg<cl_float>(17, info.pre_bias);
+    kernel.setArg<cl_float>(18, info.exponent);
+    kernel.setArg<cl_float>(19, info.post_scale);
+    kernel.setArg<cl_float>(20, info.post_bias);
+
+    // Images of a batch are in the third dimension of the range.
+    global_size = cl::NDRange(input_shape[1], input_shape[2], input_shape[3]);
+}
+
+void CLColorConversion::run()
+{
+    // Buffers and strides are set for each run, the memory of the tensors can be imported after configuration
+    // and other layers can extend the padding of the tensors when they are configured.
+    set_tensor_arguments(kernel, 0, *input);
+    set_tensor_arguments(kernel, 8, *output);
+    arm_compute::CLScheduler::get().queue().enqueueNDRangeKernel(kernel, cl::NullRange, global_size, cl::NullRange);
+}
@@ -0,0 +1,58 @@
+/* Copyright (c) 2022, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 the "License";
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <arm_compute/core/CL/ICLTensor.h>
+#include <arm_compute/core/CL/OpenCL.h>
+#include <arm_compute/runtime/IFunction.h>
+
+// Parameters of the conversion: output = pow(input * pre_scale + pre_bias, exponent) * post_scale + post_bias
+struct ColorConversionInfo
+{
+    float pre_scale{1.0f};
+
+    float pre_bias{0.0f};
+
+    float exponent{1.0f};
+
+    float post_scale{1.0f};
+
+    float post_bias{0.0f};
+};
+
+/*
+ * Converts colors of an NHWC image, or of all the images of a batch, in a single OpenCL kernel.
+ * Input and output can be F32, F16 or 8-bit asymmetric quantized (e.g. RGBA8 image), quantized values are converted in the same kernel.
+ * Only the channels present in both tensors are processed, so the alpha channel of an RGBA image is skipped and kept unchanged.
+ */
+class CLColorConversion : public arm_compute::IFunction
+{
+public:
+    void configure(const arm_compute::ICLTensor* input, arm_compute::ICLTensor* output, const ColorConversionInfo& info);
+
+    void run() override;
+
+private:
+    const arm_compute::ICLTensor* input{nullptr};
+
+    arm_compute::ICLTensor* output{nullptr};
+
+    cl::Kernel kernel;
+
+    cl::NDRange global_size;
+};
@@ -0,0 +1,184 @@
+/* Copyright (c) 2022, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 the "License";
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "cl_program_cache.h"
+#include <common/logging.h>
+#include <arm_compute/core/CL/CLKernelLibrary.h>
+#include <arm_compute/runtime/CL/CLScheduler.h>
+#include <fstream>
+#include <vector>
+
+namespace
+{
+// Increased whenever the layout of the file changes.
+const uint32_t CACHE_FILE_VERSION = 1;
+
+void write_bytes(std::ofstream& file, const std::vector<unsigned char>& bytes)
+{
+    auto size = static_cast<uint64_t>(bytes.size());
+    file.write(reinterpret_cast<const char*>(&size), sizeof(size));
+    file.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+}
+
+void write_string(std::ofstream& file, const std::string& string)
+{
+    write_bytes(file, std::vector<unsigned char>(string.begin(), string.end()));
+}
+
+// The stored size is checked against the rest of the file, so that a truncated or corrupted file fails the read
+// instead of allocating the size it claims.
+bool read_bytes(std::ifstream& file, uint64_t file_size, std::vector<unsigned char>& bytes)
+{
+    uint64_t size = 0;
+    if(!file.read(reinterpret_cast<char*>(&size), sizeof(size)))
+    {
+        return false;
+    }
+    auto position = file.tellg();
+    if(position < 0 || size > file_size - static_cast<uint64_t>(position))
+    {
+        return false;
+    }
+    bytes.resize(size);
+    return static_cast<bool>(file.read(reinterpret_cast<char*>(bytes.data()), size));
+}
+
+bool read_string(std::ifstream& file, uint64_t file_size, std::string& string)
+{
+    std::vector<unsigned char> bytes;
+    if(!read_bytes(file, file_size, bytes))
+    {
+        return false;
+    }
+    string.assign(bytes.begin(), bytes.end());
+    return true;
+}
+
+// Identifies the device and the driver that the binaries are built for.
+std::string get_device_key(const cl::Device& device)
+{
+    return device.getInfo<CL_DEVICE_NAME>() + " " + device.getInfo<CL_DEVICE_VERSION>() + " " + device.getInfo<CL_DRIVER_VERSION>();
+}
+}
+
+size_t CLProgramCache::restore(const std::string& path)
+{
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if(!file)
+    {
+        return 0;
+    }
+    auto file_size = static_cast<uint64_t>(file.tellg());
+    file.seekg(0);
+
+    auto& library = arm_compute::CLKernelLibrary::get();
+    const auto& device = library.get_device();
+
+    uint32_t version = 0;
+    std::string device_key;
+    if(!file.read(reinterpret_cast<char*>(&version), sizeof(version)) || version != CACHE_FILE_VERSION ||
+       !read_string(file, file_size, device_key) || device_key != get_device_key(device))
+    {
+        LOGW("OpenCL program cache {} was stored for another device or driver, the kernels are compiled again", path);
+        return 0;
+    }
+
+    // Programs that were not restored are compiled when a kernel needs them, so a damaged file only loses the cached programs.
+    size_t restored_programs = 0;
+    std::string name;
+    std::vector<unsigned char> binary;
+    while(read_string(file, file_size, name))
+    {
+        if(!read_bytes(file, file_size, binary))
+        {
+            LOGW("OpenCL program cache {} is truncated or corrupted, the remaining kernels are compiled again", path);
+            break;
+        }
+        if(library.get_built_programs().count(name) > 0)
+        {
+            continue;
+        }
+        try
+        {
+            cl::Program program(library.context(), {device}, {binary});
+            program.build();
+            library.add_built_program(name, program);
+            restored_programs++;
+        }
+        catch(const cl::Error& e)
+        {
+            LOGW("Cannot load OpenCL program {} from the cache ({}), it is compiled again", name, e.err());
+        }
+    }
+    return restored_programs;
+}
+
+void CLProgramCache::save(const std::string& path)
+{
+    auto& library = arm_compute::CLKernelLibrary::get();
+
+    std::ofstream file(path, std::ios::binary);
+    if(!file)
+    {
+        LOGW("Cannot write OpenCL program cache {}", path);
+        return;
+    }
+
+    file.write(reinterpret_cast<const char*>(&CACHE_FILE_VERSION), sizeof(CACHE_FILE_VERSION));
+    write_string(file, get_device_key(library.get_device()));
+    for(const auto& built_program : library.get_built_programs())
+    {
+        // The programs are built for the single device of the context.
+        auto binaries = built_program.second.getInfo<CL_PROGRAM_BINARIES>();
+        if(binaries.empty() || binaries[0].empty())
+        {
+            continue;
+        }
+        write_string(file, built_program.first);
+        write_bytes(file, binaries[0]);
+    }
+}
+
+cl::Program CLProgramCache::get_program(const std::string& name, const char* source, const std::string& options)
+{
+    std::lock_guard<std::recursive_mutex> lock(get_build_mutex());
+    auto& library = arm_compute::CLKernelLibrary::get();
+    auto built_program = library.get_built_programs().find(name);
+    if(built_program != library.get_built_programs().end())
+    {
+        return built_program->second;
+    }
+
+    cl::Program program(arm_compute::CLScheduler::get().context(), source);
+    try
+    {
+        program.build(options.c_str());
+    }
+    catch(const cl::Error&)
+    {
+        auto log = program.getBuildInfo<CL_PROGRAM_BUILD_LOG>(library.get_device());
+        throw std::runtime_error("Cannot build program " + name + ": " + log);
+    }
+    library.add_built_program(name, program);
+    return program;
+}
+
+std::recursive_mutex& CLProgramCache::get_build_mutex()
+{
+    static std::recursive_mutex mutex;
+    return mutex;
+}
@@ -0,0 +1,47 @@
+/* Copyright (c) 2022, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 the "License";
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <arm_compute/core/CL/OpenCL.h>
+#include <mutex>
+#include <string>
+
+/*
+ * Stores the OpenCL programs built by arm_compute::CLKernelLibrary as binaries, so that the kernels are not compiled again on the next launch.
+ * Programs are stored under the names the library gives them, which include the build options of the program.
+ * The binaries are only valid for the device and driver they were built with, so the file also records both.
+ */
+class CLProgramCache
+{
+public:
+    // Adds the stored programs to the library. Returns the number of restored programs, 0 if the file is missing or was
+    // stored for another device or driver. Programs that fail to load are skipped and compiled when a kernel needs them,
+    // and a truncated or corrupted file is read only up to the damaged entry.
+    // Must be called after the library is initialized and before any kernel is configured.
+    static size_t restore(const std::string& path);
+
+    // Stores all the programs built by the library.
+    static void save(const std::string& path);
+
+    // Returns the program with the name from the library, or builds it from the source and adds it to the library,
+    // so that programs of the sample are stored together with the ACL programs. The name must include the build options.
+    static cl::Program get_program(const std::string& name, const char* source, const std::string& options);
+
+    // The library doesn't synchronize its programs, so threads configuring kernels (e.g. creating networks) hold this mutex.
+    static std::recursive_mutex& get_build_mutex();
+};
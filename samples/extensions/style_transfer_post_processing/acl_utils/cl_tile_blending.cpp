@@ -0,0 +1,104 @@
+/* Copyright (c) 2022, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 the "License";
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "cl_tile_blending.h"
+#include "cl_program_cache.h"
+#include <arm_compute/runtime/CL/CLScheduler.h>
+#include <algorithm>
+
+namespace
+{
+const char* TILE_BLENDING_SOURCE = R"(
+__kernel void tile_blending(__global const uchar* tile,
+                            uint tile_offset,
+                            uint tile_stride_x,
+                            uint tile_stride_y,
+                            __global uchar* image,
+                            uint image_offset,
+                            uint image_stride_x,
+                            uint image_stride_y,
+                            uint tile_x,
+                            uint tile_y,
+                            uint blend_width,
+                            uint blend_height)
+{
+    uint x = get_global_id(0);
+    uint y = get_global_id(1);
+    __global const uchar* src = tile + tile_offset + x * tile_stride_x + y * tile_stride_y;
+    __global uchar* dst = image + image_offset + (tile_x + x) * image_stride_x + (tile_y + y) * image_stride_y;
+
+    float weight_x = x < blend_width ? (x + 0.5f) / blend_width : 1.0f;
+    float weight_y = y < blend_height ? (y + 0.5f) / blend_height : 1.0f;
+    float weight = weight_x * weight_y;
+    for(uint c = 0; c < CHANNELS; c++)
+    {
+        dst[c] = convert_uchar_sat_rte(mix((float)dst[c], (float)src[c], weight));
+    }
+}
+)";
+
+void set_tensor_arguments(cl::Kernel& kernel, uint32_t index, const arm_compute::ICLTensor& tensor)
+{
+    const auto& info = *tensor.info();
+    const auto& strides = info.strides_in_bytes();
+    kernel.setArg(index++, tensor.cl_buffer());
+    kernel.setArg<cl_uint>(index++, static_cast<cl_uint>(info.offset_first_element_in_bytes()));
+    kernel.setArg<cl_uint>(index++, static_cast<cl_uint>(strides[1]));
+    kernel.setArg<cl_uint>(index, static_cast<cl_uint>(strides[2]));
+}
+}        // namespace
+
+void CLTileBlending::configure(const arm_compute::ICLTensor* tile, arm_compute::ICLTensor* image)
+{
+    this->tile = tile;
+    this->image = image;
+
+    const auto& tile_shape = tile->info()->tensor_shape();
+    const auto& image_shape = image->info()->tensor_shape();
+    if(tile->info()->element_size() != 1 || image->info()->element_size() != 1 || tile_shape[0] != image_shape[0])
+    {
+        throw std::runtime_error("CLTileBlending requires 8-bit tile and image with the same channels.");
+    }
+    if(tile_shape[1] > image_shape[1] || tile_shape[2] > image_shape[2])
+    {
+        throw std::runtime_error("CLTileBlending requires a tile that fits into the image.");
+    }
+
+    // Alpha is not processed by the network, so only the color channels are written.
+    std::string options = "-DCHANNELS=" + std::to_string(std::min<size_t>(tile_shape[0], 3));
+    auto program = CLProgramCache::get_program("tile_blending" + options, TILE_BLENDING_SOURCE, options);
+    kernel = cl::Kernel(program, "tile_blending");
+
+    global_size = cl::NDRange(tile_shape[1], tile_shape[2]);
+    set_tile(0, 0, 0, 0);
+}
+
+void CLTileBlending::set_tile(uint32_t x, uint32_t y, uint32_t blend_width, uint32_t blend_height)
+{
+    kernel.setArg<cl_uint>(8, x);
+    kernel.setArg<cl_uint>(9, y);
+    kernel.setArg<cl_uint>(10, blend_width);
+    kernel.setArg<cl_uint>(11, blend_height);
+}
+
+void CLTileBlending::run()
+{
+    // The memory of the image is imported for each frame, so the buffers are set for each run.
+    set_tensor_arguments(kernel, 0, *tile);
+    set_tensor_arguments(kernel, 4, *image);
+    arm_compute::CLScheduler::get().queue().enqueueNDRangeKernel(kernel, cl::NullRange, global_size, cl::NullRange);
+}
@@ -0,0 +1,47 @@
+/* Copyright (c) 2022, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 the "License";
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <arm_compute/core/CL/ICLTensor.h>
+#include <arm_compute/core/CL/OpenCL.h>
+#include <arm_compute/runtime/IFunction.h>
+
+/*
+ * Writes a processed tile of an RGBA8 NHWC image back to the image in a single OpenCL kernel.
+ * Across the overlap with the tiles written before, the tile is blended with the image with a weight growing linearly
+ * from the edge of the tile, so that there are no seams between tiles. The alpha channel of the image is kept unchanged.
+ */
+class CLTileBlending : public arm_compute::IFunction
+{
+public:
+    void configure(const arm_compute::ICLTensor* tile, arm_compute::ICLTensor* image);
+
+    // Position of the tile in the image and the width of the overlap with the tiles on the left and above it.
+    void set_tile(uint32_t x, uint32_t y, uint32_t blend_width, uint32_t blend_height);
+
+    void run() override;
+
+private:
+    const arm_compute::ICLTensor* tile{nullptr};
+
+    arm_compute::ICLTensor* image{nullptr};
+
+    cl::Kernel kernel;
+
+    cl::NDRange global_size;
+};
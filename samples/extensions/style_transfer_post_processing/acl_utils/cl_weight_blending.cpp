@@ -0,0 +1,81 @@
+/* Copyright (c) 2022, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 the "License";
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "cl_weight_blending.h"
+#include "cl_program_cache.h"
+#include <arm_compute/runtime/CL/CLScheduler.h>
+
+namespace
+{
+// Half values are loaded and stored with vload_half and vstore_half, which don't require cl_khr_fp16.
+const char* WEIGHT_BLENDING_SOURCE = R"(
+#if defined(HALF)
+#define LOAD(buffer, i) vload_half(i, buffer)
+#define STORE(value, buffer, i) vstore_half_rte(value, i, buffer)
+#define DATA_TYPE half
+#else
+#define LOAD(buffer, i) buffer[i]
+#define STORE(value, buffer, i) buffer[i] = value
+#define DATA_TYPE float
+#endif
+
+__kernel void weight_blending(__global const DATA_TYPE* first,
+                              __global const DATA_TYPE* second,
+                              __global DATA_TYPE* output,
+                              float factor)
+{
+    uint i = get_global_id(0);
+    STORE(mix(LOAD(first, i), LOAD(second, i), factor), output, i);
+}
+)";
+}        // namespace
+
+void CLWeightBlending::configure(const arm_compute::ICLTensor* first, const arm_compute::ICLTensor* second, arm_compute::ICLTensor* output)
+{
+    const auto& info = *output->info();
+    if(info.data_type() != arm_compute::DataType::F32 && info.data_type() != arm_compute::DataType::F16)
+    {
+        throw std::runtime_error("CLWeightBlending supports only F32 and F16 tensors.");
+    }
+    for(const auto* input : {first, second})
+    {
+        if(input->info()->data_type() != info.data_type() || input->info()->total_size() != info.total_size())
+        {
+            throw std::runtime_error("CLWeightBlending requires tensors with the same data type and size.");
+        }
+    }
+
+    std::string options = info.data_type() == arm_compute::DataType::F16 ? "-DHALF" : "";
+    auto program = CLProgramCache::get_program("weight_blending" + options, WEIGHT_BLENDING_SOURCE, options);
+    kernel = cl::Kernel(program, "weight_blending");
+    kernel.setArg(0, first->cl_buffer());
+    kernel.setArg(1, second->cl_buffer());
+    kernel.setArg(2, output->cl_buffer());
+
+    global_size = cl::NDRange(info.total_size() / info.element_size());
+    set_factor(0.0f);
+}
+
+void CLWeightBlending::set_factor(float factor)
+{
+    kernel.setArg<cl_float>(3, factor);
+}
+
+void CLWeightBlending::run()
+{
+    arm_compute::CLScheduler::get().queue().enqueueNDRangeKernel(kernel, cl::NullRange, global_size, cl::NullRange);
+}
@@ -0,0 +1,42 @@
+/* Copyright (c) 2022, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 the "License";
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <arm_compute/core/CL/ICLTensor.h>
+#include <arm_compute/core/CL/OpenCL.h>
+#include <arm_compute/runtime/IFunction.h>
+
+/*
+ * Interpolates two F32 or F16 tensors of the same shape and padding into the output tensor in a single OpenCL kernel,
+ * e.g. the weights of a layer between two styles. The whole buffers are interpolated, including the padding.
+ */
+class CLWeightBlending : public arm_compute::IFunction
+{
+public:
+    void configure(const arm_compute::ICLTensor* first, const arm_compute::ICLTensor* second, arm_compute::ICLTensor* output);
+
+    // 0 writes the first tensor to the output, 1 the second one.
+    void set_factor(float factor);
+
+    void run() override;
+
+private:
+    cl::Kernel kernel;
+
+    cl::NDRange global_size;
+};
@@ -0,0 +1,302 @@
+/* Copyright (c) 2022, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 the "License";
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "graph_optimizer.h"
+#include <common/logging.h>
+#include <timer.h>
+#include <algorithm>
+
+namespace
+{
+using ActivationFunction = arm_compute::ActivationLayerInfo::ActivationFunction;
+
+// Returns the index of the node which produces the tensor, or -1 if the tensor is the graph input.
+int32_t find_producer(const NetworkGraph& graph, uint32_t tensor)
+{
+    const auto& nodes = graph.get_nodes();
+    for(size_t i = 0; i < nodes.size(); i++)
+    {
+        if(nodes[i].output == tensor)
+        {
+            return static_cast<int32_t>(i);
+        }
+    }
+    return -1;
+}
+
+bool is_convolution(const GraphNode& node)
+{
+    return node.type == GraphNodeType::Conv2D || node.type == GraphNodeType::DepthwiseConv2D || node.type == GraphNodeType::TransposeConv2D;
+}
+
+bool is_linear(const GraphNode& node)
+{
+    return node.type == GraphNodeType::Activation && node.activation == ActivationFunction::LINEAR && !node.in_place;
+}
+
+// Kernel values of the channel c are at indices i where (i / channel_inner_size) % channels == c.
+uint32_t get_channel_inner_size(const NetworkGraph& graph, const GraphNode& node)
+{
+    if(node.type == GraphNodeType::DepthwiseConv2D)
+    {
+        return 1;
+    }
+    uint32_t input_features = graph.get_tensors()[node.inputs[0]].shape[0];
+    return input_features * node.kernel_width * node.kernel_height;
+}
+
+// Returns the node producing the input of the node at index, if the node is its only reader.
+int32_t find_single_reader_producer(const NetworkGraph& graph, size_t index)
+{
+    uint32_t input = graph.get_nodes()[index].inputs[0];
+    if(graph.count_readers(input) != 1)
+    {
+        return -1;
+    }
+    return find_producer(graph, input);
+}
+
+// The producer takes over the output of the node at index, which is removed.
+void merge_into_producer(NetworkGraph& graph, size_t index, int32_t producer)
+{
+    auto& nodes = graph.get_nodes();
+    nodes[producer].output = nodes[index].output;
+    nodes.erase(nodes.begin() + index);
+}
+
+uint32_t eliminate_dead_nodes(NetworkGraph& graph)
+{
+    // Nodes are in execution order, so walking backwards removes whole chains of unused nodes at once.
+    auto& nodes = graph.get_nodes();
+    uint32_t removed = 0;
+    for(size_t i = nodes.size(); i-- > 0;)
+    {
+        if(graph.count_readers(nodes[i].output) == 0)
+        {
+            nodes.erase(nodes.begin() + i);
+            removed++;
+        }
+    }
+    return removed;
+}
+
+uint32_t fold_constants(NetworkGraph& graph)
+{
+    // a2 * (a1 * x + b1) + b2 = (a2 * a1) * x + (a2 * b1 + b2)
+    auto& nodes = graph.get_nodes();
+    uint32_t folded = 0;
+    for(size_t i = nodes.size(); i-- > 0;)
+    {
+        auto producer = find_single_reader_producer(graph, i);
+        if(!is_linear(nodes[i]) || producer < 0 || !is_linear(nodes[producer]))
+        {
+            continue;
+        }
+        auto& first = nodes[producer];
+        const auto& second = nodes[i];
+        first.activation_b = second.activation_a * first.activation_b + second.activation_b;
+        first.activation_a = second.activation_a * first.activation_a;
+        merge_into_producer(graph, i, producer);
+        folded++;
+    }
+    return folded;
+}
+
+uint32_t fuse_activations(NetworkGraph& graph)
+{
+    auto& nodes = graph.get_nodes();
+    uint32_t fused = 0;
+    for(size_t i = nodes.size(); i-- > 0;)
+    {
+        auto producer = find_single_reader_producer(graph, i);
+        if(nodes[i].type != GraphNodeType::Activation || nodes[i].in_place || producer < 0 || nodes[producer].activation != ActivationFunction::IDENTITY)
+        {
+            continue;
+        }
+
+        // Only RELU is fused, ACL deconvolution has no fused activation.
+        auto& target = nodes[producer];
+        bool relu_target = target.type == GraphNodeType::Conv2D || target.type == GraphNodeType::DepthwiseConv2D || target.type == GraphNodeType::Addition;
+        if(!relu_target || nodes[i].activation != ActivationFunction::RELU)
+        {
+            continue;
+        }
+
+        target.activation = nodes[i].activation;
+        target.activation_a = nodes[i].activation_a;
+        target.activation_b = nodes[i].activation_b;
+        merge_into_producer(graph, i, producer);
+        fused++;
+    }
+    return fused;
+}
+
+uint32_t fold_affine(NetworkGraph& graph)
+{
+    auto& nodes = graph.get_nodes();
+    uint32_t folded = 0;
+    for(size_t i = nodes.size(); i-- > 0;)
+    {
+        if(!is_linear(nodes[i]))
+        {
+            continue;
+        }
+        float a = nodes[i].activation_a;
+        float b = nodes[i].activation_b;
+
+        // Linear activation after a convolution: a * (W * x + bias) + b = (a * W) * x + (a * bias + b)
+        auto producer = find_single_reader_producer(graph, i);
+        if(producer >= 0 && is_convolution(nodes[producer]) && nodes[producer].activation == ActivationFunction::IDENTITY)
+        {
+            auto& conv = nodes[producer];
+            for(auto& value : conv.kernel_values.get_mutable())
+            {
+                value *= a;
+            }
+            for(auto& value : conv.bias_values.get_mutable())
+            {
+                value = a * value + b;
+            }
+            merge_into_producer(graph, i, producer);
+            folded++;
+            continue;
+        }
+
+        // Linear activation before a convolution: W * (a * x + b) + bias = (a * W) * x + (b * sum(W) + bias)
+        // Padding is added after the activation, so with a bias this is only valid for convolutions without padding.
+        uint32_t output = nodes[i].output;
+        if(output == graph.get_output() || graph.count_readers(output) != 1)
+        {
+            continue;
+        }
+        auto reader = std::find_if(nodes.begin() + i + 1, nodes.end(), [output](const GraphNode& node) {
+            return std::find(node.inputs.begin(), node.inputs.end(), output) != node.inputs.end();
+        });
+        if(reader == nodes.end() || !is_convolution(*reader))
+        {
+            continue;
+        }
+        bool padded = reader->pad_x_front || reader->pad_x_back || reader->pad_y_front || reader->pad_y_back;
+        if(b != 0.0f && (padded || reader->type == GraphNodeType::TransposeConv2D))
+        {
+            continue;
+        }
+
+        auto channel_inner_size = get_channel_inner_size(graph, *reader);
+        auto& kernel_values = reader->kernel_values.get_mutable();
+        auto& bias_values = reader->bias_values.get_mutable();
+        auto channels = static_cast<uint32_t>(bias_values.size());
+        for(size_t v = 0; v < kernel_values.size(); v++)
+        {
+            bias_values[(v / channel_inner_size) % channels] += b * kernel_values[v];
+            kernel_values[v] *= a;
+        }
+        reader->inputs[0] = nodes[i].inputs[0];
+        nodes.erase(nodes.begin() + i);
+        folded++;
+    }
+    return folded;
+}
+
+uint32_t mark_in_place(NetworkGraph& graph)
+{
+    auto& nodes = graph.get_nodes();
+    const auto& tensors = graph.get_tensors();
+    uint32_t marked = 0;
+    for(size_t i = 0; i < nodes.size(); i++)
+    {
+        auto& node = nodes[i];
+        if(node.type != GraphNodeType::Activation || node.in_place || find_single_reader_producer(graph, i) < 0)
+        {
+            continue;
+        }
+
+        // Model tensors are kept, so that their values can be read after the network is run (e.g. for calibration).
+        const auto& input = tensors[node.inputs[0]];
+        const auto& output = tensors[node.output];
+        if(input.model_index >= 0 || input.data_type != output.data_type || !(input.quantization == output.quantization))
+        {
+            continue;
+        }
+        node.in_place = true;
+        marked++;
+    }
+    return marked;
+}
+}        // namespace
+
+const std::vector<GraphPass>& GraphOptimizer::get_default_passes()
+{
+    static const std::vector<GraphPass> passes = {
+        GraphPass::DeadNodeElimination,
+        GraphPass::ConstantFolding,
+        GraphPass::ActivationFusion,
+        GraphPass::AffineFolding,
+        GraphPass::InPlaceMarking
+    };
+    return passes;
+}
+
+void GraphOptimizer::optimize(NetworkGraph& graph, const std::vector<GraphPass>& passes)
+{
+    size_t initial_nodes = graph.get_nodes().size();
+    for(auto pass : passes)
+    {
+        vkb::Timer timer;
+        timer.start();
+        auto changes = run_pass(graph, pass);
+        auto duration = timer.stop<vkb::Timer::Milliseconds>();
+        LOGI("Graph pass {}: {} changes, {} nodes left, {:.3f} ms", get_pass_name(pass), changes, graph.get_nodes().size(), duration);
+    }
+    LOGI("Graph optimized from {} to {} nodes", initial_nodes, graph.get_nodes().size());
+}
+
+uint32_t GraphOptimizer::run_pass(NetworkGraph& graph, GraphPass pass)
+{
+    switch(pass)
+    {
+        case GraphPass::DeadNodeElimination:
+            return eliminate_dead_nodes(graph);
+        case GraphPass::ConstantFolding:
+            return fold_constants(graph);
+        case GraphPass::ActivationFusion:
+            return fuse_activations(graph);
+        case GraphPass::AffineFolding:
+            return fold_affine(graph);
+        case GraphPass::InPlaceMarking:
+            return mark_in_place(graph);
+    }
+    return 0;
+}
+
+const char* GraphOptimizer::get_pass_name(GraphPass pass)
+{
+    switch(pass)
+    {
+        case GraphPass::DeadNodeElimination:
+            return "DeadNodeElimination";
+        case GraphPass::ConstantFolding:
+            return "ConstantFolding";
+        case GraphPass::ActivationFusion:
+            return "ActivationFusion";
+        case GraphPass::AffineFolding:
+            return "AffineFolding";
+        case GraphPass::InPlaceMarking:
+            return "InPlaceMarking";
+    }
+    return "Unknown";
+}
@@ -0,0 +1,53 @@
+/* Copyright (c) 2022, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 the "License";
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "network_graph.h"
+#include <vector>
+
+enum class GraphPass
+{
+    // Removes nodes whose results are not used.
+    DeadNodeElimination,
+    // Merges chains of linear activations into a single one.
+    ConstantFolding,
+    // Fuses activations into the layers that produce their inputs (e.g. ADD + RELU).
+    ActivationFusion,
+    // Folds scale and bias of linear activations into the weights of adjacent convolutions.
+    AffineFolding,
+    // Marks activations that can overwrite their input instead of writing a new tensor.
+    InPlaceMarking
+};
+
+/*
+ * Optimization passes that run on the NetworkGraph before the ACL layers are created.
+ * Each pass can be run on its own, its duration and the number of changes it made are logged.
+ */
+class GraphOptimizer
+{
+public:
+    // All the passes in the order they are run by default.
+    static const std::vector<GraphPass>& get_default_passes();
+
+    static void optimize(NetworkGraph& graph, const std::vector<GraphPass>& passes = get_default_passes());
+
+    // Returns the number of changes the pass made to the graph.
+    static uint32_t run_pass(NetworkGraph& graph, GraphPass pass);
+
+    static const char* get_pass_name(GraphPass pass);
+};
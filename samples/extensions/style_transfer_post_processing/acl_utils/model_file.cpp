@@ -0,0 +1,75 @@
+/* Copyright (c) 2022, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 the "License";
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "model_file.h"
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+ModelFile::ModelFile(const std::string& path)
+{
+    int file = open(path.c_str(), O_RDONLY);
+    if(file < 0)
+    {
+        throw std::runtime_error("Cannot open model file " + path);
+    }
+
+    struct stat file_stat{};
+    if(fstat(file, &file_stat) != 0 || file_stat.st_size == 0)
+    {
+        close(file);
+        throw std::runtime_error("Cannot read size of model file " + path);
+    }
+    mapped_size = static_cast<size_t>(file_stat.st_size);
+
+    // The mapping stays valid after the file is closed.
+    void* mapping = mmap(nullptr, mapped_size, PROT_READ, MAP_PRIVATE, file, 0);
+    close(file);
+    if(mapping == MAP_FAILED)
+    {
+        throw std::runtime_error("Cannot map model file " + path);
+    }
+    mapped_data = static_cast<const uint8_t*>(mapping);
+}
+
+ModelFile::~ModelFile()
+{
+    munmap(const_cast<uint8_t*>(mapped_data), mapped_size);
+}
+
+const uint8_t* ModelFile::data() const
+{
+    return mapped_data;
+}
+
+size_t ModelFile::size() const
+{
+    return mapped_size;
+}
+
+size_t ModelFile::get_hash() const
+{
+    // FNV-1a
+    uint64_t hash = 14695981039346656037ull;
+    for(size_t i = 0; i < mapped_size; i++)
+    {
+        hash = (hash ^ mapped_data[i]) * 1099511628211ull;
+    }
+    return static_cast<size_t>(hash);
+}
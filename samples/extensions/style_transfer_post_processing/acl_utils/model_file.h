@@ -0,0 +1,51 @@
+/* Copyright (c) 2022, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 the "License";
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/*
+ * Read-only memory mapping of a model file.
+ * The model is parsed in place and the weights are copied from the mapped pages directly to the tensors,
+ * so the file is never read into a separate buffer. The pages are backed by the file and can be dropped by the system at any time.
+ */
+class ModelFile
+{
+public:
+    explicit ModelFile(const std::string& path);
+
+    ~ModelFile();
+
+    ModelFile(const ModelFile&) = delete;
+
+    ModelFile& operator=(const ModelFile&) = delete;
+
+    const uint8_t* data() const;
+
+    size_t size() const;
+
+    // Hash of the file content, used to identify data stored for this model (e.g. tuning results).
+    size_t get_hash() const;
+
+private:
+    const uint8_t* mapped_data{nullptr};
+
+    size_t mapped_size{0};
+};
@@ -0,0 +1,137 @@
+/* Copyright (c) 2022, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 the "License";
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ne_color_conversion.h"
+#include <arm_compute/core/Utils.h>
+#include <arm_compute/runtime/Scheduler.h>
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+float load_value(const uint8_t* ptr, arm_compute::DataType data_type, const arm_compute::UniformQuantizationInfo& quantization)
+{
+    switch(data_type)
+    {
+        case arm_compute::DataType::F32:
+            return *reinterpret_cast<const float*>(ptr);
+        case arm_compute::DataType::F16:
+            return static_cast<float>(*reinterpret_cast<const arm_compute::half*>(ptr));
+        default:
+            return (static_cast<float>(*ptr) - quantization.offset) * quantization.scale;
+    }
+}
+
+void store_value(float value, uint8_t* ptr, arm_compute::DataType data_type, const arm_compute::UniformQuantizationInfo& quantization)
+{
+    switch(data_type)
+    {
+        case arm_compute::DataType::F32:
+            *reinterpret_cast<float*>(ptr) = value;
+            break;
+        case arm_compute::DataType::F16:
+            *reinterpret_cast<arm_compute::half*>(ptr) = arm_compute::half(value);
+            break;
+        default:
+            // Rounds to nearest even and saturates, as convert_uchar_sat_rte() in the OpenCL kernel.
+            *ptr = static_cast<uint8_t>(std::min(std::max(std::nearbyint(value / quantization.scale + quantization.offset), 0.0f), 255.0f));
+            break;
+    }
+}
+
+void check_data_type(arm_compute::DataType data_type)
+{
+    switch(data_type)
+    {
+        case arm_compute::DataType::F32:
+        case arm_compute::DataType::F16:
+        case arm_compute::DataType::QASYMM8:
+        case arm_compute::DataType::U8:
+            break;
+        default:
+            throw std::runtime_error("NEColorConversion does not support " + arm_compute::string_from_data_type(data_type) + " tensors.");
+    }
+}
+
+arm_compute::UniformQuantizationInfo get_quantization(const arm_compute::ITensorInfo& info)
+{
+    auto quantization = info.quantization_info().uniform();
+    if(quantization.scale == 0.0f)
+    {
+        quantization.scale = 1.0f;
+    }
+    return quantization;
+}
+}        // namespace
+
+void NEColorConversion::configure(const arm_compute::ITensor* input, arm_compute::ITensor* output, const ColorConversionInfo& info)
+{
+    this->input = input;
+    this->output = output;
+    this->info = info;
+
+    const auto& input_shape = input->info()->tensor_shape();
+    const auto& output_shape = output->info()->tensor_shape();
+    if(input_shape[1] != output_shape[1] || input_shape[2] != output_shape[2] || input_shape[3] != output_shape[3])
+    {
+        throw std::runtime_error("NEColorConversion requires input and output of the same size and batch size.");
+    }
+    check_data_type(input->info()->data_type());
+    check_data_type(output->info()->data_type());
+    channels = static_cast<uint32_t>(std::min(input_shape[0], output_shape[0]));
+}
+
+void NEColorConversion::run()
+{
+    // Strides are read for each run, like in CLColorConversion, other layers can extend the padding of the tensors.
+    const auto& input_info = *input->info();
+    const auto& output_info = *output->info();
+    auto input_quantization = get_quantization(input_info);
+    auto output_quantization = get_quantization(output_info);
+    auto width = static_cast<uint32_t>(input_info.dimension(1));
+    auto height = static_cast<uint32_t>(input_info.dimension(2));
+    auto batch_size = static_cast<uint32_t>(input_info.dimension(3));
+
+    std::vector<arm_compute::IScheduler::Workload> workloads(arm_compute::Scheduler::get().num_threads());
+    for(auto& workload : workloads)
+    {
+        workload = [&](const arm_compute::ThreadInfo& thread_info)
+        {
+            // Rows of all the images in the batch are split between the threads.
+            for(uint32_t row = thread_info.thread_id; row < height * batch_size; row += thread_info.num_threads)
+            {
+                uint32_t n = row / height;
+                uint32_t y = row % height;
+                const uint8_t* src_row = input->buffer() + input_info.offset_first_element_in_bytes() + y * input_info.strides_in_bytes()[2] + n * input_info.strides_in_bytes()[3];
+                uint8_t* dst_row = output->buffer() + output_info.offset_first_element_in_bytes() + y * output_info.strides_in_bytes()[2] + n * output_info.strides_in_bytes()[3];
+                for(uint32_t x = 0; x < width; x++)
+                {
+                    const uint8_t* src = src_row + x * input_info.strides_in_bytes()[1];
+                    uint8_t* dst = dst_row + x * output_info.strides_in_bytes()[1];
+                    for(uint32_t c = 0; c < channels; c++)
+                    {
+                        float value = load_value(src + c * input_info.strides_in_bytes()[0], input_info.data_type(), input_quantization) * info.pre_scale + info.pre_bias;
+                        // Negative values are clamped, pow() of a negative base is undefined.
+                        value = std::pow(std::max(value, 0.0f), info.exponent) * info.post_scale + info.post_bias;
+                        store_value(value, dst + c * output_info.strides_in_bytes()[0], output_info.data_type(), output_quantization);
+                    }
+                }
+            }
+        };
+    }
+    arm_compute::Scheduler::get().run_tagged_workloads(workloads, "NEColorConversion");
+}
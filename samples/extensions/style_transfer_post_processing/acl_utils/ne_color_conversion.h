@@ -0,0 +1,42 @@
+/* Copyright (c) 2022, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 the "License";
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "cl_color_conversion.h"
+#include <arm_compute/core/ITensor.h>
+#include <arm_compute/runtime/IFunction.h>
+
+/*
+ * CPU version of CLColorConversion with the same conversion and data types, the rows are split between the threads of the ACL scheduler.
+ */
+class NEColorConversion : public arm_compute::IFunction
+{
+public:
+    void configure(const arm_compute::ITensor* input, arm_compute::ITensor* output, const ColorConversionInfo& info);
+
+    void run() override;
+
+private:
+    const arm_compute::ITensor* input{nullptr};
+
+    arm_compute::ITensor* output{nullptr};
+
+    ColorConversionInfo info;
+
+    uint32_t channels{0};
+};
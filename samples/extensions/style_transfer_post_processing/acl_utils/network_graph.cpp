@@ -0,0 +1,274 @@
+/* Copyright (c) 2022, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 the "License";
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "network_graph.h"
+#include <algorithm>
+#include <cmath>
+
+uint32_t NetworkGraph::add_tensor(const GraphTensor& tensor)
+{
+    tensors.push_back(tensor);
+    return static_cast<uint32_t>(tensors.size() - 1);
+}
+
+uint32_t NetworkGraph::add_node(GraphNode node, const GraphTensor& output_tensor)
+{
+    node.output = add_tensor(output_tensor);
+    nodes.push_back(std::move(node));
+    return nodes.back().output;
+}
+
+std::vector<GraphNode>& NetworkGraph::get_nodes()
+{
+    return nodes;
+}
+
+const std::vector<GraphNode>& NetworkGraph::get_nodes() const
+{
+    return nodes;
+}
+
+std::vector<GraphTensor>& NetworkGraph::get_tensors()
+{
+    return tensors;
+}
+
+const std::vector<GraphTensor>& NetworkGraph::get_tensors() const
+{
+    return tensors;
+}
+
+void NetworkGraph::set_input(uint32_t tensor)
+{
+    input = tensor;
+}
+
+void NetworkGraph::set_output(uint32_t tensor)
+{
+    output = tensor;
+}
+
+uint32_t NetworkGraph::get_input() const
+{
+    return input;
+}
+
+uint32_t NetworkGraph::get_output() const
+{
+    return output;
+}
+
+uint32_t NetworkGraph::count_readers(uint32_t tensor) const
+{
+    uint32_t readers = tensor == output ? 1 : 0;
+    for(const auto& node : nodes)
+    {
+        readers += static_cast<uint32_t>(std::count(node.inputs.begin(), node.inputs.end(), tensor));
+    }
+    return readers;
+}
+
+uint32_t NetworkGraph::get_receptive_field_rows() const
+{
+    // Scale is the size of one row of the current tensor in image rows.
+    float scale = 1.0f;
+    float rows = 0.0f;
+    for(const auto& node : nodes)
+    {
+        if(node.type == GraphNodeType::Conv2D || node.type == GraphNodeType::DepthwiseConv2D)
+        {
+            rows += static_cast<float>((node.kernel_height - 1) / 2 * node.dilation_y) * scale;
+            scale *= static_cast<float>(node.stride_y);
+        }
+        else if(node.type == GraphNodeType::TransposeConv2D)
+        {
+            scale /= static_cast<float>(node.stride_y);
+            rows += static_cast<float>((node.kernel_height - 1) / 2) * scale;
+        }
+    }
+    return static_cast<uint32_t>(std::ceil(rows));
+}
+
+uint32_t NetworkGraph::get_vertical_downsampling() const
+{
+    uint32_t scale = 1;
+    uint32_t downsampling = 1;
+    for(const auto& node : nodes)
+    {
+        if(node.type == GraphNodeType::Conv2D || node.type == GraphNodeType::DepthwiseConv2D)
+        {
+            scale *= node.stride_y;
+        }
+        else if(node.type == GraphNodeType::TransposeConv2D)
+        {
+            scale = std::max(scale / node.stride_y, 1u);
+        }
+        downsampling = std::max(downsampling, scale);
+    }
+    return downsampling;
+}
+
+std::unique_ptr<ACLNetwork> NetworkGraph::create_network(const arm_compute::ITensor& input_output_tensor,
+                                                         arm_compute::DataType data_type,
+                                                         ACLNetwork::ActivationMemoryMode memory_mode,
+                                                         bool validate_layers,
+                                                         std::shared_ptr<ACLNetwork::SharedWeights> shared_weights) const
+{
+    // The network runs on the backend that can use the input and output tensor.
+    auto network = std::make_unique<ACLNetwork>(data_type, memory_mode, ACLNetwork::get_tensor_backend(input_output_tensor));
+    network->set_shared_weights(std::move(shared_weights));
+    network->set_layer_validation(validate_layers);
+    add_layers(*network, input_output_tensor);
+    return network;
+}
+
+std::unique_ptr<ACLNetwork> NetworkGraph::create_blended_network(const arm_compute::ITensor& input_output_tensor,
+                                                                 arm_compute::DataType data_type,
+                                                                 ACLNetwork::ActivationMemoryMode memory_mode,
+                                                                 const NetworkGraph& second_graph) const
+{
+    auto network = std::make_unique<ACLNetwork>(data_type, memory_mode, ACLNetwork::get_tensor_backend(input_output_tensor));
+    network->enable_weight_blending();
+    add_layers(*network, input_output_tensor);
+
+    // Layers with weights are blended in the order of their nodes.
+    const auto& second_nodes = second_graph.get_nodes();
+    if(second_nodes.size() != nodes.size())
+    {
+        throw std::runtime_error("Graphs with a different number of nodes cannot be blended.");
+    }
+    size_t blended_layer = 0;
+    for(size_t i = 0; i < nodes.size(); i++)
+    {
+        const auto& node = nodes[i];
+        const auto& second_node = second_nodes[i];
+        if(node.type != second_node.type || node.kernel_width != second_node.kernel_width || node.kernel_height != second_node.kernel_height ||
+           node.output_features != second_node.output_features)
+        {
+            throw std::runtime_error("Node " + std::to_string(i) + " of the blended graphs doesn't match.");
+        }
+        if(node.type == GraphNodeType::Conv2D || node.type == GraphNodeType::DepthwiseConv2D || node.type == GraphNodeType::TransposeConv2D)
+        {
+            network->set_blend_weights(blended_layer++, second_node.kernel_values, second_node.bias_values);
+        }
+    }
+
+    return network;
+}
+
+void NetworkGraph::add_layers(ACLNetwork& network, const arm_compute::ITensor& input_output_tensor) const
+{
+    std::vector<const arm_compute::ITensor*> acl_tensors(tensors.size(), nullptr);
+    acl_tensors[input] = &input_output_tensor;
+
+    for(const auto& node : nodes)
+    {
+        const auto& input_tensor = *acl_tensors.at(node.inputs[0]);
+        const auto& output_tensor = tensors[node.output];
+        arm_compute::ITensor* result = nullptr;
+
+        switch(node.type)
+        {
+            case GraphNodeType::ColorConversion:
+                if(node.output == output)
+                {
+                    network.add_color_conversion(input_tensor, input_output_tensor, node.color_conversion);
+                    acl_tensors[node.output] = &input_output_tensor;
+                    continue;
+                }
+                result = &network.add_color_conversion(input_tensor,
+                                                       output_tensor.shape[0],
+                                                       node.color_conversion,
+                                                       output_tensor.data_type,
+                                                       output_tensor.quantization);
+                break;
+            case GraphNodeType::Activation:
+                result = &network.add_activation(input_tensor,
+                                                 node.activation,
+                                                 node.activation_a,
+                                                 node.activation_b,
+                                                 output_tensor.quantization,
+                                                 node.in_place);
+                break;
+            case GraphNodeType::Addition:
+                result = &network.add_addition(input_tensor, *acl_tensors.at(node.inputs[1]), node.activation, output_tensor.quantization);
+                break;
+            case GraphNodeType::Conv2D:
+                result = &network.add_conv2d(input_tensor,
+                                             node.kernel_width,
+                                             node.kernel_height,
+                                             node.output_features,
+                                             node.pad_x_front,
+                                             node.pad_x_back,
+                                             node.pad_y_front,
+                                             node.pad_y_back,
+                                             node.stride_x,
+                                             node.stride_y,
+                                             node.kernel_values,
+                                             node.bias_values,
+                                             node.activation,
+                                             node.dilation_x,
+                                             node.dilation_y,
+                                             output_tensor.quantization,
+                                             node.has_convolution_method ? &node.convolution_method : nullptr);
+                break;
+            case GraphNodeType::DepthwiseConv2D:
+                result = &network.add_depthwise_conv2d(input_tensor,
+                                                       node.kernel_width,
+                                                       node.kernel_height,
+                                                       node.pad_x_front,
+                                                       node.pad_x_back,
+                                                       node.pad_y_front,
+                                                       node.pad_y_back,
+                                                       node.stride_x,
+                                                       node.stride_y,
+                                                       node.kernel_values,
+                                                       node.bias_values,
+                                                       node.activation,
+                                                       node.dilation_x,
+                                                       node.dilation_y,
+                                                       output_tensor.quantization);
+                break;
+            case GraphNodeType::TransposeConv2D:
+                result = &network.add_conv2d_transpose(input_tensor,
+                                                       node.kernel_width,
+                                                       node.kernel_height,
+                                                       node.output_features,
+                                                       node.pad_x_front,
+                                                       node.pad_x_back,
+                                                       node.pad_y_front,
+                                                       node.pad_y_back,
+                                                       node.stride_x,
+                                                       node.stride_y,
+                                                       node.kernel_values,
+                                                       node.bias_values,
+                                                       output_tensor.quantization);
+                break;
+        }
+
+        acl_tensors[node.output] = result;
+        if(output_tensor.model_index >= 0)
+        {
+            network.set_model_tensor(output_tensor.model_index, *result);
+        }
+    }
+
+    if(acl_tensors[output] != &input_output_tensor)
+    {
+        throw std::runtime_error("The graph output must be produced by a color conversion node.");
+    }
+}
@@ -0,0 +1,171 @@
+/* Copyright (c) 2022, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 the "License";
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "acl_network.h"
+#include <memory>
+#include <vector>
+
+// Type of a node in the network graph, each node is lowered to one ACLNetwork layer.
+enum class GraphNodeType
+{
+    ColorConversion,
+    Activation,
+    Addition,
+    Conv2D,
+    DepthwiseConv2D,
+    TransposeConv2D
+};
+
+struct GraphTensor
+{
+    // Shape in ACL order (channels, width, height).
+    std::vector<uint32_t> shape;
+
+    arm_compute::DataType data_type{arm_compute::DataType::F32};
+
+    arm_compute::QuantizationInfo quantization;
+
+    // Index of the tensor in the source model, -1 if the tensor was added by the parser or an optimization pass.
+    int32_t model_index{-1};
+};
+
+struct GraphNode
+{
+    explicit GraphNode(GraphNodeType type) :
+        type(type)
+    {}
+
+    GraphNodeType type;
+
+    std::vector<uint32_t> inputs;
+
+    uint32_t output{0};
+
+    // Activation applied to the result. For Activation nodes this is the operation itself.
+    arm_compute::ActivationLayerInfo::ActivationFunction activation{arm_compute::ActivationLayerInfo::ActivationFunction::IDENTITY};
+
+    float activation_a{0.0f};
+
+    float activation_b{0.0f};
+
+    uint32_t kernel_width{0};
+
+    uint32_t kernel_height{0};
+
+    uint32_t output_features{0};
+
+    uint32_t pad_x_front{0};
+
+    uint32_t pad_x_back{0};
+
+    uint32_t pad_y_front{0};
+
+    uint32_t pad_y_back{0};
+
+    uint32_t stride_x{1};
+
+    uint32_t stride_y{1};
+
+    uint32_t dilation_x{1};
+
+    uint32_t dilation_y{1};
+
+    // Constant buffers of the node, stored in the tflite order.
+    // They point to the model until an optimization pass modifies them, so the model must outlive the graph.
+    ConstantValues kernel_values;
+
+    ConstantValues bias_values;
+
+    // Method of Conv2D nodes, it is chosen by ACL when the network is created unless it's already known.
+    bool has_convolution_method{false};
+
+    arm_compute::ConvolutionMethod convolution_method{arm_compute::ConvolutionMethod::GEMM};
+
+    ColorConversionInfo color_conversion;
+
+    // The output shares memory with the input, the node overwrites its input.
+    bool in_place{false};
+};
+
+/*
+ * In-memory representation of the network between parsing and creating ACL layers.
+ * Nodes are stored in execution order and each of them produces a single tensor.
+ * The graph input and output tensors are both mapped to the image processed by the network.
+ */
+class NetworkGraph
+{
+public:
+    uint32_t add_tensor(const GraphTensor& tensor);
+
+    // Adds a node with a new output tensor and returns the index of that tensor.
+    uint32_t add_node(GraphNode node, const GraphTensor& output_tensor);
+
+    std::vector<GraphNode>& get_nodes();
+
+    const std::vector<GraphNode>& get_nodes() const;
+
+    std::vector<GraphTensor>& get_tensors();
+
+    const std::vector<GraphTensor>& get_tensors() const;
+
+    void set_input(uint32_t tensor);
+
+    void set_output(uint32_t tensor);
+
+    uint32_t get_input() const;
+
+    uint32_t get_output() const;
+
+    // Number of nodes which read the tensor, the graph output counts as a reader too.
+    uint32_t count_readers(uint32_t tensor) const;
+
+    // Number of image rows above and below a pixel that can affect its output, the sum of the kernel radii of the nodes.
+    // Residual branches are counted as if they were sequential, so the result can be larger than the actual receptive field.
+    uint32_t get_receptive_field_rows() const;
+
+    // Largest product of the vertical strides, the image height must be a multiple of it to keep the output size.
+    uint32_t get_vertical_downsampling() const;
+
+    // Creates ACL layers for all the nodes. Tensors with a model index are registered in the network.
+    // The graph output must be produced by a color conversion, which writes directly to the processed image.
+    // Networks created with the same shared weights for other image sizes use the same kernels and biases.
+    std::unique_ptr<ACLNetwork> create_network(const arm_compute::ITensor& input_output_tensor,
+                                               arm_compute::DataType data_type,
+                                               ACLNetwork::ActivationMemoryMode memory_mode,
+                                               bool validate_layers = true,
+                                               std::shared_ptr<ACLNetwork::SharedWeights> shared_weights = nullptr) const;
+
+    // Creates a network which blends the weights of this graph with the weights of the second graph, see ACLNetwork::set_blend_factor().
+    // The second graph must have the same nodes with other constant values, e.g. another style of the same architecture optimized the same way.
+    std::unique_ptr<ACLNetwork> create_blended_network(const arm_compute::ITensor& input_output_tensor,
+                                                       arm_compute::DataType data_type,
+                                                       ACLNetwork::ActivationMemoryMode memory_mode,
+                                                       const NetworkGraph& second_graph) const;
+
+private:
+    void add_layers(ACLNetwork& network, const arm_compute::ITensor& input_output_tensor) const;
+
+    std::vector<GraphNode> nodes;
+
+    std::vector<GraphTensor> tensors;
+
+    uint32_t input{0};
+
+    uint32_t output{0};
+};
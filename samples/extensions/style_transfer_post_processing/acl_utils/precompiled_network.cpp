@@ -0,0 +1,395 @@
+/* Copyright (c) 2022, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 the "License";
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "precompiled_network.h"
+
+#include <acl_network_schema.h>
+#include <common/logging.h>
+#include "tensor_utils.h"
+#include <algorithm>
+#include <fstream>
+#include <unordered_map>
+
+using ActivationFunction = arm_compute::ActivationLayerInfo::ActivationFunction;
+
+const static std::unordered_map<arm_compute::DataType, aclnet::DataType> ACL_TO_SCHEMA_DATA_TYPE =
+{
+    {arm_compute::DataType::F32, aclnet::DataType_F32},
+    {arm_compute::DataType::F16, aclnet::DataType_F16},
+    {arm_compute::DataType::QASYMM8, aclnet::DataType_QASYMM8},
+    {arm_compute::DataType::QSYMM8_PER_CHANNEL, aclnet::DataType_QSYMM8_PER_CHANNEL},
+    {arm_compute::DataType::S32, aclnet::DataType_S32}
+};
+
+const static std::unordered_map<int8_t, arm_compute::DataType> SCHEMA_TO_ACL_DATA_TYPE =
+{
+    {aclnet::DataType_F32, arm_compute::DataType::F32},
+    {aclnet::DataType_F16, arm_compute::DataType::F16},
+    {aclnet::DataType_QASYMM8, arm_compute::DataType::QASYMM8},
+    {aclnet::DataType_QSYMM8_PER_CHANNEL, arm_compute::DataType::QSYMM8_PER_CHANNEL},
+    {aclnet::DataType_S32, arm_compute::DataType::S32}
+};
+
+const static std::unordered_map<ActivationFunction, aclnet::ActivationFunction> ACL_TO_SCHEMA_ACTIVATION =
+{
+    {ActivationFunction::IDENTITY, aclnet::ActivationFunction_IDENTITY},
+    {ActivationFunction::RELU, aclnet::ActivationFunction_RELU},
+    {ActivationFunction::LINEAR, aclnet::ActivationFunction_LINEAR}
+};
+
+const static std::unordered_map<int8_t, ActivationFunction> SCHEMA_TO_ACL_ACTIVATION =
+{
+    {aclnet::ActivationFunction_IDENTITY, ActivationFunction::IDENTITY},
+    {aclnet::ActivationFunction_RELU, ActivationFunction::RELU},
+    {aclnet::ActivationFunction_LINEAR, ActivationFunction::LINEAR}
+};
+
+const static std::unordered_map<int8_t, GraphNodeType> SCHEMA_TO_GRAPH_NODE_TYPE =
+{
+    {aclnet::LayerType_ColorConversion, GraphNodeType::ColorConversion},
+    {aclnet::LayerType_Activation, GraphNodeType::Activation},
+    {aclnet::LayerType_Addition, GraphNodeType::Addition},
+    {aclnet::LayerType_Conv2D, GraphNodeType::Conv2D},
+    {aclnet::LayerType_DepthwiseConv2D, GraphNodeType::DepthwiseConv2D},
+    {aclnet::LayerType_TransposeConv2D, GraphNodeType::TransposeConv2D}
+};
+
+namespace
+{
+aclnet::LayerType get_layer_type(GraphNodeType type)
+{
+    switch(type)
+    {
+        case GraphNodeType::ColorConversion:
+            return aclnet::LayerType_ColorConversion;
+        case GraphNodeType::Activation:
+            return aclnet::LayerType_Activation;
+        case GraphNodeType::Addition:
+            return aclnet::LayerType_Addition;
+        case GraphNodeType::Conv2D:
+            return aclnet::LayerType_Conv2D;
+        case GraphNodeType::DepthwiseConv2D:
+            return aclnet::LayerType_DepthwiseConv2D;
+        default:
+            return aclnet::LayerType_TransposeConv2D;
+    }
+}
+
+aclnet::ConvolutionMethod get_convolution_method(arm_compute::ConvolutionMethod method)
+{
+    switch(method)
+    {
+        case arm_compute::ConvolutionMethod::GEMM:
+            return aclnet::ConvolutionMethod_GEMM;
+        case arm_compute::ConvolutionMethod::DIRECT:
+            return aclnet::ConvolutionMethod_DIRECT;
+        case arm_compute::ConvolutionMethod::WINOGRAD:
+            return aclnet::ConvolutionMethod_WINOGRAD;
+        default:
+            return aclnet::ConvolutionMethod_DEFAULT;
+    }
+}
+
+bool get_convolution_method(aclnet::ConvolutionMethod stored_method, arm_compute::ConvolutionMethod& method)
+{
+    switch(stored_method)
+    {
+        case aclnet::ConvolutionMethod_GEMM:
+            method = arm_compute::ConvolutionMethod::GEMM;
+            return true;
+        case aclnet::ConvolutionMethod_DIRECT:
+            method = arm_compute::ConvolutionMethod::DIRECT;
+            return true;
+        case aclnet::ConvolutionMethod_WINOGRAD:
+            method = arm_compute::ConvolutionMethod::WINOGRAD;
+            return true;
+        default:
+            return false;
+    }
+}
+
+flatbuffers::Offset<aclnet::Constant> create_constant(flatbuffers::FlatBufferBuilder& builder,
+                                                      const ConstantValues& values,
+                                                      arm_compute::DataType data_type,
+                                                      const std::vector<float>& scales,
+                                                      uint32_t channel_inner_size)
+{
+    auto data = convert_values(values.data(), values.size(), data_type, scales, channel_inner_size);
+    const auto* stored_scales = data_type == arm_compute::DataType::QSYMM8_PER_CHANNEL ? &scales : nullptr;
+    return aclnet::CreateConstantDirect(builder, ACL_TO_SCHEMA_DATA_TYPE.at(data_type), stored_scales, &data);
+}
+
+// Weights are converted the same way as ACLNetwork converts them: quantized networks use per-channel QSYMM8 kernels and S32 biases.
+void create_weights(flatbuffers::FlatBufferBuilder& builder,
+                    const NetworkGraph& graph,
+                    const GraphNode& node,
+                    arm_compute::DataType data_type,
+                    flatbuffers::Offset<aclnet::Constant>& kernel,
+                    flatbuffers::Offset<aclnet::Constant>& bias)
+{
+    auto channels = static_cast<uint32_t>(node.bias_values.size());
+    uint32_t channel_inner_size = node.type == GraphNodeType::DepthwiseConv2D ? 1 : static_cast<uint32_t>(node.kernel_values.size() / channels);
+    if(!arm_compute::is_data_type_quantized(data_type))
+    {
+        kernel = create_constant(builder, node.kernel_values, data_type, {}, channel_inner_size);
+        bias = create_constant(builder, node.bias_values, data_type, {}, 1);
+        return;
+    }
+
+    auto scales = calculate_per_channel_scales(node.kernel_values, channels, channel_inner_size);
+    float input_scale = graph.get_tensors()[node.inputs[0]].quantization.uniform().scale;
+    std::vector<float> bias_scales(scales.size());
+    for(size_t i = 0; i < scales.size(); i++)
+    {
+        bias_scales[i] = input_scale * scales[i];
+    }
+    kernel = create_constant(builder, node.kernel_values, arm_compute::DataType::QSYMM8_PER_CHANNEL, scales, channel_inner_size);
+    bias = create_constant(builder, node.bias_values, arm_compute::DataType::S32, bias_scales, 1);
+}
+
+ConstantValues get_constant_values(const aclnet::Constant& constant)
+{
+    auto data_type = SCHEMA_TO_ACL_DATA_TYPE.at(constant.data_type());
+    std::vector<float> scales;
+    if(constant.scales())
+    {
+        for(uint32_t i = 0; i < constant.scales()->size(); i++)
+        {
+            scales.push_back(constant.scales()->Get(i));
+        }
+    }
+    // The data is aligned to 16 bytes in the file, so the values are used in place.
+    size_t size = constant.data()->size() / arm_compute::data_size_from_type(data_type);
+    return ConstantValues(constant.data()->Data(), size, data_type, std::move(scales));
+}
+
+std::vector<uint32_t> to_vector(const flatbuffers::Vector<uint32_t>* values)
+{
+    std::vector<uint32_t> result;
+    for(uint32_t i = 0; i < values->size(); i++)
+    {
+        result.push_back(values->Get(i));
+    }
+    return result;
+}
+}        // namespace
+
+void PrecompiledNetwork::save(const NetworkGraph& graph,
+                              const ACLNetwork& network,
+                              const arm_compute::ITensorInfo& input_output_info,
+                              size_t source_hash,
+                              const std::string& path)
+{
+    flatbuffers::FlatBufferBuilder builder;
+    auto data_type = network.get_data_type();
+
+    // Graph tensors describe a single image, the input of a batch network gets the batch size as the fourth dimension.
+    std::vector<flatbuffers::Offset<aclnet::Tensor>> tensors;
+    for(uint32_t i = 0; i < graph.get_tensors().size(); i++)
+    {
+        const auto& tensor = graph.get_tensors()[i];
+        auto shape = tensor.shape;
+        if(i == graph.get_input() && input_output_info.dimension(3) > 1)
+        {
+            shape.push_back(static_cast<uint32_t>(input_output_info.dimension(3)));
+        }
+        auto quantization = tensor.quantization.uniform();
+        tensors.push_back(aclnet::CreateTensorDirect(builder,
+                                                     &shape,
+                                                     ACL_TO_SCHEMA_DATA_TYPE.at(tensor.data_type),
+                                                     quantization.scale,
+                                                     quantization.offset,
+                                                     tensor.model_index));
+    }
+
+    const auto& convolution_methods = network.get_convolution_methods();
+    size_t convolution_index = 0;
+    std::vector<flatbuffers::Offset<aclnet::Layer>> layers;
+    for(const auto& node : graph.get_nodes())
+    {
+        auto inputs = builder.CreateVector(node.inputs);
+        flatbuffers::Offset<aclnet::Constant> kernel;
+        flatbuffers::Offset<aclnet::Constant> bias;
+        if(node.kernel_values.size() > 0)
+        {
+            create_weights(builder, graph, node, data_type, kernel, bias);
+        }
+        flatbuffers::Offset<aclnet::ColorConversion> color_conversion;
+        if(node.type == GraphNodeType::ColorConversion)
+        {
+            const auto& info = node.color_conversion;
+            color_conversion = aclnet::CreateColorConversion(builder, info.pre_scale, info.pre_bias, info.exponent, info.post_scale, info.post_bias);
+        }
+
+        aclnet::LayerBuilder layer(builder);
+        layer.add_type(get_layer_type(node.type));
+        layer.add_inputs(inputs);
+        layer.add_output(node.output);
+        layer.add_activation(ACL_TO_SCHEMA_ACTIVATION.at(node.activation));
+        layer.add_activation_a(node.activation_a);
+        layer.add_activation_b(node.activation_b);
+        layer.add_kernel_width(node.kernel_width);
+        layer.add_kernel_height(node.kernel_height);
+        layer.add_output_features(node.output_features);
+        layer.add_pad_x_front(node.pad_x_front);
+        layer.add_pad_x_back(node.pad_x_back);
+        layer.add_pad_y_front(node.pad_y_front);
+        layer.add_pad_y_back(node.pad_y_back);
+        layer.add_stride_x(node.stride_x);
+        layer.add_stride_y(node.stride_y);
+        layer.add_dilation_x(node.dilation_x);
+        layer.add_dilation_y(node.dilation_y);
+        if(node.type == GraphNodeType::Conv2D)
+        {
+            layer.add_convolution_method(get_convolution_method(convolution_methods.at(convolution_index++)));
+        }
+        layer.add_kernel(kernel);
+        layer.add_bias(bias);
+        layer.add_color_conversion(color_conversion);
+        layer.add_in_place(node.in_place);
+        layers.push_back(layer.Finish());
+    }
+
+    auto root = aclnet::CreateNetworkDirect(builder,
+                                            ACL_TO_SCHEMA_DATA_TYPE.at(data_type),
+                                            source_hash,
+                                            &tensors,
+                                            &layers,
+                                            graph.get_input(),
+                                            graph.get_output());
+    aclnet::FinishNetworkBuffer(builder, root);
+
+    std::ofstream file(path, std::ios::binary);
+    if(!file)
+    {
+        LOGW("Cannot write precompiled network {}", path);
+        return;
+    }
+    file.write(reinterpret_cast<const char*>(builder.GetBufferPointer()), builder.GetSize());
+    LOGI("Precompiled network ({} bytes) stored to {}", builder.GetSize(), path);
+}
+
+bool PrecompiledNetwork::is_compatible(const ModelFile& file, const arm_compute::ITensorInfo& input_output_info)
+{
+    flatbuffers::Verifier verifier(file.data(), file.size());
+    if(!aclnet::VerifyNetworkBuffer(verifier))
+    {
+        return false;
+    }
+
+    const auto& network = *aclnet::GetNetwork(file.data());
+    if(!network.tensors() || !network.layers() || network.input() >= network.tensors()->size())
+    {
+        return false;
+    }
+    const auto& input = *network.tensors()->Get(network.input());
+    auto input_data_type = SCHEMA_TO_ACL_DATA_TYPE.find(input.data_type());
+    if(!input.shape() || input.shape()->size() < 3 || input.shape()->size() > 4 || input_data_type == SCHEMA_TO_ACL_DATA_TYPE.end() ||
+       input_data_type->second != input_output_info.data_type())
+    {
+        return false;
+    }
+    for(uint32_t i = 0; i < 3; i++)
+    {
+        if(input.shape()->Get(i) != input_output_info.dimension(i))
+        {
+            return false;
+        }
+    }
+
+    // Networks for single images store a three-dimensional input.
+    uint32_t batch_size = input.shape()->size() == 4 ? input.shape()->Get(3) : 1;
+    return batch_size == input_output_info.dimension(3);
+}
+
+arm_compute::DataType PrecompiledNetwork::get_data_type(const ModelFile& file)
+{
+    return SCHEMA_TO_ACL_DATA_TYPE.at(aclnet::GetNetwork(file.data())->data_type());
+}
+
+size_t PrecompiledNetwork::get_source_hash(const ModelFile& file)
+{
+    return static_cast<size_t>(aclnet::GetNetwork(file.data())->source_hash());
+}
+
+std::unique_ptr<ACLNetwork> PrecompiledNetwork::load(const ModelFile& file,
+                                                     const arm_compute::ITensor& input_output_tensor,
+                                                     ACLNetwork::ActivationMemoryMode memory_mode,
+                                                     std::shared_ptr<ACLNetwork::SharedWeights> shared_weights,
+                                                     bool validate_layers)
+{
+    const auto& network = *aclnet::GetNetwork(file.data());
+
+    NetworkGraph graph;
+    for(const auto* stored_tensor : *network.tensors())
+    {
+        GraphTensor tensor;
+        tensor.shape = to_vector(stored_tensor->shape());
+        // The batch size of the input was checked by is_compatible(), the network takes it from the input tensor.
+        tensor.shape.resize(std::min<size_t>(tensor.shape.size(), 3));
+        tensor.data_type = SCHEMA_TO_ACL_DATA_TYPE.at(stored_tensor->data_type());
+        if(arm_compute::is_data_type_quantized(tensor.data_type))
+        {
+            tensor.quantization = arm_compute::QuantizationInfo(stored_tensor->scale(), stored_tensor->offset());
+        }
+        tensor.model_index = stored_tensor->model_index();
+        graph.add_tensor(tensor);
+    }
+    graph.set_input(network.input());
+    graph.set_output(network.output());
+
+    // Nodes are added with their stored output tensors.
+    for(const auto* layer : *network.layers())
+    {
+        GraphNode node(SCHEMA_TO_GRAPH_NODE_TYPE.at(layer->type()));
+        node.inputs = to_vector(layer->inputs());
+        node.output = layer->output();
+        node.activation = SCHEMA_TO_ACL_ACTIVATION.at(layer->activation());
+        node.activation_a = layer->activation_a();
+        node.activation_b = layer->activation_b();
+        node.kernel_width = layer->kernel_width();
+        node.kernel_height = layer->kernel_height();
+        node.output_features = layer->output_features();
+        node.pad_x_front = layer->pad_x_front();
+        node.pad_x_back = layer->pad_x_back();
+        node.pad_y_front = layer->pad_y_front();
+        node.pad_y_back = layer->pad_y_back();
+        node.stride_x = layer->stride_x();
+        node.stride_y = layer->stride_y();
+        node.dilation_x = layer->dilation_x();
+        node.dilation_y = layer->dilation_y();
+        node.has_convolution_method = get_convolution_method(layer->convolution_method(), node.convolution_method);
+        if(layer->kernel() && layer->bias())
+        {
+            node.kernel_values = get_constant_values(*layer->kernel());
+            node.bias_values = get_constant_values(*layer->bias());
+        }
+        if(layer->color_conversion())
+        {
+            const auto& info = *layer->color_conversion();
+            node.color_conversion.pre_scale = info.pre_scale();
+            node.color_conversion.pre_bias = info.pre_bias();
+            node.color_conversion.exponent = info.exponent();
+            node.color_conversion.post_scale = info.post_scale();
+            node.color_conversion.post_bias = info.post_bias();
+        }
+        node.in_place = layer->in_place();
+        graph.get_nodes().push_back(std::move(node));
+    }
+
+    return graph.create_network(input_output_tensor, SCHEMA_TO_ACL_DATA_TYPE.at(network.data_type()), memory_mode, validate_layers, std::move(shared_weights));
+}
@@ -0,0 +1,60 @@
+/* Copyright (c) 2022, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 the "License";
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "acl_network.h"
+#include "model_file.h"
+#include "network_graph.h"
+#include <memory>
+#include <string>
+
+/*
+ * Network resolved for a single image size and precision, stored in the format defined by acl_network_schema.fbs.
+ * It contains the optimized graph, the convolution methods chosen when the network was created and the weights
+ * in the data types of the network tensors. A network created from it skips parsing the model, optimizing the graph,
+ * validating the layers, choosing the convolution methods and converting the weights.
+ * It doesn't replace the model: the file describes a single network, while the other sizes, the receptive field and the
+ * weights in F32 (e.g. for blending or calibration) still come from the model.
+ */
+class PrecompiledNetwork
+{
+public:
+    // Stores the graph and the network created from it. The hash identifies the model the graph was parsed from.
+    // The batch size of the network input is stored with the input tensor, as the convolution methods depend on it.
+    static void save(const NetworkGraph& graph,
+                     const ACLNetwork& network,
+                     const arm_compute::ITensorInfo& input_output_info,
+                     size_t source_hash,
+                     const std::string& path);
+
+    // Checks that the file is a valid precompiled network for images described by the tensor info, including the batch size.
+    static bool is_compatible(const ModelFile& file, const arm_compute::ITensorInfo& input_output_info);
+
+    static arm_compute::DataType get_data_type(const ModelFile& file);
+
+    static size_t get_source_hash(const ModelFile& file);
+
+    // Creates the network, the file must be compatible with the tensor. The weights are copied, so the file can be closed afterwards.
+    // Networks exported on this device are not validated again. Networks exported on another device (e.g. shipped in assets) are
+    // validated, and their convolution methods are chosen again where this device doesn't support them.
+    static std::unique_ptr<ACLNetwork> load(const ModelFile& file,
+                                            const arm_compute::ITensor& input_output_tensor,
+                                            ACLNetwork::ActivationMemoryMode memory_mode = ACLNetwork::ActivationMemoryMode::Offset,
+                                            std::shared_ptr<ACLNetwork::SharedWeights> shared_weights = nullptr,
+                                            bool validate_layers = false);
+};
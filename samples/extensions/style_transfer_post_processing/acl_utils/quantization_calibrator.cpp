@@ -0,0 +1,202 @@
+/* Copyright (c) 2022, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 the "License";
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "quantization_calibrator.h"
+#include "tensor_utils.h"
+#include <common/logging.h>
+#include <arm_compute/runtime/CL/CLScheduler.h>
+#include <stb_image.h>
+#include <dirent.h>
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <limits>
+
+namespace
+{
+struct TensorRange
+{
+    float min{std::numeric_limits<float>::max()};
+
+    float max{std::numeric_limits<float>::lowest()};
+};
+
+// Inverts the conversion the network does for its input (see get_linear_to_srgb_info() in tflite_parser.cpp).
+uint8_t srgb_to_network_input(uint8_t value)
+{
+    float brightness_adjustment = 1.7f;
+    float linear = std::pow((value + 14.025f) / 269.025f, 2.4f) * 255.0f / brightness_adjustment;
+    return static_cast<uint8_t>(std::min(std::max(std::round(linear), 0.0f), 255.0f));
+}
+
+// The range always includes 0, so that 0 (e.g. padding or the result of ReLU) is represented exactly.
+arm_compute::QuantizationInfo range_to_quantization(const TensorRange& range)
+{
+    float min = std::min(range.min, 0.0f);
+    float max = std::max(range.max, 0.0f);
+    float scale = max > min ? (max - min) / 255.0f : 1.0f;
+    int32_t offset = static_cast<int32_t>(std::round(-min / scale));
+    return arm_compute::QuantizationInfo(scale, std::min(std::max(offset, 0), 255));
+}
+}        // namespace
+
+TFLiteParser::QuantizationTable QuantizationCalibrator::calibrate(const ModelFile& model,
+                                                                  const arm_compute::TensorInfo& input_output_info,
+                                                                  const std::vector<std::string>& image_paths)
+{
+    if(image_paths.empty())
+    {
+        throw std::runtime_error("No images for quantization calibration.");
+    }
+
+    arm_compute::CLTensor input_output_tensor;
+    input_output_tensor.allocator()->init(input_output_info);
+    input_output_tensor.allocator()->allocate();
+
+    // The graph is not optimized, because the optimizations (e.g. activation fusion) remove some of the model tensors.
+    // Dedicated memory keeps all the model tensors alive, so that they can be read after the network is run.
+    auto graph = TFLiteParser::parse_graph(model, input_output_info, arm_compute::DataType::F32);
+    auto net = graph.create_network(input_output_tensor, arm_compute::DataType::F32, ACLNetwork::ActivationMemoryMode::Dedicated);
+    net->prepare();
+
+    uint32_t width = static_cast<uint32_t>(input_output_info.dimension(1));
+    uint32_t height = static_cast<uint32_t>(input_output_info.dimension(2));
+    uint32_t channels = static_cast<uint32_t>(input_output_info.dimension(0));
+
+    std::unordered_map<int32_t, TensorRange> ranges;
+    uint32_t calibrated_images = 0;
+    for(const auto& image_path : image_paths)
+    {
+        int image_width = 0;
+        int image_height = 0;
+        int image_channels = 0;
+        auto* pixels = stbi_load(image_path.c_str(), &image_width, &image_height, &image_channels, channels);
+        if(pixels == nullptr)
+        {
+            LOGW("Cannot load calibration image {}", image_path);
+            continue;
+        }
+        if(image_width != static_cast<int>(width) || image_height != static_cast<int>(height))
+        {
+            LOGW("Calibration image {} is {}x{}, expected {}x{}", image_path, image_width, image_height, width, height);
+            stbi_image_free(pixels);
+            continue;
+        }
+
+        input_output_tensor.map();
+        uint8_t* buffer = input_output_tensor.buffer();
+        for(size_t i = 0; i < width * height * channels; i++)
+        {
+            buffer[i] = srgb_to_network_input(pixels[i]);
+        }
+        input_output_tensor.unmap();
+        stbi_image_free(pixels);
+
+        net->run();
+        arm_compute::CLScheduler::get().sync();
+
+        for(const auto& model_tensor : net->get_model_tensors())
+        {
+            auto values = get_tensor_values(*model_tensor.second);
+            auto min_max = std::minmax_element(values.begin(), values.end());
+            auto& range = ranges[model_tensor.first];
+            range.min = std::min(range.min, *min_max.first);
+            range.max = std::max(range.max, *min_max.second);
+        }
+        calibrated_images++;
+    }
+
+    if(calibrated_images == 0)
+    {
+        throw std::runtime_error("None of the calibration images could be used.");
+    }
+
+    TFLiteParser::QuantizationTable table;
+    for(const auto& range : ranges)
+    {
+        table[range.first] = range_to_quantization(range.second);
+    }
+    LOGI("Calibrated quantization of {} tensors using {} images", table.size(), calibrated_images);
+
+    return table;
+}
+
+std::vector<std::string> QuantizationCalibrator::find_images(const std::string& directory)
+{
+    std::vector<std::string> image_paths;
+    DIR* dir = opendir(directory.c_str());
+    if(dir == nullptr)
+    {
+        return image_paths;
+    }
+
+    while(auto* entry = readdir(dir))
+    {
+        std::string name = entry->d_name;
+        if(name.size() > 4 && name.compare(name.size() - 4, 4, ".png") == 0)
+        {
+            image_paths.push_back(directory + name);
+        }
+    }
+    closedir(dir);
+
+    std::sort(image_paths.begin(), image_paths.end());
+    return image_paths;
+}
+
+void QuantizationCalibrator::save_table(const TFLiteParser::QuantizationTable& table, size_t model_hash, const std::string& path)
+{
+    std::ofstream file(path);
+    if(!file)
+    {
+        LOGW("Cannot save quantization table to {}", path);
+        return;
+    }
+
+    file.precision(9);
+    file << model_hash << "\n";
+    for(const auto& entry : table)
+    {
+        auto quantization = entry.second.uniform();
+        file << entry.first << " " << quantization.scale << " " << quantization.offset << "\n";
+    }
+}
+
+bool QuantizationCalibrator::load_table(TFLiteParser::QuantizationTable& table, size_t model_hash, const std::string& path)
+{
+    std::ifstream file(path);
+    size_t table_model_hash = 0;
+    if(!file || !(file >> table_model_hash))
+    {
+        return false;
+    }
+    if(table_model_hash != model_hash)
+    {
+        LOGW("Quantization table {} was calibrated for another model, the network is calibrated again", path);
+        return false;
+    }
+
+    table.clear();
+    int32_t index = 0;
+    float scale = 0.0f;
+    int32_t offset = 0;
+    while(file >> index >> scale >> offset)
+    {
+        table[index] = arm_compute::QuantizationInfo(scale, offset);
+    }
+    return !table.empty();
+}
@@ -0,0 +1,49 @@
+/* Copyright (c) 2022, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 the "License";
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tflite_parser.h"
+#include <string>
+#include <vector>
+
+/*
+ * Post-training calibration of the quantized (QASYMM8) network.
+ * An F32 network is run over a set of images and the range of every model tensor is recorded.
+ * The ranges are converted to asymmetric 8-bit quantization, which is used when the quantized network is parsed.
+ *
+ * The calibration images are the images the network was trained with (see network/dataset/x).
+ * They are in sRGB color space, so they are converted to the linear color space the rendered images are in.
+ */
+class QuantizationCalibrator
+{
+public:
+    // Runs the F32 network over the images and returns quantization for all the model tensors.
+    // The tensor info describes the images processed by the pipeline, the calibration images must have the same size.
+    static TFLiteParser::QuantizationTable calibrate(const ModelFile& model,
+                                                     const arm_compute::TensorInfo& input_output_info,
+                                                     const std::vector<std::string>& image_paths);
+
+    // Returns paths of all the PNG images in the directory.
+    static std::vector<std::string> find_images(const std::string& directory);
+
+    // The table is stored together with the hash of the model (see ModelFile::get_hash()), so that a table calibrated for
+    // a different model, e.g. a retrained model with the same architecture, is not loaded.
+    static void save_table(const TFLiteParser::QuantizationTable& table, size_t model_hash, const std::string& path);
+
+    static bool load_table(TFLiteParser::QuantizationTable& table, size_t model_hash, const std::string& path);
+};
@@ -0,0 +1,131 @@
+/* Copyright (c) 2022, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 the "License";
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "split_balancer.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace
+{
+// Weight of the last frame in the averaged throughput.
+const double THROUGHPUT_SMOOTHING = 0.25;
+
+// The split is kept while the band times differ by less than this fraction, as creating networks for a new split is slow.
+const double BALANCE_TOLERANCE = 0.1;
+}        // namespace
+
+SplitBalancer::SplitBalancer(uint32_t rows, uint32_t row_step, uint32_t halo_rows, uint32_t initial_split_row) :
+    rows(rows),
+    row_step(row_step),
+    halo_rows(halo_rows),
+    split_row(initial_split_row)
+{
+    if(row_step == 0 || rows < 2 * row_step || split_row % row_step != 0)
+    {
+        throw std::runtime_error("Image must have at least two row steps and the split must be a multiple of the row step");
+    }
+    split_row = std::min(std::max(split_row, row_step), rows - row_step);
+    balanced_row = split_row;
+}
+
+uint32_t SplitBalancer::get_split_row() const
+{
+    return split_row;
+}
+
+uint32_t SplitBalancer::get_halo_rows() const
+{
+    return halo_rows;
+}
+
+uint32_t SplitBalancer::get_gpu_band_rows() const
+{
+    return get_gpu_band_rows(split_row);
+}
+
+uint32_t SplitBalancer::get_gpu_band_rows(uint32_t split) const
+{
+    return std::min(split + halo_rows, rows);
+}
+
+uint32_t SplitBalancer::get_cpu_band_start() const
+{
+    return get_cpu_band_start(split_row);
+}
+
+uint32_t SplitBalancer::get_cpu_band_start(uint32_t split) const
+{
+    return split > halo_rows ? split - halo_rows : 0;
+}
+
+float SplitBalancer::get_gpu_ratio() const
+{
+    return static_cast<float>(split_row) / static_cast<float>(rows);
+}
+
+bool SplitBalancer::update(double gpu_milliseconds, double cpu_milliseconds)
+{
+    if(gpu_milliseconds <= 0.0 || cpu_milliseconds <= 0.0)
+    {
+        return false;
+    }
+
+    double gpu_frame_throughput = get_gpu_band_rows() / gpu_milliseconds;
+    double cpu_frame_throughput = (rows - get_cpu_band_start()) / cpu_milliseconds;
+    if(gpu_throughput == 0.0)
+    {
+        gpu_throughput = gpu_frame_throughput;
+        cpu_throughput = cpu_frame_throughput;
+    }
+    else
+    {
+        gpu_throughput += THROUGHPUT_SMOOTHING * (gpu_frame_throughput - gpu_throughput);
+        cpu_throughput += THROUGHPUT_SMOOTHING * (cpu_frame_throughput - cpu_throughput);
+    }
+
+    // Balanced frames keep their split, which also cancels a move that wasn't applied yet.
+    if(std::abs(gpu_milliseconds - cpu_milliseconds) < BALANCE_TOLERANCE * std::max(gpu_milliseconds, cpu_milliseconds))
+    {
+        bool changed = balanced_row != split_row;
+        balanced_row = split_row;
+        return changed;
+    }
+
+    // Both bands take the same time when (split + halo) / gpu_throughput == (rows - split + halo) / cpu_throughput.
+    double target_row = (gpu_throughput * (rows + halo_rows) - cpu_throughput * halo_rows) / (gpu_throughput + cpu_throughput);
+    auto steps = static_cast<int64_t>(std::round(target_row / row_step));
+    steps = std::min<int64_t>(std::max<int64_t>(steps, 1), rows / row_step - 1);
+
+    auto new_balanced_row = static_cast<uint32_t>(steps) * row_step;
+    if(new_balanced_row == balanced_row)
+    {
+        return false;
+    }
+    balanced_row = new_balanced_row;
+    return true;
+}
+
+uint32_t SplitBalancer::get_balanced_row() const
+{
+    return balanced_row;
+}
+
+void SplitBalancer::apply_balanced_row()
+{
+    split_row = balanced_row;
+}
@@ -0,0 +1,78 @@
+/* Copyright (c) 2022, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 the "License";
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+/*
+ * Chooses the row where the image is split between the GPU and the CPU, so that both parts of the frame finish together.
+ * The GPU processes the rows above the split and the CPU the rows below it, each part with a halo of rows from the other one.
+ * Throughput of each backend (band rows per millisecond) is averaged over the recent frames and the split is moved to the
+ * row where both bands are expected to take the same time. The split stays at multiples of the row step, so that networks
+ * are created only for a few band sizes. The balanced row is applied separately, so that the frames can keep the current split
+ * until the networks for the balanced row are created.
+ */
+class SplitBalancer
+{
+public:
+    // The initial split must be a multiple of the row step and the image must have at least two steps.
+    SplitBalancer(uint32_t rows, uint32_t row_step, uint32_t halo_rows, uint32_t initial_split_row);
+
+    // Rows of the image processed by the GPU, the CPU processes the rest.
+    uint32_t get_split_row() const;
+
+    uint32_t get_halo_rows() const;
+
+    // Rows of the GPU band, starting at the first image row.
+    uint32_t get_gpu_band_rows() const;
+
+    uint32_t get_gpu_band_rows(uint32_t split) const;
+
+    // First image row of the CPU band, which ends at the last image row.
+    uint32_t get_cpu_band_start() const;
+
+    uint32_t get_cpu_band_start(uint32_t split) const;
+
+    float get_gpu_ratio() const;
+
+    // Updates the balanced row from the times both bands took in the last frame, which was split at the split row.
+    // Returns true if the balanced row changed.
+    bool update(double gpu_milliseconds, double cpu_milliseconds);
+
+    // Row where both bands are expected to take the same time, it differs from the split row until it's applied.
+    uint32_t get_balanced_row() const;
+
+    // Moves the split to the balanced row.
+    void apply_balanced_row();
+
+private:
+    uint32_t rows;
+
+    uint32_t row_step;
+
+    uint32_t halo_rows;
+
+    uint32_t split_row;
+
+    uint32_t balanced_row;
+
+    // Band rows processed per millisecond, 0 until the first update.
+    double gpu_throughput{0.0};
+
+    double cpu_throughput{0.0};
+};
@@ -17,28 +17,294 @@
 
 #include "tensor_utils.h"
 
+#include <arm_compute/core/Utils.h>
+#include <ctpl_stl.h>
+#include <algorithm>
+#include <cmath>
+#include <exception>
+#include <future>
+#include <thread>
+
+namespace
+{
+// Copies a row of float values to a tensor row, converting them to the tensor data type.
+void copy_row_to_tensor(const float* src, uint8_t* dst, uint32_t count, arm_compute::DataType data_type)
+{
+    switch(data_type)
+    {
+        case arm_compute::DataType::F32:
+            memcpy(dst, src, count * sizeof(float));
+            break;
+        case arm_compute::DataType::F16:
+        {
+            auto* dst_half = reinterpret_cast<arm_compute::half*>(dst);
+            for(uint32_t i = 0; i < count; i++)
+            {
+                dst_half[i] = arm_compute::half(src[i]);
+            }
+            break;
+        }
+        default:
+            throw std::runtime_error("Unsupported tensor data type.");
+    }
+}
+
+// Quantizes a row of float values to a tensor row, the first value of the row has linear index 'index'.
+template <typename T>
+void quantize_row_to_tensor(const float* src, uint8_t* dst, uint32_t count, size_t index, const std::vector<float>& scales, uint32_t channel_inner_size, float limit)
+{
+    auto* dst_values = reinterpret_cast<T*>(dst);
+    for(uint32_t i = 0; i < count; i++)
+    {
+        float value = std::round(src[i] / scales[((index + i) / channel_inner_size) % scales.size()]);
+        dst_values[i] = static_cast<T>(std::min(std::max(value, -limit), limit));
+    }
+}
+
+// Copies a tensor row to float values, converting them from the tensor data type.
+void copy_row_from_tensor(const uint8_t* src, float* dst, uint32_t count, arm_compute::DataType data_type)
+{
+    switch(data_type)
+    {
+        case arm_compute::DataType::F32:
+            memcpy(dst, src, count * sizeof(float));
+            break;
+        case arm_compute::DataType::F16:
+        {
+            const auto* src_half = reinterpret_cast<const arm_compute::half*>(src);
+            for(uint32_t i = 0; i < count; i++)
+            {
+                dst[i] = static_cast<float>(src_half[i]);
+            }
+            break;
+        }
+        default:
+            throw std::runtime_error("Unsupported tensor data type.");
+    }
+}
+
+// Tensors with fewer values are processed on the calling thread, distributing them would cost more than it saves.
+const size_t PARALLEL_MIN_SIZE = 1 << 16;
+
+// The pool belongs to these utilities, it's separate from the thread pools of the framework and of ACL.
+ctpl::thread_pool& get_thread_pool()
+{
+    static ctpl::thread_pool thread_pool(std::max(1u, std::thread::hardware_concurrency()));
+    return thread_pool;
+}
+
+// Splits [0, count) into contiguous ranges, calls func(begin, end) for each of them in parallel and waits for all of them.
+// The size is the amount of work in values, small work runs as a single range.
+template <typename F>
+void parallel_for(size_t count, size_t size, F&& func)
+{
+    size_t ranges = size < PARALLEL_MIN_SIZE ? 1 : std::min(count, static_cast<size_t>(get_thread_pool().size()) + 1);
+    if(ranges <= 1)
+    {
+        func(0, count);
+        return;
+    }
+
+    // The tasks refer to func, so all of them are finished before an exception leaves the function.
+    size_t range_size = (count + ranges - 1) / ranges;
+    std::vector<std::future<void>> futures;
+    std::exception_ptr error;
+    try
+    {
+        for(size_t begin = range_size; begin < count; begin += range_size)
+        {
+            size_t end = std::min(count, begin + range_size);
+            futures.push_back(get_thread_pool().push([&func, begin, end](int)
+            {
+                func(begin, end);
+            }));
+        }
+        func(0, range_size);
+    }
+    catch(...)
+    {
+        error = std::current_exception();
+    }
+    for(auto& future : futures)
+    {
+        try
+        {
+            future.get();
+        }
+        catch(...)
+        {
+            if(!error)
+            {
+                error = std::current_exception();
+            }
+        }
+    }
+    if(error)
+    {
+        std::rethrow_exception(error);
+    }
+}
+
+// Transposes a rows x columns matrix, element (r, c) is src[r * src_stride + c] and it's written to dst[c * dst_stride + r].
+// The matrix is processed in square tiles, so that both the reads and the strided writes stay within a few cache lines.
+void transpose_tiles(const float* src, size_t src_stride, float* dst, size_t dst_stride, uint32_t rows, uint32_t columns)
+{
+    const uint32_t tile_size = 8;
+    for(uint32_t row_tile = 0; row_tile < rows; row_tile += tile_size)
+    {
+        uint32_t row_end = std::min(rows, row_tile + tile_size);
+        for(uint32_t column_tile = 0; column_tile < columns; column_tile += tile_size)
+        {
+            uint32_t column_end = std::min(columns, column_tile + tile_size);
+            for(uint32_t c = column_tile; c < column_end; c++)
+            {
+                float* dst_row = dst + c * dst_stride;
+                for(uint32_t r = row_tile; r < row_end; r++)
+                {
+                    dst_row[r] = src[r * src_stride + c];
+                }
+            }
+        }
+    }
+}
+
+// Calls func(index, offset, count) for each run of consecutive elements of the tensor, where index is the linear index of the first
+// element and offset is its byte offset in the tensor buffer. A tensor without padding is a single run, otherwise each row is a run
+// and the offsets advance by the tensor strides.
+template <typename F>
+void for_each_tensor_run(const arm_compute::ITensorInfo& info, F&& func)
+{
+    const auto& shape = info.tensor_shape();
+    if(info.padding().empty())
+    {
+        func(0, info.offset_first_element_in_bytes(), shape.total_size());
+        return;
+    }
+
+    const auto& strides = info.strides_in_bytes();
+    size_t width = shape[0];
+    size_t index = 0;
+    for(size_t depth_index = 0; depth_index < shape[4]; depth_index++)
+    {
+        for(size_t batch_index = 0; batch_index < shape[3]; batch_index++)
+        {
+            for(size_t channel_index = 0; channel_index < shape[2]; channel_index++)
+            {
+                size_t offset = info.offset_first_element_in_bytes() + depth_index * strides[4] + batch_index * strides[3] + channel_index * strides[2];
+                for(size_t y = 0; y < shape[1]; y++)
+                {
+                    func(index, offset + y * strides[1], width);
+                    index += width;
+                }
+            }
+        }
+    }
+}
+}        // namespace
+
+ConstantValues::ConstantValues(const float* values, size_t size) :
+    external_values(values),
+    external_size(size)
+{}
+
+ConstantValues::ConstantValues(std::vector<float> values) :
+    owned_values(std::move(values)),
+    owned(true)
+{}
+
+ConstantValues::ConstantValues(const void* values, size_t size, arm_compute::DataType data_type, std::vector<float> scales) :
+    external_values(values),
+    external_size(size),
+    data_type(data_type),
+    scales(std::move(scales))
+{}
+
+arm_compute::DataType ConstantValues::get_data_type() const
+{
+    return data_type;
+}
+
+const std::vector<float>& ConstantValues::get_scales() const
+{
+    return scales;
+}
+
+const void* ConstantValues::raw_data() const
+{
+    return owned ? owned_values.data() : external_values;
+}
+
+const float* ConstantValues::data() const
+{
+    return static_cast<const float*>(raw_data());
+}
+
+size_t ConstantValues::size() const
+{
+    return owned ? owned_values.size() : external_size;
+}
+
+const float* ConstantValues::begin() const
+{
+    return data();
+}
+
+const float* ConstantValues::end() const
+{
+    return data() + size();
+}
+
+const float& ConstantValues::operator[](size_t index) const
+{
+    return data()[index];
+}
+
+std::vector<float>& ConstantValues::get_mutable()
+{
+    if(data_type != arm_compute::DataType::F32)
+    {
+        throw std::runtime_error("Converted constant values cannot be modified.");
+    }
+    if(!owned)
+    {
+        const auto* values = static_cast<const float*>(external_values);
+        owned_values.assign(values, values + external_size);
+        owned = true;
+    }
+    return owned_values;
+}
+
+uint32_t calculate_conv_output_size(uint32_t input_size, uint32_t kernel_size, uint32_t pad, uint32_t stride, uint32_t dilation)
+{
+    return std::ceil((float)(input_size + 2 * pad - dilation * (kernel_size - 1)) / (float)(stride));
+}
+
+uint32_t calculate_deconv_output_size(uint32_t input_size, uint32_t kernel_size, uint32_t pad, uint32_t stride)
+{
+    return (input_size - 1) * stride - 2 * pad + kernel_size;
+}
+
 std::vector<float> transpose_kernel_values(const std::vector<float>& values,
                                            uint32_t width,
                                            uint32_t height,
                                            uint32_t input_channels,
                                            uint32_t output_features)
 {
+    // For every kernel position, the input channels x output features matrix is transposed into the rows of the output features.
     std::vector<float> transposed_values(values.size());
-    for(int y = 0; y < height; y++)
+    size_t feature_size = static_cast<size_t>(width) * height * input_channels;
+    parallel_for(output_features, values.size(), [&](size_t begin, size_t end)
     {
-        for (int x = 0; x < width; x++)
+        for(size_t position = 0; position < static_cast<size_t>(width) * height; position++)
         {
-            for (int c = 0; c < input_channels; c++)
-            {
-                for (int f = 0; f < output_features; f++)
-                {
-                    int src_index = ((y * width + x) * input_channels + c) * output_features + f;
-                    int dst_index = ((f * height + y) * width + x) * input_channels + c;
-                    transposed_values[dst_index] = values[src_index];
-                }
-            }
+            transpose_tiles(values.data() + position * input_channels * output_features + begin,
+                            output_features,
+                            transposed_values.data() + begin * feature_size + position * input_channels,
+                            feature_size,
+                            input_channels,
+                            static_cast<uint32_t>(end - begin));
         }
-    }
+    });
     return transposed_values;
 }
 
@@ -48,133 +314,190 @@ std::vector<float> transpose_deconv_kernel_values(const std::vector<float>& valu
                                                   uint32_t input_channels,
                                                   uint32_t output_features)
 {
+    // Output features stay the innermost dimension, so whole rows are moved from position-major to channel-major order.
     std::vector<float> transposed_values(values.size());
-    for(int y = 0; y < height; y++)
+    size_t positions = static_cast<size_t>(width) * height;
+    parallel_for(input_channels, values.size(), [&](size_t begin, size_t end)
     {
-        for (int x = 0; x < width; x++)
+        for(size_t c = begin; c < end; c++)
         {
-            for (int c = 0; c < input_channels; c++)
+            for(size_t position = 0; position < positions; position++)
             {
-                for (int f = 0; f < output_features; f++)
-                {
-                    int src_index = ((y * width + x) * input_channels + c) * output_features + f;
-                    int dst_index = ((c * height + y) * width + x) * output_features + f;
-                    transposed_values[dst_index] = values[src_index];
-                }
+                memcpy(transposed_values.data() + (c * positions + position) * output_features,
+                       values.data() + (position * input_channels + c) * output_features,
+                       output_features * sizeof(float));
             }
         }
-    }
+    });
     return transposed_values;
 }
 
-inline size_t get_tensor_offset(const arm_compute::ITensorInfo& info,
-                                uint32_t depth_index,
-                                uint32_t batch_index,
-                                uint32_t channel_index,
-                                uint32_t y,
-                                uint32_t x)
+void copy_data_to_tensor(arm_compute::ITensor& tensor, const float* data)
 {
-    arm_compute::Coordinates coords;
-    coords.set(4, static_cast<int>(depth_index));
-    coords.set(3, static_cast<int>(batch_index));
-    coords.set(2, static_cast<int>(channel_index));
-    coords.set(1, static_cast<int>(y));
-    coords.set(0, static_cast<int>(x));
-    return (size_t)(info.offset_element_in_bytes(coords));
+    write_tensor_values(*tensor.info(), tensor.buffer(), data);
 }
 
-inline size_t get_linear_buffer_offset(const arm_compute::ITensorInfo& info,
-                                       uint32_t depth_index,
-                                       uint32_t batch_index,
-                                       uint32_t channel_index,
-                                       uint32_t y,
-                                       uint32_t x)
+void write_tensor_values(const arm_compute::ITensorInfo& info, uint8_t* buffer_ptr, const float* data)
 {
-    const arm_compute::TensorShape& shape = info.tensor_shape();
-    uint32_t width = static_cast<uint32_t>(shape[0]);
-    uint32_t height = static_cast<uint32_t>(shape[1]);
-    uint32_t num_channels = static_cast<uint32_t>(shape[2]);
-    uint32_t num_batches = static_cast<uint32_t>(shape[3]);
-    return (((depth_index * num_batches + batch_index) * num_channels + channel_index) * height + y) * width + x;
+    for_each_tensor_run(info, [&](size_t index, size_t offset, size_t count)
+    {
+        copy_row_to_tensor(data + index, buffer_ptr + offset, static_cast<uint32_t>(count), info.data_type());
+    });
 }
 
-void copy_data_to_tensor(arm_compute::ITensor& tensor, const float* data)
+void copy_data_from_tensor(const arm_compute::ITensor& tensor, float* data)
 {
-    auto& info = *tensor.info();
-    auto& shape = info.tensor_shape();
+    const auto& info = *tensor.info();
+    const uint8_t* buffer_ptr = tensor.buffer();
+    for_each_tensor_run(info, [&](size_t index, size_t offset, size_t count)
+    {
+        copy_row_from_tensor(buffer_ptr + offset, data + index, static_cast<uint32_t>(count), info.data_type());
+    });
+}
 
-    uint8_t* buffer_ptr = tensor.buffer();
-    uint32_t width = static_cast<uint32_t>(shape[0]);
-    uint32_t height = static_cast<uint32_t>(shape[1]);
-    uint32_t num_channels = static_cast<uint32_t>(shape[2]);
-    uint32_t num_batches = static_cast<uint32_t>(shape[3]);
-    uint32_t depth = static_cast<uint32_t>(shape[4]);
+arm_compute::ITensorAllocator& get_tensor_allocator(arm_compute::ITensor& tensor)
+{
+    auto* cl_tensor = dynamic_cast<arm_compute::CLTensor*>(&tensor);
+    if(cl_tensor)
+    {
+        return *cl_tensor->allocator();
+    }
+    return *static_cast<arm_compute::Tensor&>(tensor).allocator();
+}
 
-    for (unsigned int depth_index = 0; depth_index < depth; ++depth_index)
+void map_tensor(arm_compute::ITensor& tensor)
+{
+    auto* cl_tensor = dynamic_cast<arm_compute::CLTensor*>(&tensor);
+    if(cl_tensor)
     {
-        for (unsigned int batch_index = 0; batch_index < num_batches; ++batch_index)
-        {
-            for (unsigned int channel_index = 0; channel_index < num_channels; ++channel_index)
-            {
-                for (unsigned int y = 0; y < height; ++y)
-                {
-                    memcpy(buffer_ptr + get_tensor_offset(info, depth_index, batch_index, channel_index, y, 0),
-                           data + get_linear_buffer_offset(info, depth_index, batch_index, channel_index, y, 0),
-                           width * sizeof(float));
-                }
-            }
-        }
+        cl_tensor->map();
     }
 }
 
-void copy_data_from_tensor(const arm_compute::ITensor& tensor, float* data)
+void unmap_tensor(arm_compute::ITensor& tensor)
 {
-    const auto& info = *tensor.info();
-    const auto& shape = info.tensor_shape();
+    auto* cl_tensor = dynamic_cast<arm_compute::CLTensor*>(&tensor);
+    if(cl_tensor)
+    {
+        cl_tensor->unmap();
+    }
+}
 
-    const uint8_t* buffer_ptr = tensor.buffer();
-    uint32_t width = static_cast<uint32_t>(shape[0]);
-    uint32_t height = static_cast<uint32_t>(shape[1]);
-    uint32_t num_channels = static_cast<uint32_t>(shape[2]);
-    uint32_t num_batches = static_cast<uint32_t>(shape[3]);
-    uint32_t depth = static_cast<uint32_t>(shape[4]);
+void set_tensor_values(arm_compute::ITensor& tensor, const std::vector<float>& values)
+{
+    set_tensor_values(tensor, values.data());
+}
+
+void set_tensor_values(arm_compute::ITensor& tensor, const float* values)
+{
+    map_tensor(tensor);
+    copy_data_to_tensor(tensor, values);
+    unmap_tensor(tensor);
+}
+
+void set_tensor_raw_values(arm_compute::ITensor& tensor, const void* values)
+{
+    map_tensor(tensor);
+    write_tensor_raw_values(*tensor.info(), tensor.buffer(), values);
+    unmap_tensor(tensor);
+}
+
+void write_tensor_raw_values(const arm_compute::ITensorInfo& info, uint8_t* buffer_ptr, const void* values)
+{
+    const auto* src = static_cast<const uint8_t*>(values);
+    size_t element_size = info.element_size();
+    for_each_tensor_run(info, [&](size_t index, size_t offset, size_t count)
+    {
+        memcpy(buffer_ptr + offset, src + index * element_size, count * element_size);
+    });
+}
 
-    for (unsigned int depth_index = 0; depth_index < depth; ++depth_index)
+std::vector<float> calculate_per_channel_scales(const ConstantValues& values, uint32_t channels, uint32_t channel_inner_size)
+{
+    std::vector<float> max_values(channels, 0.0f);
+    for(size_t i = 0; i < values.size(); i++)
     {
-        for (unsigned int batch_index = 0; batch_index < num_batches; ++batch_index)
+        auto& max_value = max_values[(i / channel_inner_size) % channels];
+        max_value = std::max(max_value, std::abs(values[i]));
+    }
+
+    std::vector<float> scales(channels);
+    for(uint32_t c = 0; c < channels; c++)
+    {
+        // Channels with all zero weights still need a valid scale.
+        scales[c] = max_values[c] > 0.0f ? max_values[c] / 127.0f : 1.0f;
+    }
+    return scales;
+}
+
+void set_tensor_quantized_values(arm_compute::ITensor& tensor, const float* values, const std::vector<float>& scales, uint32_t channel_inner_size)
+{
+    map_tensor(tensor);
+    write_tensor_quantized_values(*tensor.info(), tensor.buffer(), values, scales, channel_inner_size);
+    unmap_tensor(tensor);
+}
+
+void write_tensor_quantized_values(const arm_compute::ITensorInfo& info,
+                                   uint8_t* buffer_ptr,
+                                   const float* values,
+                                   const std::vector<float>& scales,
+                                   uint32_t channel_inner_size)
+{
+    auto data_type = info.data_type();
+    if(data_type != arm_compute::DataType::QSYMM8_PER_CHANNEL && data_type != arm_compute::DataType::S32)
+    {
+        throw std::runtime_error("Unsupported quantized tensor data type.");
+    }
+
+    for_each_tensor_run(info, [&](size_t index, size_t offset, size_t count)
+    {
+        uint8_t* dst = buffer_ptr + offset;
+        if(data_type == arm_compute::DataType::S32)
         {
-            for (unsigned int channel_index = 0; channel_index < num_channels; ++channel_index)
-            {
-                for (unsigned int y = 0; y < height; ++y)
-                {
-                    memcpy(data + get_linear_buffer_offset(info, depth_index, batch_index, channel_index, y, 0),
-                           buffer_ptr + get_tensor_offset(info, depth_index, batch_index, channel_index, y,0),
-                           width * sizeof(float));
-                }
-            }
+            // Biases are not clamped, the limit only keeps the value representable.
+            quantize_row_to_tensor<int32_t>(values + index, dst, static_cast<uint32_t>(count), index, scales, channel_inner_size, 2147483520.0f);
         }
-    }
+        else
+        {
+            quantize_row_to_tensor<int8_t>(values + index, dst, static_cast<uint32_t>(count), index, scales, channel_inner_size, 127.0f);
+        }
+    });
 }
 
-void set_tensor_values(arm_compute::CLTensor& tensor, const std::vector<float>& values)
+std::vector<uint8_t> convert_values(const float* values,
+                                    size_t size,
+                                    arm_compute::DataType data_type,
+                                    const std::vector<float>& scales,
+                                    uint32_t channel_inner_size)
 {
-    tensor.map();
-    copy_data_to_tensor(tensor, values.data());
-    tensor.unmap();
+    std::vector<uint8_t> converted(size * arm_compute::data_size_from_type(data_type));
+    switch(data_type)
+    {
+        case arm_compute::DataType::QSYMM8_PER_CHANNEL:
+            quantize_row_to_tensor<int8_t>(values, converted.data(), static_cast<uint32_t>(size), 0, scales, channel_inner_size, 127.0f);
+            break;
+        case arm_compute::DataType::S32:
+            quantize_row_to_tensor<int32_t>(values, converted.data(), static_cast<uint32_t>(size), 0, scales, channel_inner_size, 2147483520.0f);
+            break;
+        default:
+            copy_row_to_tensor(values, converted.data(), static_cast<uint32_t>(size), data_type);
+            break;
+    }
+    return converted;
 }
 
-void fill_tensor(arm_compute::CLTensor& tensor, float value)
+void fill_tensor(arm_compute::ITensor& tensor, float value)
 {
     std::vector<float> values(tensor.info()->tensor_shape().total_size(), value);
     set_tensor_values(tensor, values);
 }
 
-std::vector<float> get_tensor_values(arm_compute::CLTensor& tensor)
+std::vector<float> get_tensor_values(arm_compute::ITensor& tensor)
 {
     size_t num_elements = tensor.info()->tensor_shape().total_size();
     std::vector<float> values(num_elements);
-    tensor.map();
+    map_tensor(tensor);
     copy_data_from_tensor(tensor, values.data());
-    tensor.unmap();
+    unmap_tensor(tensor);
     return values;
 }
\ No newline at end of file
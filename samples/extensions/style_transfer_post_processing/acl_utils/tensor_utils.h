@@ -18,8 +18,66 @@
 #pragma once
 
 #include <arm_compute/runtime/CL/CLTensor.h>
+#include <arm_compute/runtime/Tensor.h>
+#include <vector>
+
+// Values of a constant tensor (weights or biases), F32 unless they are already converted to the data type of the tensor.
+// The values point to memory owned by someone else (e.g. the memory-mapped model) until they are modified for the first time.
+class ConstantValues
+{
+public:
+    ConstantValues() = default;
+
+    // The values must stay valid for the whole lifetime of this object.
+    ConstantValues(const float* values, size_t size);
+
+    explicit ConstantValues(std::vector<float> values);
+
+    // Values already converted to the data type of the tensor, e.g. in the precompiled network.
+    // QSYMM8_PER_CHANNEL values keep the scales they were quantized with.
+    ConstantValues(const void* values, size_t size, arm_compute::DataType data_type, std::vector<float> scales = {});
+
+    arm_compute::DataType get_data_type() const;
+
+    const std::vector<float>& get_scales() const;
+
+    const void* raw_data() const;
+
+    // The float accessors are valid only for F32 values.
+    const float* data() const;
+
+    size_t size() const;
+
+    const float* begin() const;
+
+    const float* end() const;
+
+    const float& operator[](size_t index) const;
+
+    // Values that can be modified, the external values are copied on the first call.
+    std::vector<float>& get_mutable();
+
+private:
+    const void* external_values{nullptr};
+
+    size_t external_size{0};
+
+    arm_compute::DataType data_type{arm_compute::DataType::F32};
+
+    std::vector<float> scales;
+
+    std::vector<float> owned_values;
+
+    bool owned{false};
+};
+
+// Output sizes of convolution and transposed convolution along one dimension.
+uint32_t calculate_conv_output_size(uint32_t input_size, uint32_t kernel_size, uint32_t pad, uint32_t stride, uint32_t dilation);
+
+uint32_t calculate_deconv_output_size(uint32_t input_size, uint32_t kernel_size, uint32_t pad, uint32_t stride);
 
 // Transpose values order from tflite format to Arm Compute Library format for Conv2D and DepthwiseConv2D layers.
+// Large kernels are transposed in parallel on the thread pool of the tensor utilities.
 std::vector<float> transpose_kernel_values(const std::vector<float>& values,
                                            uint32_t width,
                                            uint32_t height,
@@ -33,26 +91,56 @@ std::vector<float> transpose_deconv_kernel_values(const std::vector<float>& valu
                                                   uint32_t input_channels,
                                                   uint32_t output_features);
 
-inline size_t get_tensor_offset(const arm_compute::ITensorInfo& info,
-                                uint32_t depth_index,
-                                uint32_t batch_index,
-                                uint32_t channel_index,
-                                uint32_t y,
-                                uint32_t x);
+// Copies float values to a tensor, converting them to the tensor data type (F32 or F16).
+void copy_data_to_tensor(arm_compute::ITensor& tensor, const float* data);
+
+// The write functions fill a host buffer laid out as the tensor described by the info (info.total_size() bytes including padding),
+// e.g. the mapped tensor memory or a staging buffer that is copied to the tensor later.
+void write_tensor_values(const arm_compute::ITensorInfo& info, uint8_t* buffer, const float* data);
 
-inline size_t get_linear_buffer_offset(const arm_compute::ITensorInfo& info,
-                                       uint32_t depth_index,
-                                       uint32_t batch_index,
-                                       uint32_t channel_index,
-                                       uint32_t y,
-                                       uint32_t x);
+void write_tensor_raw_values(const arm_compute::ITensorInfo& info, uint8_t* buffer, const void* values);
 
-void copy_data_to_tensor(arm_compute::ITensor& tensor, const float* data);
+void write_tensor_quantized_values(const arm_compute::ITensorInfo& info,
+                                   uint8_t* buffer,
+                                   const float* values,
+                                   const std::vector<float>& scales,
+                                   uint32_t channel_inner_size);
 
+// Copies tensor values to a float buffer, converting them from the tensor data type (F32 or F16).
 void copy_data_from_tensor(const arm_compute::ITensor& tensor, float* data);
 
-void set_tensor_values(arm_compute::CLTensor& tensor, const std::vector<float>& values);
+// Allocator of a CLTensor or a CPU Tensor.
+arm_compute::ITensorAllocator& get_tensor_allocator(arm_compute::ITensor& tensor);
+
+// Makes the memory of a CLTensor accessible through buffer(), memory of CPU tensors is always accessible.
+void map_tensor(arm_compute::ITensor& tensor);
+
+void unmap_tensor(arm_compute::ITensor& tensor);
+
+void set_tensor_values(arm_compute::ITensor& tensor, const std::vector<float>& values);
+
+// Maps the tensor and converts the values to the tensor data type (F32 or F16) while they are copied.
+void set_tensor_values(arm_compute::ITensor& tensor, const float* values);
+
+// Copies already converted values (elements of the tensor data type) to the tensor, taking its strides into account.
+void set_tensor_raw_values(arm_compute::ITensor& tensor, const void* values);
+
+// Calculates symmetric scales for weights quantized per channel.
+// The channel of value i is (i / channel_inner_size) % channels.
+std::vector<float> calculate_per_channel_scales(const ConstantValues& values, uint32_t channels, uint32_t channel_inner_size);
+
+// Maps the tensor and quantizes the values while they are copied, value i is divided by scales[(i / channel_inner_size) % scales.size()].
+// The tensor must be QSYMM8_PER_CHANNEL (weights) or S32 (bias of a quantized layer, with scales input_scale * weights_scale).
+void set_tensor_quantized_values(arm_compute::ITensor& tensor, const float* values, const std::vector<float>& scales, uint32_t channel_inner_size);
+
+// Converts float values to a buffer of the data type, the same way as they are converted when they are copied to a tensor.
+// Quantized data types (QSYMM8_PER_CHANNEL, S32) use the scales as set_tensor_quantized_values().
+std::vector<uint8_t> convert_values(const float* values,
+                                    size_t size,
+                                    arm_compute::DataType data_type,
+                                    const std::vector<float>& scales = {},
+                                    uint32_t channel_inner_size = 1);
 
-void fill_tensor(arm_compute::CLTensor& tensor, float value);
+void fill_tensor(arm_compute::ITensor& tensor, float value);
 
-std::vector<float> get_tensor_values(arm_compute::CLTensor& tensor);
\ No newline at end of file
+std::vector<float> get_tensor_values(arm_compute::ITensor& tensor);
\ No newline at end of file
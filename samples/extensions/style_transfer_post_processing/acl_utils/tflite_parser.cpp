@@ -19,9 +19,9 @@
 
 #include <tflite_schema.h>
 #include <common/logging.h>
-#include <platform/filesystem.h>
-#include <platform/platform.h>
 #include "tensor_utils.h"
+#include "graph_optimizer.h"
+#include <algorithm>
 
 using ActivationFunction = arm_compute::ActivationLayerInfo::ActivationFunction;
 
@@ -64,15 +64,72 @@ void calculate_padding(uint32_t input_size,
     }
 }
 
-std::vector<float> copy_to_vector(const float* values, size_t size)
+// Returns quantization of the model tensor, or empty quantization info for float networks.
+arm_compute::QuantizationInfo get_quantization(const TFLiteParser::QuantizationTable& quantization, int32_t index)
 {
-    std::vector<float> values_vector(size / sizeof(float));
-    memcpy(values_vector.data(), values, size);
-    return values_vector;
+    auto it = quantization.find(index);
+    return it != quantization.end() ? it->second : arm_compute::QuantizationInfo();
 }
 
-void parse_transpose_conv_2d(ACLNetwork& net,
-                   std::unordered_map<int32_t, arm_compute::CLTensor*>& tensors,
+// Creates a graph tensor for an output of a model operator, it has the data type of the operator input.
+GraphTensor create_model_tensor(const NetworkGraph& graph,
+                                uint32_t input,
+                                const std::vector<uint32_t>& shape,
+                                int32_t model_index,
+                                const TFLiteParser::QuantizationTable& quantization)
+{
+    GraphTensor tensor;
+    tensor.shape = shape;
+    tensor.data_type = graph.get_tensors()[input].data_type;
+    tensor.quantization = get_quantization(quantization, model_index);
+    tensor.model_index = model_index;
+    return tensor;
+}
+
+// Conversion of the rendered image to sRGB color space.
+ColorConversionInfo get_linear_to_srgb_info()
+{
+    // We first need to normalize values to [0, 1] (during this step we also multiply all the values by 'brightness_adjustment' to make the image brighter).
+    // Then the values are calculated as (x ** (1 / 2.4)) * 269.025 - 14.025. These values are again in range [0, 255].
+    float brightness_adjustment = 1.7f;
+    ColorConversionInfo info;
+    info.pre_scale = 1.0f / 255.0f * brightness_adjustment;
+    info.exponent = 1.0f / 2.4f;
+    info.post_scale = 269.025f;
+    info.post_bias = -14.025f;
+    return info;
+}
+
+// Conversion of the network output back to linear color space.
+ColorConversionInfo get_srgb_to_linear_info()
+{
+    // We first need to normalize values to [0, 1].
+    // Then the values are calculated as ((x + 0.055) ** 2.4) * 255. These values are again in range [0, 255].
+    ColorConversionInfo info;
+    info.pre_scale = 1.0f / 255.0f;
+    info.pre_bias = 0.055f;
+    info.exponent = 2.4f;
+    info.post_scale = 255.0f;
+    return info;
+}
+
+// Values of the buffer are used directly from the model. They are copied only if they are not aligned for float access.
+ConstantValues get_buffer_values(const tflite::Buffer& buffer)
+{
+    const auto* data = buffer.data()->Data();
+    size_t size = buffer.data()->size() / sizeof(float);
+    if(reinterpret_cast<uintptr_t>(data) % alignof(float) != 0)
+    {
+        std::vector<float> values(size);
+        memcpy(values.data(), data, size * sizeof(float));
+        return ConstantValues(std::move(values));
+    }
+    return ConstantValues(reinterpret_cast<const float*>(data), size);
+}
+
+void parse_transpose_conv_2d(NetworkGraph& graph,
+                   std::unordered_map<int32_t, uint32_t>& tensors,
+                   const TFLiteParser::QuantizationTable& quantization,
                    const tflite::Model& model,
                    const tflite::SubGraph& subgraph,
                    const tflite::Operator& op)
@@ -81,8 +138,8 @@ void parse_transpose_conv_2d(ACLNetwork& net,
     auto& input_indices = *op.inputs();
     auto& output_indices = *op.outputs();
 
-    const auto& input = tensors.at(input_indices.Get(2));
-    auto input_shape = input->info()->tensor_shape();
+    auto input = tensors.at(input_indices.Get(2));
+    auto input_shape = graph.get_tensors()[input].shape;
     uint32_t input_width = input_shape[1];
     uint32_t input_height = input_shape[2];
 
@@ -93,38 +150,30 @@ void parse_transpose_conv_2d(ACLNetwork& net,
     const auto& bias_tensor = subgraph.tensors()->Get(input_indices.Get(3));
     const auto& bias_buffer = model.buffers()->Get(bias_tensor->buffer());
 
-    uint32_t kernel_width = kernel_shape[2];
-    uint32_t kernel_height = kernel_shape[1];
-    uint32_t output_features = kernel_shape[0];
-    int32_t stride_x = (int32_t)options->stride_w();
-    int32_t stride_y = (int32_t)options->stride_h();
-    uint32_t padding_front_x = 0;
-    uint32_t padding_back_x = 0;
-    uint32_t padding_front_y = 0;
-    uint32_t padding_back_y = 0;
-
-    calculate_padding(input_width, kernel_width, stride_x, 1, padding_front_x, padding_back_x, options->padding());
-    calculate_padding(input_height, kernel_height, stride_y, 1, padding_front_y, padding_back_y, options->padding());
-
-    auto kernel_values = copy_to_vector((const float*)kernel_buffer->data()->Data(), kernel_buffer->data()->size());
-    auto bias_values = copy_to_vector((const float*)bias_buffer->data()->Data(), bias_buffer->data()->size());
-
-    tensors[output_indices.Get(0)] = &net.add_conv2d_transpose(*input,
-                                                     kernel_width,
-                                                     kernel_height,
-                                                     output_features,
-                                                     padding_front_x,
-                                                     padding_back_x,
-                                                     padding_front_y,
-                                                     padding_back_y,
-                                                     stride_x,
-                                                     stride_y,
-                                                     kernel_values,
-                                                     bias_values);
+    GraphNode node{GraphNodeType::TransposeConv2D};
+    node.inputs = {input};
+    node.kernel_width = kernel_shape[2];
+    node.kernel_height = kernel_shape[1];
+    node.output_features = kernel_shape[0];
+    node.stride_x = options->stride_w();
+    node.stride_y = options->stride_h();
+
+    calculate_padding(input_width, node.kernel_width, node.stride_x, 1, node.pad_x_front, node.pad_x_back, options->padding());
+    calculate_padding(input_height, node.kernel_height, node.stride_y, 1, node.pad_y_front, node.pad_y_back, options->padding());
+
+    node.kernel_values = get_buffer_values(*kernel_buffer);
+    node.bias_values = get_buffer_values(*bias_buffer);
+
+    uint32_t output_width = calculate_deconv_output_size(input_width, node.kernel_width, std::max(node.pad_x_front, node.pad_x_back), node.stride_x);
+    uint32_t output_height = calculate_deconv_output_size(input_height, node.kernel_height, std::max(node.pad_y_front, node.pad_y_back), node.stride_y);
+
+    int32_t output_index = output_indices.Get(0);
+    tensors[output_index] = graph.add_node(node, create_model_tensor(graph, input, {node.output_features, output_width, output_height}, output_index, quantization));
 }
 
-void parse_depthwise_conv_2d(ACLNetwork& net,
-                   std::unordered_map<int32_t, arm_compute::CLTensor*>& tensors,
+void parse_depthwise_conv_2d(NetworkGraph& graph,
+                   std::unordered_map<int32_t, uint32_t>& tensors,
+                   const TFLiteParser::QuantizationTable& quantization,
                    const tflite::Model& model,
                    const tflite::SubGraph& subgraph,
                    const tflite::Operator& op)
@@ -133,8 +182,8 @@ void parse_depthwise_conv_2d(ACLNetwork& net,
     auto& input_indices = *op.inputs();
     auto& output_indices = *op.outputs();
 
-    const auto& input = tensors.at(input_indices.Get(0));
-    auto input_shape = input->info()->tensor_shape();
+    auto input = tensors.at(input_indices.Get(0));
+    auto input_shape = graph.get_tensors()[input].shape;
     uint32_t input_width = input_shape[1];
     uint32_t input_height = input_shape[2];
 
@@ -145,43 +194,34 @@ void parse_depthwise_conv_2d(ACLNetwork& net,
     const auto& bias_tensor = subgraph.tensors()->Get(input_indices.Get(2));
     const auto& bias_buffer = model.buffers()->Get(bias_tensor->buffer());
 
-    uint32_t kernel_width = kernel_shape[2];
-    uint32_t kernel_height = kernel_shape[1];
-    int32_t stride_x = (int32_t)options->stride_w();
-    int32_t stride_y = (int32_t)options->stride_h();
-    int32_t dilation_x = options->dilation_w_factor();
-    int32_t dilation_y = options->dilation_h_factor();
-    uint32_t padding_front_x = 0;
-    uint32_t padding_back_x = 0;
-    uint32_t padding_front_y = 0;
-    uint32_t padding_back_y = 0;
-
-    calculate_padding(input_width, kernel_width, stride_x, dilation_x, padding_front_x, padding_back_x, options->padding());
-    calculate_padding(input_height, kernel_height, stride_y, dilation_y, padding_front_y, padding_back_y, options->padding());
-
-    auto activation_function = TFLITE_TO_ACL_ACTIVATION.at(options->fused_activation_function());
-
-    auto kernel_values = copy_to_vector((const float*)kernel_buffer->data()->Data(), kernel_buffer->data()->size());
-    auto bias_values = copy_to_vector((const float*)bias_buffer->data()->Data(), bias_buffer->data()->size());
-
-    tensors[output_indices.Get(0)] = &net.add_depthwise_conv2d(*input,
-                                                     kernel_width,
-                                                     kernel_height,
-                                                     padding_front_x,
-                                                     padding_back_x,
-                                                     padding_front_y,
-                                                     padding_back_y,
-                                                     stride_x,
-                                                     stride_y,
-                                                     kernel_values,
-                                                     bias_values,
-                                                     activation_function,
-                                                     dilation_x,
-                                                     dilation_y);
+    GraphNode node{GraphNodeType::DepthwiseConv2D};
+    node.inputs = {input};
+    node.kernel_width = kernel_shape[2];
+    node.kernel_height = kernel_shape[1];
+    node.output_features = input_shape[0];
+    node.stride_x = options->stride_w();
+    node.stride_y = options->stride_h();
+    node.dilation_x = options->dilation_w_factor();
+    node.dilation_y = options->dilation_h_factor();
+
+    calculate_padding(input_width, node.kernel_width, node.stride_x, node.dilation_x, node.pad_x_front, node.pad_x_back, options->padding());
+    calculate_padding(input_height, node.kernel_height, node.stride_y, node.dilation_y, node.pad_y_front, node.pad_y_back, options->padding());
+
+    node.activation = TFLITE_TO_ACL_ACTIVATION.at(options->fused_activation_function());
+
+    node.kernel_values = get_buffer_values(*kernel_buffer);
+    node.bias_values = get_buffer_values(*bias_buffer);
+
+    uint32_t output_width = calculate_conv_output_size(input_width, node.kernel_width, std::max(node.pad_x_front, node.pad_x_back), node.stride_x, node.dilation_x);
+    uint32_t output_height = calculate_conv_output_size(input_height, node.kernel_height, std::max(node.pad_y_front, node.pad_y_back), node.stride_y, node.dilation_y);
+
+    int32_t output_index = output_indices.Get(0);
+    tensors[output_index] = graph.add_node(node, create_model_tensor(graph, input, {node.output_features, output_width, output_height}, output_index, quantization));
 }
 
-void parse_conv_2d(ACLNetwork& net,
-                   std::unordered_map<int32_t, arm_compute::CLTensor*>& tensors,
+void parse_conv_2d(NetworkGraph& graph,
+                   std::unordered_map<int32_t, uint32_t>& tensors,
+                   const TFLiteParser::QuantizationTable& quantization,
                    const tflite::Model& model,
                    const tflite::SubGraph& subgraph,
                    const tflite::Operator& op)
@@ -190,8 +230,8 @@ void parse_conv_2d(ACLNetwork& net,
     auto& input_indices = *op.inputs();
     auto& output_indices = *op.outputs();
 
-    const auto& input = tensors.at(input_indices.Get(0));
-    auto input_shape = input->info()->tensor_shape();
+    auto input = tensors.at(input_indices.Get(0));
+    auto input_shape = graph.get_tensors()[input].shape;
     uint32_t input_width = input_shape[1];
     uint32_t input_height = input_shape[2];
 
@@ -202,45 +242,34 @@ void parse_conv_2d(ACLNetwork& net,
     const auto& bias_tensor = subgraph.tensors()->Get(input_indices.Get(2));
     const auto& bias_buffer = model.buffers()->Get(bias_tensor->buffer());
 
-    uint32_t kernel_width = kernel_shape[2];
-    uint32_t kernel_height = kernel_shape[1];
-    uint32_t output_features = kernel_shape[0];
-    int32_t stride_x = (int32_t)options->stride_w();
-    int32_t stride_y = (int32_t)options->stride_h();
-    int32_t dilation_x = options->dilation_w_factor();
-    int32_t dilation_y = options->dilation_h_factor();
-    uint32_t padding_front_x = 0;
-    uint32_t padding_back_x = 0;
-    uint32_t padding_front_y = 0;
-    uint32_t padding_back_y = 0;
-
-    calculate_padding(input_width, kernel_width, stride_x, dilation_x, padding_front_x, padding_back_x, options->padding());
-    calculate_padding(input_height, kernel_height, stride_y, dilation_y, padding_front_y, padding_back_y, options->padding());
-
-    auto activation_function = TFLITE_TO_ACL_ACTIVATION.at(options->fused_activation_function());
-
-    auto kernel_values = copy_to_vector((const float*)kernel_buffer->data()->Data(), kernel_buffer->data()->size());
-    auto bias_values = copy_to_vector((const float*)bias_buffer->data()->Data(), bias_buffer->data()->size());
-
-    tensors[output_indices.Get(0)] = &net.add_conv2d(*input,
-                   kernel_width,
-                   kernel_height,
-                   output_features,
-                   padding_front_x,
-                   padding_back_x,
-                   padding_front_y,
-                   padding_back_y,
-                   stride_x,
-                   stride_y,
-                   kernel_values,
-                   bias_values,
-                   activation_function,
-                   dilation_x,
-                   dilation_y);
+    GraphNode node{GraphNodeType::Conv2D};
+    node.inputs = {input};
+    node.kernel_width = kernel_shape[2];
+    node.kernel_height = kernel_shape[1];
+    node.output_features = kernel_shape[0];
+    node.stride_x = options->stride_w();
+    node.stride_y = options->stride_h();
+    node.dilation_x = options->dilation_w_factor();
+    node.dilation_y = options->dilation_h_factor();
+
+    calculate_padding(input_width, node.kernel_width, node.stride_x, node.dilation_x, node.pad_x_front, node.pad_x_back, options->padding());
+    calculate_padding(input_height, node.kernel_height, node.stride_y, node.dilation_y, node.pad_y_front, node.pad_y_back, options->padding());
+
+    node.activation = TFLITE_TO_ACL_ACTIVATION.at(options->fused_activation_function());
+
+    node.kernel_values = get_buffer_values(*kernel_buffer);
+    node.bias_values = get_buffer_values(*bias_buffer);
+
+    uint32_t output_width = calculate_conv_output_size(input_width, node.kernel_width, std::max(node.pad_x_front, node.pad_x_back), node.stride_x, node.dilation_x);
+    uint32_t output_height = calculate_conv_output_size(input_height, node.kernel_height, std::max(node.pad_y_front, node.pad_y_back), node.stride_y, node.dilation_y);
+
+    int32_t output_index = output_indices.Get(0);
+    tensors[output_index] = graph.add_node(node, create_model_tensor(graph, input, {node.output_features, output_width, output_height}, output_index, quantization));
 }
 
-void parse_relu(ACLNetwork& net,
-                std::unordered_map<int32_t, arm_compute::CLTensor*>& tensors,
+void parse_relu(NetworkGraph& graph,
+                std::unordered_map<int32_t, uint32_t>& tensors,
+                const TFLiteParser::QuantizationTable& quantization,
                 const tflite::Model& model,
                 const tflite::SubGraph& subgraph,
                 const tflite::Operator& op)
@@ -248,13 +277,19 @@ void parse_relu(ACLNetwork& net,
     auto& input_indices = *op.inputs();
     auto& output_indices = *op.outputs();
 
-    const auto& input = tensors.at(input_indices.Get(0));
+    auto input = tensors.at(input_indices.Get(0));
+
+    GraphNode node{GraphNodeType::Activation};
+    node.inputs = {input};
+    node.activation = ActivationFunction::RELU;
 
-    tensors[output_indices.Get(0)] = &net.add_activation(*input, ActivationFunction::RELU);
+    int32_t output_index = output_indices.Get(0);
+    tensors[output_index] = graph.add_node(node, create_model_tensor(graph, input, graph.get_tensors()[input].shape, output_index, quantization));
 }
 
-void parse_add(ACLNetwork& net,
-                std::unordered_map<int32_t, arm_compute::CLTensor*>& tensors,
+void parse_add(NetworkGraph& graph,
+                std::unordered_map<int32_t, uint32_t>& tensors,
+                const TFLiteParser::QuantizationTable& quantization,
                 const tflite::Model& model,
                 const tflite::SubGraph& subgraph,
                 const tflite::Operator& op)
@@ -263,23 +298,31 @@ void parse_add(ACLNetwork& net,
     auto& input_indices = *op.inputs();
     auto& output_indices = *op.outputs();
 
-    const auto& input0 = tensors.at(input_indices.Get(0));
-    const auto& input1 = tensors.at(input_indices.Get(1));
+    auto input0 = tensors.at(input_indices.Get(0));
+    auto input1 = tensors.at(input_indices.Get(1));
 
-    auto activation_function = TFLITE_TO_ACL_ACTIVATION.at(options->fused_activation_function());
+    GraphNode node{GraphNodeType::Addition};
+    node.inputs = {input0, input1};
+    node.activation = TFLITE_TO_ACL_ACTIVATION.at(options->fused_activation_function());
 
-    tensors[output_indices.Get(0)] = &net.add_addition(*input0, *input1, activation_function);
+    int32_t output_index = output_indices.Get(0);
+    tensors[output_index] = graph.add_node(node, create_model_tensor(graph, input0, graph.get_tensors()[input0].shape, output_index, quantization));
 }
 
-std::unique_ptr<ACLNetwork> TFLiteParser::parse_model(const std::vector<uint8_t> &data,  const arm_compute::CLTensor &input_output_tensor)
+NetworkGraph TFLiteParser::parse_graph(const ModelFile &model,
+                                       const arm_compute::ITensorInfo &input_output_info,
+                                       arm_compute::DataType data_type,
+                                       const QuantizationTable& quantization)
 {
-    auto network = std::make_unique<ACLNetwork>();
-    auto &input_model = *tflite::GetModel(data.data());
+    bool quantized = arm_compute::is_data_type_quantized(data_type);
+
+    NetworkGraph graph;
+    auto &input_model = *tflite::GetModel(model.data());
     auto &input_subgraphs = *input_model.subgraphs();
     auto &subgraph = *input_subgraphs.Get(0);
 
     const auto& opcodes = *input_model.operator_codes();
-    std::unordered_map<int32_t, arm_compute::CLTensor*> tensors;
+    std::unordered_map<int32_t, uint32_t> tensors;
 
     auto input_indices = to_uint_vector(subgraph.inputs());
     auto output_indices = to_uint_vector(subgraph.outputs());
@@ -288,11 +331,34 @@ std::unique_ptr<ACLNetwork> TFLiteParser::parse_model(const std::vector<uint8_t>
         throw std::runtime_error("The model has more than one input/output, but single input/output tensor is specified.");
     }
 
-    auto& dequantized_input = network->add_dequantization(input_output_tensor);
+    const auto& input_output_shape = input_output_info.tensor_shape();
+    GraphTensor image;
+    image.shape = {(uint32_t)input_output_shape[0], (uint32_t)input_output_shape[1], (uint32_t)input_output_shape[2]};
+    image.data_type = input_output_info.data_type();
+    image.quantization = input_output_info.quantization_info();
+    graph.set_input(graph.add_tensor(image));
 
     // The model is intended to be used with rendered images in linear color space.
     // We are adding conversion to sRGB to improve quality when the images are processed using a neural network.
-    tensors[input_indices[0]] = &network->add_linear_to_srgb(dequantized_input);
+    // The conversion reads the RGBA8 image directly and writes the model input, which is quantized in quantized networks.
+    auto model_input_shape = to_uint_vector(subgraph.tensors()->Get(input_indices[0])->shape());
+    GraphTensor model_input;
+    model_input.shape = {model_input_shape[3], image.shape[1], image.shape[2]};
+    model_input.data_type = data_type;
+    model_input.model_index = input_indices[0];
+    if(quantized)
+    {
+        if(quantization.count(input_indices[0]) == 0)
+        {
+            throw std::runtime_error("Quantization of the model input is not specified.");
+        }
+        model_input.quantization = quantization.at(input_indices[0]);
+    }
+
+    GraphNode input_conversion{GraphNodeType::ColorConversion};
+    input_conversion.inputs = {graph.get_input()};
+    input_conversion.color_conversion = get_linear_to_srgb_info();
+    tensors[input_indices[0]] = graph.add_node(input_conversion, model_input);
 
     for(const auto& op : *subgraph.operators())
     {
@@ -303,28 +369,50 @@ std::unique_ptr<ACLNetwork> TFLiteParser::parse_model(const std::vector<uint8_t>
         switch (builtin_code)
         {
             case tflite::BuiltinOperator_CONV_2D:
-                parse_conv_2d(*network, tensors, input_model, subgraph, *op);
+                parse_conv_2d(graph, tensors, quantization, input_model, subgraph, *op);
                 break;
             case tflite::BuiltinOperator_DEPTHWISE_CONV_2D:
-                parse_depthwise_conv_2d(*network, tensors, input_model, subgraph, *op);
+                parse_depthwise_conv_2d(graph, tensors, quantization, input_model, subgraph, *op);
                 break;
             case tflite::BuiltinOperator_RELU:
-                parse_relu(*network, tensors, input_model, subgraph, *op);
+                parse_relu(graph, tensors, quantization, input_model, subgraph, *op);
                 break;
             case tflite::BuiltinOperator_ADD:
-                parse_add(*network, tensors, input_model, subgraph, *op);
+                parse_add(graph, tensors, quantization, input_model, subgraph, *op);
                 break;
             case tflite::BuiltinOperator_TRANSPOSE_CONV:
-                parse_transpose_conv_2d(*network, tensors, input_model, subgraph, *op);
+                parse_transpose_conv_2d(graph, tensors, quantization, input_model, subgraph, *op);
                 break;
             default:
                 throw std::runtime_error("Operation with builtin code " + std::to_string(builtin_code) + " is not supported by tflite importer.");
         }
+
+        for(auto output_index : *op->outputs())
+        {
+            if(quantized && quantization.count(output_index) == 0)
+            {
+                throw std::runtime_error("Quantization of the model tensor " + std::to_string(output_index) + " is not specified.");
+            }
+        }
     }
 
-    // Converting the result back to linear color space.
-    auto& linear_output = network->add_srgb_to_linear(*tensors[output_indices[0]]);
-    network->add_quantization(linear_output, input_output_tensor);
+    // Converting the result back to linear color space, the result is written to the RGBA8 image (alpha channel is kept).
+    GraphNode output_conversion{GraphNodeType::ColorConversion};
+    output_conversion.inputs = {tensors.at(output_indices[0])};
+    output_conversion.color_conversion = get_srgb_to_linear_info();
+    graph.set_output(graph.add_node(output_conversion, image));
 
-    return network;
+    return graph;
+}
+
+std::unique_ptr<ACLNetwork> TFLiteParser::parse_model(const ModelFile &model,
+                                                      const arm_compute::ITensor &input_output_tensor,
+                                                      arm_compute::DataType data_type,
+                                                      ACLNetwork::ActivationMemoryMode memory_mode,
+                                                      const QuantizationTable& quantization)
+{
+    // Weights and biases are stored as F32 in the model, they are converted to the network data type when they are copied to the tensors.
+    auto graph = parse_graph(model, *input_output_tensor.info(), data_type, quantization);
+    GraphOptimizer::optimize(graph);
+    return graph.create_network(input_output_tensor, data_type, memory_mode);
 }
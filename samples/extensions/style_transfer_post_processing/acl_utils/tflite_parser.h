@@ -18,12 +18,15 @@
 #pragma once
 
 #include "acl_network.h"
+#include "network_graph.h"
+#include "model_file.h"
 #include <vector>
 #include <memory>
+#include <unordered_map>
 
 /*
- * This helper class loads a tflite model file and adds layers to ACLNetwork one by one.
- * The weights are also loaded.
+ * This helper class loads a tflite model file into a NetworkGraph, optimizes the graph and adds its layers to ACLNetwork one by one.
+ * The model is parsed in place from the memory-mapped file and the weights are copied from it directly to the tensors.
  *
  * Note: We are using 'Runtime' part of Arm Compute Library. It only provides individual functions/layers, so ACLNetwork class serves as a container.
  * This is why ACL does not have such functionality as parsing tflite files.
@@ -34,5 +37,21 @@
 class TFLiteParser
 {
 public:
-    static std::unique_ptr<ACLNetwork> parse_model(const std::vector<uint8_t>& data, const arm_compute::CLTensor& input_output_tensor);
+    // Quantization of the model tensors, indexed by the tensor index in the model.
+    using QuantizationTable = std::unordered_map<int32_t, arm_compute::QuantizationInfo>;
+
+    // Creates the graph of the model including color space conversion of the processed image, without any optimizations.
+    // QASYMM8 networks require quantization for the model input and for the outputs of all the operators.
+    // The graph refers to the weights in the model, so the model must outlive it.
+    static NetworkGraph parse_graph(const ModelFile& model,
+                                    const arm_compute::ITensorInfo& input_output_info,
+                                    arm_compute::DataType data_type = arm_compute::DataType::F32,
+                                    const QuantizationTable& quantization = QuantizationTable());
+
+    // Parses and optimizes the graph and creates the network for it.
+    static std::unique_ptr<ACLNetwork> parse_model(const ModelFile& model,
+                                                   const arm_compute::ITensor& input_output_tensor,
+                                                   arm_compute::DataType data_type = arm_compute::DataType::F32,
+                                                   ACLNetwork::ActivationMemoryMode memory_mode = ACLNetwork::ActivationMemoryMode::Offset,
+                                                   const QuantizationTable& quantization = QuantizationTable());
 };
\ No newline at end of file
@@ -0,0 +1,61 @@
+/* Copyright (c) 2022, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 the "License";
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Checks that SplitBalancer moves the split towards the faster band and keeps a balanced split.
+// Build with -DSTYLE_TRANSFER_BENCHMARKS=ON and run it on the host or the device, it's also registered with CTest.
+
+#include "../acl_utils/split_balancer.h"
+#include <cstdio>
+
+namespace
+{
+bool check(bool condition, const char* message)
+{
+    if(!condition)
+    {
+        std::printf("FAILED: %s\n", message);
+    }
+    return condition;
+}
+}        // namespace
+
+int main()
+{
+    bool passed = true;
+
+    // The CPU band takes 4x longer than the GPU band, so the GPU gets more rows.
+    SplitBalancer slow_cpu(512, 32, 16, 256);
+    passed &= check(slow_cpu.update(5.0, 20.0), "unequal band times report a new balanced row");
+    passed &= check(slow_cpu.get_balanced_row() > 256, "the balanced row moves below the initial split when the CPU is slower");
+    passed &= check(slow_cpu.get_split_row() == 256, "the split row stays until the balanced row is applied");
+    passed &= check(!slow_cpu.update(5.0, 20.0), "the same band times don't report a change again");
+    slow_cpu.apply_balanced_row();
+    passed &= check(slow_cpu.get_split_row() == slow_cpu.get_balanced_row(), "applying moves the split to the balanced row");
+
+    // The GPU band takes 4x longer than the CPU band, so the CPU gets more rows.
+    SplitBalancer slow_gpu(512, 32, 16, 256);
+    slow_gpu.update(20.0, 5.0);
+    passed &= check(slow_gpu.get_balanced_row() < 256, "the balanced row moves above the initial split when the GPU is slower");
+
+    // Bands within the tolerance keep the split.
+    SplitBalancer balanced(512, 32, 16, 256);
+    passed &= check(!balanced.update(10.0, 10.2), "balanced band times don't move the split");
+    passed &= check(balanced.get_balanced_row() == 256, "balanced band times keep the balanced row at the split");
+
+    std::printf(passed ? "SplitBalancer checks passed\n" : "SplitBalancer checks failed\n");
+    return passed ? 0 : 1;
+}
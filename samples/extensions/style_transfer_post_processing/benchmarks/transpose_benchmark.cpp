@@ -0,0 +1,147 @@
+/* Copyright (c) 2022, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 the "License";
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Compares the tiled, multithreaded kernel transposes with the scalar loops they replaced,
+// for the kernels of the style transfer network and for larger ones.
+// Build with -DSTYLE_TRANSFER_BENCHMARKS=ON and run it on the host, or push the executable to the device and run it from adb shell.
+
+#include "../acl_utils/tensor_utils.h"
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <random>
+
+namespace
+{
+struct KernelSize
+{
+    uint32_t width;
+
+    uint32_t height;
+
+    uint32_t input_channels;
+
+    uint32_t output_features;
+};
+
+std::vector<float> reference_transpose_kernel_values(const std::vector<float>& values,
+                                                     uint32_t width,
+                                                     uint32_t height,
+                                                     uint32_t input_channels,
+                                                     uint32_t output_features)
+{
+    std::vector<float> transposed_values(values.size());
+    for(uint32_t y = 0; y < height; y++)
+    {
+        for(uint32_t x = 0; x < width; x++)
+        {
+            for(uint32_t c = 0; c < input_channels; c++)
+            {
+                for(uint32_t f = 0; f < output_features; f++)
+                {
+                    transposed_values[((f * height + y) * width + x) * input_channels + c] = values[((y * width + x) * input_channels + c) * output_features + f];
+                }
+            }
+        }
+    }
+    return transposed_values;
+}
+
+std::vector<float> reference_transpose_deconv_kernel_values(const std::vector<float>& values,
+                                                            uint32_t width,
+                                                            uint32_t height,
+                                                            uint32_t input_channels,
+                                                            uint32_t output_features)
+{
+    std::vector<float> transposed_values(values.size());
+    for(uint32_t y = 0; y < height; y++)
+    {
+        for(uint32_t x = 0; x < width; x++)
+        {
+            for(uint32_t c = 0; c < input_channels; c++)
+            {
+                for(uint32_t f = 0; f < output_features; f++)
+                {
+                    transposed_values[((c * height + y) * width + x) * output_features + f] = values[((y * width + x) * input_channels + c) * output_features + f];
+                }
+            }
+        }
+    }
+    return transposed_values;
+}
+
+using TransposeFunction = std::function<std::vector<float>(const std::vector<float>&, uint32_t, uint32_t, uint32_t, uint32_t)>;
+
+// Returns the best time of the iterations in milliseconds, the first run warms up the caches and the thread pool.
+double measure(const TransposeFunction& function, const std::vector<float>& values, const KernelSize& size, std::vector<float>& result)
+{
+    const uint32_t iterations = 10;
+    result = function(values, size.width, size.height, size.input_channels, size.output_features);
+    double best_time = 0.0;
+    for(uint32_t i = 0; i < iterations; i++)
+    {
+        auto start = std::chrono::steady_clock::now();
+        result = function(values, size.width, size.height, size.input_channels, size.output_features);
+        double time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        best_time = i == 0 ? time : std::min(best_time, time);
+    }
+    return best_time;
+}
+
+bool compare(const char* name, const TransposeFunction& reference, const TransposeFunction& optimized, const KernelSize& size)
+{
+    std::vector<float> values(static_cast<size_t>(size.width) * size.height * size.input_channels * size.output_features);
+    std::mt19937 generator(0);
+    std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+    for(auto& value : values)
+    {
+        value = distribution(generator);
+    }
+
+    std::vector<float> reference_result;
+    std::vector<float> optimized_result;
+    double reference_time = measure(reference, values, size, reference_result);
+    double optimized_time = measure(optimized, values, size, optimized_result);
+    bool matches = reference_result == optimized_result;
+    printf("%-7s %2ux%-2u %4u -> %-4u %10.3f ms %10.3f ms %6.2fx %s\n",
+           name, size.width, size.height, size.input_channels, size.output_features,
+           reference_time, optimized_time, reference_time / optimized_time, matches ? "" : "MISMATCH");
+    return matches;
+}
+}        // namespace
+
+int main()
+{
+    // Kernels of the style transfer network, followed by the sizes of larger networks.
+    const std::vector<KernelSize> sizes = {
+        {9, 9, 3, 32},
+        {3, 3, 32, 64},
+        {3, 3, 64, 128},
+        {3, 3, 128, 128},
+        {3, 3, 256, 256},
+        {3, 3, 512, 512},
+        {1, 1, 1024, 1024}};
+
+    printf("%-7s %-17s %13s %13s %7s\n", "layout", "kernel", "scalar", "tiled", "speedup");
+    bool matches = true;
+    for(const auto& size : sizes)
+    {
+        matches &= compare("conv", reference_transpose_kernel_values, transpose_kernel_values, size);
+        matches &= compare("deconv", reference_transpose_deconv_kernel_values, transpose_deconv_kernel_values, size);
+    }
+    return matches ? 0 : 1;
+}
@@ -0,0 +1,111 @@
+/* Copyright (c) 2022, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 the "License";
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "resolution_controller.h"
+
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+
+// Frames after a decision which are not measured, they include the time to reconfigure the network.
+constexpr uint32_t SETTLE_FRAMES = 5;
+
+// Number of frames measured before the next decision.
+constexpr uint32_t MEASURED_FRAMES = 30;
+
+// The resolution is lowered when the frames are slower than the target by more than this fraction.
+constexpr float DOWNSCALE_MARGIN = 0.05f;
+
+// The resolution is raised only when the predicted frame time is faster than the target by this fraction.
+constexpr float UPSCALE_MARGIN = 0.15f;
+
+ResolutionController::ResolutionController(std::vector<VkExtent2D> resolutions, float target_frame_time) :
+    resolutions(std::move(resolutions)),
+    target_frame_time(target_frame_time)
+{
+	if (this->resolutions.empty())
+	{
+		throw std::runtime_error("No resolutions for the resolution controller.");
+	}
+}
+
+void ResolutionController::set_target_frame_time(float target_frame_time)
+{
+	this->target_frame_time = target_frame_time;
+}
+
+float ResolutionController::get_target_frame_time() const
+{
+	return target_frame_time;
+}
+
+void ResolutionController::add_inference_time(float inference_time)
+{
+	if (frames_since_decision >= SETTLE_FRAMES)
+	{
+		inference_time_sum += inference_time;
+		inference_time_count++;
+	}
+}
+
+size_t ResolutionController::update(const vkb::Stats &stats, size_t current_resolution)
+{
+	if (!stats.is_available(vkb::StatIndex::frame_times) || ++frames_since_decision < SETTLE_FRAMES + MEASURED_FRAMES)
+	{
+		return current_resolution;
+	}
+
+	// The newest samples are at the end, the buffer is filled with zeros until enough frames are measured.
+	const auto &frame_times = stats.get_data(vkb::StatIndex::frame_times);
+	size_t      count       = std::min<size_t>(frame_times.size(), MEASURED_FRAMES);
+	auto        first       = std::find_if(frame_times.end() - count, frame_times.end(), [](float time) { return time > 0.0f; });
+	if (first == frame_times.end())
+	{
+		return current_resolution;
+	}
+	float frame_time = std::accumulate(first, frame_times.end(), 0.0f) / static_cast<float>(frame_times.end() - first);
+
+	size_t next_resolution = current_resolution;
+	if (frame_time > target_frame_time * (1.0f + DOWNSCALE_MARGIN))
+	{
+		next_resolution = std::min(current_resolution + 1, resolutions.size() - 1);
+	}
+	else if (current_resolution > 0)
+	{
+		const auto &current     = resolutions[current_resolution];
+		const auto &larger      = resolutions[current_resolution - 1];
+		float       pixel_ratio = static_cast<float>(larger.width * larger.height) / static_cast<float>(current.width * current.height);
+
+		// Only the inference is assumed to scale with the number of pixels. Without measured inference times the whole frame is scaled.
+		float inference_time = inference_time_count > 0 ? inference_time_sum / inference_time_count : frame_time;
+		float predicted_time = frame_time + inference_time * (pixel_ratio - 1.0f);
+		if (predicted_time < target_frame_time * (1.0f - UPSCALE_MARGIN))
+		{
+			next_resolution = current_resolution - 1;
+		}
+	}
+
+	reset();
+	return next_resolution;
+}
+
+void ResolutionController::reset()
+{
+	frames_since_decision = 0;
+	inference_time_sum    = 0.0f;
+	inference_time_count  = 0;
+}
@@ -0,0 +1,57 @@
+/* Copyright (c) 2022, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 the "License";
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <common/vk_common.h>
+#include <stats/stats.h>
+#include <vector>
+
+// Chooses the size of the images processed by the neural network, so that the frames fit into a target frame time.
+// The frame time is measured by vkb::Stats and the inference time is reported by the sample. The size is lowered
+// as soon as the frames are too slow, but raised only when the frame time predicted for the larger size is well
+// below the target, and every change is measured for a number of frames before the next one, so it doesn't oscillate.
+class ResolutionController
+{
+public:
+	// The resolutions are ordered from the largest to the smallest, the target frame time is in seconds.
+	ResolutionController(std::vector<VkExtent2D> resolutions, float target_frame_time);
+
+	void set_target_frame_time(float target_frame_time);
+
+	float get_target_frame_time() const;
+
+	// Adds the inference time of a frame in seconds, it is used to predict the frame time of a larger resolution.
+	void add_inference_time(float inference_time);
+
+	// Returns the index of the resolution for the next frames.
+	size_t update(const vkb::Stats &stats, size_t current_resolution);
+
+	// Discards the measurements, e.g. when the resolution was changed from outside.
+	void reset();
+
+private:
+	std::vector<VkExtent2D> resolutions;
+
+	float target_frame_time;
+
+	uint32_t frames_since_decision{0};
+
+	float inference_time_sum{0.0f};
+
+	uint32_t inference_time_count{0};
+};
@@ -17,13 +17,65 @@
 
 #include <rendering/subpasses/forward_subpass.h>
 #include <rendering/postprocessing_renderpass.h>
+#include <platform/filesystem.h>
 #include <platform/platform.h>
+#include <timer.h>
 #include "acl_pipeline.h"
+#include "resolution_controller.h"
 
 #include "style_transfer_post_processing.h"
 
-constexpr uint32_t OFFSCREEN_IMAGE_WIDTH = 256;
-constexpr uint32_t OFFSCREEN_IMAGE_HEIGHT = 512;
+// Sizes of the offscreen images that can be selected in the GUI, the neural network processes images of the selected size.
+// They are ordered from the largest to the smallest, which is the order the resolution controller expects.
+const std::array<VkExtent2D, 3> OFFSCREEN_RESOLUTIONS = {{{256, 512}, {192, 384}, {128, 256}}};
+
+// Size of the tiles the network is created for in tiled mode.
+constexpr uint32_t TILE_SIZE = 256;
+
+// Maximum number of frames that can be in flight between rendering the scene and displaying the post-processed image.
+constexpr uint32_t MAX_FRAMES_IN_FLIGHT = 2;
+
+// Precisions of the neural network that can be selected in the GUI.
+const std::array<arm_compute::DataType, 3> PRECISION_DATA_TYPES = {arm_compute::DataType::F32, arm_compute::DataType::F16, arm_compute::DataType::QASYMM8};
+
+// Kernel tuning modes that can be selected in the GUI.
+const std::array<ACLPipeline::TuningMode, 3> TUNING_MODES = {ACLPipeline::TuningMode::Rapid, ACLPipeline::TuningMode::Normal, ACLPipeline::TuningMode::Exhaustive};
+
+// Maximum number of frames displayed per frame processed by the neural network.
+constexpr int MAX_INFERENCE_INTERVAL = 8;
+
+// A frame is processed earlier than the interval when more of the reprojected frame than this was disoccluded.
+constexpr float MAX_DISOCCLUDED_FRACTION = 0.05f;
+
+// A reprojected surface is disoccluded when it is farther from the processed surface than this fraction of its distance to the camera.
+constexpr float REPROJECTION_DEPTH_TOLERANCE = 0.02f;
+
+// The disocclusion counter is incremented once for each 4x4 block of pixels.
+constexpr uint32_t DISOCCLUSION_SAMPLE_SIZE = 4;
+
+// Styles that can be selected in the GUI if their models (nn_models/<style>.tflite) are in the assets.
+// The models must have the architecture of the first one, which is the style the pipeline is created with.
+const std::array<const char *, 5> STYLES = {"style_transfer", "candy", "mosaic", "rain_princess", "udnie"};
+
+// Networks of the inactive styles are released when the weights of all the resident styles exceed this size.
+constexpr size_t STYLE_MEMORY_BUDGET = 64 * 1024 * 1024;
+
+struct ReprojectionUniform
+{
+	glm::mat4 inv_view_proj;
+
+	glm::mat4 history_view_proj;
+
+	glm::mat4 history_inv_view_proj;
+
+	glm::vec4 params;
+};
+
+// Transforms world space to the clip space of the offscreen image, like the forward subpass.
+glm::mat4 get_view_proj(vkb::sg::PerspectiveCamera &camera)
+{
+	return camera.get_pre_rotation() * vkb::vulkan_style_projection(camera.get_projection()) * camera.get_view();
+}
 
 style_transfer_post_processing::style_transfer_post_processing()
 {
@@ -40,6 +92,17 @@ style_transfer_post_processing::style_transfer_post_processing()
 	add_device_extension(VK_KHR_DEDICATED_ALLOCATION_EXTENSION_NAME);
 }
 
+style_transfer_post_processing::~style_transfer_post_processing()
+{
+	// Imported OpenCL memory must be released before the hardware buffers.
+	nn_pipeline.reset();
+
+	for (auto *hardware_buffer : offscreen_hardware_buffers)
+	{
+		AHardwareBuffer_release(hardware_buffer);
+	}
+}
+
 bool style_transfer_post_processing::prepare(vkb::Platform &platform)
 {
 	if (!VulkanSample::prepare(platform))
@@ -64,23 +127,101 @@ bool style_transfer_post_processing::prepare(vkb::Platform &platform)
 	final_pipeline = std::make_unique<vkb::PostProcessingPipeline>(get_render_context(), std::move(postprocessing_vs));
 	final_pipeline->add_pass().add_subpass(vkb::ShaderSource("postprocessing/simple.frag"));
 
+	// Disoccluded pixels are counted only if the fragment shader can use atomics.
+	vkb::ShaderVariant reprojection_variant;
+	if (get_device().get_gpu().get_features().fragmentStoresAndAtomics)
+	{
+		reprojection_variant.add_define("COUNT_DISOCCLUSION");
+
+		VkImageUsageFlags counter_usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+
+		disocclusion_counter      = std::make_unique<vkb::core::Image>(get_device(), VkExtent3D{1, 1, 1}, VK_FORMAT_R32_UINT, counter_usage, VMA_MEMORY_USAGE_GPU_ONLY);
+		disocclusion_counter_view = std::make_unique<vkb::core::ImageView>(*disocclusion_counter, VK_IMAGE_VIEW_TYPE_2D);
+		disocclusion_readback     = std::make_unique<vkb::core::Buffer>(get_device(), sizeof(uint32_t), VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_GPU_TO_CPU);
+	}
+	vkb::ShaderSource reprojection_vs("postprocessing/postprocessing.vert");
+	reprojection_pipeline = std::make_unique<vkb::PostProcessingPipeline>(get_render_context(), std::move(reprojection_vs));
+	reprojection_pipeline->add_pass().add_subpass(vkb::ShaderSource("style_transfer_post_processing/reprojection.frag"), std::move(reprojection_variant));
+
 	stats->request_stats({vkb::StatIndex::frame_times});
 	gui = std::make_unique<vkb::Gui>(*this, platform.get_window(), stats.get());
 
-	VkExtent3D offscreen_image_extent{static_cast<uint32_t>(OFFSCREEN_IMAGE_WIDTH),
-									  static_cast<uint32_t>(OFFSCREEN_IMAGE_HEIGHT),
-									  1};
-	nn_pipeline = std::make_unique<ACLPipeline>(OFFSCREEN_IMAGE_WIDTH, OFFSCREEN_IMAGE_HEIGHT, 4);
+	const auto &resolution_extent = OFFSCREEN_RESOLUTIONS[resolution];
+	nn_pipeline = std::make_unique<ACLPipeline>(resolution_extent.width, resolution_extent.height, 4);
+
+	// In the pipelined mode one target is rendered while the previous ones are processed or displayed.
+	uint32_t offscreen_target_count = std::max(static_cast<uint32_t>(render_context->get_swapchain().get_images().size()), MAX_FRAMES_IN_FLIGHT + 1);
+	pipelined_frames.resize(offscreen_target_count);
+	create_offscreen_render_targets({resolution_extent.width, resolution_extent.height, 1}, offscreen_target_count);
+
+	nn_pipeline->prepare(offscreen_hardware_buffers);
 
-	for(uint32_t i = 0; i < render_context->get_swapchain().get_images().size(); i++)
+	// The other styles are loaded in the background, so that they can be switched to without waiting.
+	available_styles.push_back(STYLES[0]);
+	for (size_t i = 1; i < STYLES.size(); i++)
 	{
-		auto offscreen_render_target = create_offscreen_render_target(offscreen_image_extent);
-		offscreen_render_targets.push_back(std::move(offscreen_render_target));
+		if (vkb::fs::is_file(vkb::fs::path::get(vkb::fs::path::Type::Assets) + "nn_models/" + STYLES[i] + ".tflite"))
+		{
+			available_styles.push_back(STYLES[i]);
+		}
+	}
+	nn_pipeline->set_style_memory_budget(STYLE_MEMORY_BUDGET);
+	for (size_t i = 1; i < available_styles.size(); i++)
+	{
+		nn_pipeline->load_style(available_styles[i]);
 	}
 
+	resolution_controller = std::make_unique<ResolutionController>(std::vector<VkExtent2D>(OFFSCREEN_RESOLUTIONS.begin(), OFFSCREEN_RESOLUTIONS.end()),
+	                                                               gui_target_frame_time_ms / 1000.0f);
+
 	return true;
 }
 
+void style_transfer_post_processing::create_offscreen_render_targets(const VkExtent3D &extent, uint32_t count)
+{
+	for (uint32_t i = 0; i < count; i++)
+	{
+		auto offscreen_render_target = create_offscreen_render_target(extent);
+		offscreen_render_targets.push_back(std::move(offscreen_render_target));
+		offscreen_hardware_buffers.push_back(get_hardware_buffer_from_image(offscreen_memory_allocations.back()));
+	}
+}
+
+void style_transfer_post_processing::destroy_offscreen_render_targets()
+{
+	// The exported color images and their memory are not owned by vkb::core::Image, so they are destroyed here.
+	std::vector<VkImage> color_images;
+	for (const auto &render_target : offscreen_render_targets)
+	{
+		color_images.push_back(render_target->get_views().at(i_offscreen_color).get_image().get_handle());
+	}
+	offscreen_render_targets.clear();
+
+	for (auto color_image : color_images)
+	{
+		vkDestroyImage(device->get_handle(), color_image, nullptr);
+	}
+	for (auto *hardware_buffer : offscreen_hardware_buffers)
+	{
+		AHardwareBuffer_release(hardware_buffer);
+	}
+	for (auto memory : offscreen_memory_allocations)
+	{
+		vkFreeMemory(device->get_handle(), memory, nullptr);
+	}
+	offscreen_hardware_buffers.clear();
+	offscreen_memory_allocations.clear();
+}
+
+void style_transfer_post_processing::request_gpu_features(vkb::PhysicalDevice &gpu)
+{
+	// The reprojection counts disoccluded pixels with image atomics in the fragment shader.
+	if (gpu.get_features().fragmentStoresAndAtomics)
+	{
+		gpu.get_mutable_requested_features().fragmentStoresAndAtomics = VK_TRUE;
+	}
+}
+
 void style_transfer_post_processing::prepare_render_context()
 {
 	get_render_context().prepare(1, std::bind(&style_transfer_post_processing::create_render_target, this, std::placeholders::_1));
@@ -101,12 +242,13 @@ std::unique_ptr<vkb::RenderTarget> style_transfer_post_processing::create_offscr
 	// Memory for the attachments are allocated in a specific way to support AHardwareBuffer export.
 
 	auto &device = get_device();
-	auto depth_format = vkb::get_suitable_depth_format(device.get_gpu().get_handle());
+	// The depth is sampled by the reprojection, so it has no stencil aspect.
+	auto depth_format = vkb::get_suitable_depth_format(device.get_gpu().get_handle(), true);
 
 	vkb::core::Image depth_image{device,
 								 extent,
 								 depth_format,
-								 VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
+								 VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
 								 VMA_MEMORY_USAGE_GPU_ONLY};
 
 	VkExternalMemoryImageCreateInfo external_memory_image_create_info = {};
@@ -184,24 +326,205 @@ std::unique_ptr<vkb::RenderTarget> style_transfer_post_processing::create_offscr
 
 void style_transfer_post_processing::update(float delta_time)
 {
+	if (gui_run_postprocessing)
+	{
+		auto &frame_time = frame_time_stats[frames_in_flight];
+		frame_time.total_time += delta_time;
+		frame_time.frame_count++;
+
+		// The new resolution is applied in the next draw(), the final pass upscales the smaller offscreen image to the screen.
+		if (gui_adaptive_resolution)
+		{
+			resolution_controller->set_target_frame_time(gui_target_frame_time_ms / 1000.0f);
+			gui_resolution = static_cast<int>(resolution_controller->update(*stats, resolution));
+		}
+	}
+
 	VulkanSample::update(delta_time);
 }
 
 void style_transfer_post_processing::draw(vkb::CommandBuffer &command_buffer, vkb::RenderTarget &render_target)
 {
-	auto &offscreen_render_target = *offscreen_render_targets[render_context->get_active_frame_index()];
+	if (frames_in_flight != static_cast<uint32_t>(gui_frames_in_flight))
+	{
+		flush_pipelined_frames();
+		LOGI("Frames in flight changed from {} to {}, average frame time with post-processing: {:.2f} ms.",
+		     frames_in_flight, gui_frames_in_flight, frame_time_stats[frames_in_flight].get_average() * 1000.0f);
+		frames_in_flight = static_cast<uint32_t>(gui_frames_in_flight);
+
+		// The pipelined mode renders to all the offscreen targets, including the history one.
+		has_history = false;
+	}
+
+	if (inference_interval != gui_inference_interval)
+	{
+		inference_interval = gui_inference_interval;
+		inference_cost     = {};
+	}
+
+	if (resolution != gui_resolution)
+	{
+		// The network switches to the new size before the offscreen targets are replaced, so the current targets are kept if that fails.
+		flush_pipelined_frames();
+		has_history = false;
+		try
+		{
+			const auto &extent = OFFSCREEN_RESOLUTIONS[gui_resolution];
+			nn_pipeline->set_resolution(extent.width, extent.height);
+
+			auto offscreen_target_count = static_cast<uint32_t>(offscreen_render_targets.size());
+			destroy_offscreen_render_targets();
+			create_offscreen_render_targets({extent.width, extent.height, 1}, offscreen_target_count);
+			nn_pipeline->prepare(offscreen_hardware_buffers);
+			resolution = gui_resolution;
+		}
+		catch (const std::runtime_error &e)
+		{
+			LOGE("Cannot change the resolution: {}", e.what());
+			gui_resolution = resolution;
+		}
+		resolution_controller->reset();
+	}
+
+	if (precision != gui_precision || tiled_inference != gui_tiled_inference || gui_tune_requested)
+	{
+		// The network is created again with the new precision, the current one is kept if that fails (e.g. INT8 cannot be calibrated).
+		// Tuning also creates the network again, as the tuner has to be attached when the kernels are configured.
+		flush_pipelined_frames();
+		auto tuning_mode = gui_tune_requested ? TUNING_MODES[gui_tuning_mode] : ACLPipeline::TuningMode::Disabled;
+		gui_tune_requested = false;
+		try
+		{
+			uint32_t tile_size = gui_tiled_inference ? TILE_SIZE : 0;
+			const auto &extent    = OFFSCREEN_RESOLUTIONS[resolution];
+			auto        pipeline  = std::make_unique<ACLPipeline>(extent.width, extent.height, 4, PRECISION_DATA_TYPES[gui_precision], tuning_mode, tile_size, tile_size);
+			pipeline->prepare(offscreen_hardware_buffers);
+			pipeline->set_style_memory_budget(STYLE_MEMORY_BUDGET);
+			pipeline->set_style(available_styles[style]);
+			if (blend_factor > 0.0f)
+			{
+				pipeline->set_style_blend(available_styles[blend_style], blend_factor);
+			}
+			nn_pipeline     = std::move(pipeline);
+			precision       = gui_precision;
+			tiled_inference = gui_tiled_inference;
+		}
+		catch (const std::runtime_error &e)
+		{
+			LOGE("Cannot create the network: {}", e.what());
+			gui_precision       = precision;
+			gui_tiled_inference = tiled_inference;
+		}
+	}
+
+	// A new pipeline doesn't split the frames, so the selected mode is applied to it here as well.
+	if (nn_pipeline->is_split_execution() != gui_split_execution)
+	{
+		flush_pipelined_frames();
+		try
+		{
+			nn_pipeline->set_split_execution(gui_split_execution);
+		}
+		catch (const std::runtime_error &e)
+		{
+			LOGE("Cannot split the frames: {}", e.what());
+		}
+		gui_split_execution = nn_pipeline->is_split_execution();
+	}
+
+	if (nn_pipeline->is_skipping_unchanged_tiles() != gui_skip_unchanged_tiles)
+	{
+		flush_pipelined_frames();
+		try
+		{
+			nn_pipeline->set_skip_unchanged_tiles(gui_skip_unchanged_tiles);
+		}
+		catch (const std::runtime_error &e)
+		{
+			LOGE("Cannot skip unchanged tiles: {}", e.what());
+		}
+		gui_skip_unchanged_tiles = nn_pipeline->is_skipping_unchanged_tiles();
+	}
+
+	// The pipeline keeps running the current style until the network of the selected one is loaded.
+	if (style != gui_style)
+	{
+		nn_pipeline->set_style(available_styles[gui_style]);
+		style = gui_style;
+	}
+
+	// Moving the slider only changes the factor, so the weights are blended on the GPU without creating a network.
+	if (blend_style != gui_blend_style || blend_factor != gui_blend_factor)
+	{
+		nn_pipeline->set_style_blend(available_styles[gui_blend_style], gui_blend_factor);
+		blend_style  = gui_blend_style;
+		blend_factor = gui_blend_factor;
+	}
+
+	reproject_frame = false;
+	if (frames_in_flight == 0)
+	{
+		draw_offscreen_synchronous();
+	}
+	else
+	{
+		draw_offscreen_pipelined();
+	}
+
+	if (reproject_frame && disocclusion_counter)
+	{
+		clear_disocclusion_counter(command_buffer);
+	}
+
+	auto &views = render_target.get_views();
+
+	{
+		vkb::ImageMemoryBarrier memory_barrier{};
+		memory_barrier.old_layout      = VK_IMAGE_LAYOUT_UNDEFINED;
+		memory_barrier.new_layout      = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+		memory_barrier.src_access_mask = 0;
+		memory_barrier.dst_access_mask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+		memory_barrier.src_stage_mask  = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+		memory_barrier.dst_stage_mask  = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+
+		command_buffer.image_memory_barrier(views.at(i_swapchain), memory_barrier);
+	}
+
+	final_renderpass(command_buffer, render_target);
+
+	if (reproject_frame && disocclusion_counter)
+	{
+		read_back_disocclusion_counter(command_buffer, render_target.get_extent());
+	}
+
+	{
+		vkb::ImageMemoryBarrier memory_barrier{};
+		memory_barrier.old_layout      = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+		memory_barrier.new_layout      = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+		memory_barrier.src_access_mask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+		memory_barrier.src_stage_mask  = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+		memory_barrier.dst_stage_mask  = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+
+		command_buffer.image_memory_barrier(views.at(i_swapchain), memory_barrier);
+	}
+}
+
+void style_transfer_post_processing::render_offscreen(uint32_t offscreen_index, VkFence fence)
+{
+	auto &offscreen_render_target = *offscreen_render_targets[offscreen_index];
 	auto &offscreen_views = offscreen_render_target.get_views();
 	auto &offscreen_queue = device->get_suitable_graphics_queue();
 	auto &offscreen_command_buffer = render_context->get_active_frame().request_command_buffer(offscreen_queue);
 	offscreen_command_buffer.begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
 
 	{
+		// The image may still be sampled by the final pass of a previous frame.
 		vkb::ImageMemoryBarrier memory_barrier{};
 		memory_barrier.old_layout      = VK_IMAGE_LAYOUT_UNDEFINED;
 		memory_barrier.new_layout      = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 		memory_barrier.src_access_mask = 0;
 		memory_barrier.dst_access_mask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-		memory_barrier.src_stage_mask  = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+		memory_barrier.src_stage_mask  = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
 		memory_barrier.dst_stage_mask  = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
 
 		offscreen_command_buffer.image_memory_barrier(offscreen_views.at(i_offscreen_color), memory_barrier);
@@ -223,59 +546,216 @@ void style_transfer_post_processing::draw(vkb::CommandBuffer &command_buffer, vk
 	scene_pipeline->draw(offscreen_command_buffer, offscreen_render_target);
 	offscreen_command_buffer.end_render_pass();
 
+	{
+		// The depth may be sampled by the reprojection in this or later frames.
+		vkb::ImageMemoryBarrier memory_barrier{};
+		memory_barrier.old_layout      = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+		memory_barrier.new_layout      = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		memory_barrier.src_access_mask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+		memory_barrier.dst_access_mask = VK_ACCESS_SHADER_READ_BIT;
+		memory_barrier.src_stage_mask  = VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+		memory_barrier.dst_stage_mask  = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+
+		offscreen_command_buffer.image_memory_barrier(offscreen_views.at(i_offscreen_depth), memory_barrier);
+	}
+
 	offscreen_command_buffer.end();
-	offscreen_queue.submit(offscreen_command_buffer, VK_NULL_HANDLE);
-	offscreen_queue.wait_idle();
+	offscreen_queue.submit(offscreen_command_buffer, fence);
+}
+
+void style_transfer_post_processing::draw_offscreen_synchronous()
+{
+	// Each stage waits for the previous one: the scene is rendered, processed by the neural network and then displayed.
+	uint32_t offscreen_index = render_context->get_active_frame_index();
 
-	if(gui_run_postprocessing)
+	// The history image is kept for the next frames, so the scene is rendered to another target.
+	bool temporal = gui_run_postprocessing && inference_interval > 1;
+	if (!temporal)
 	{
-		auto offscreen_image_buffer = get_hardware_buffer_from_image(offscreen_memory_allocations[render_context->get_active_frame_index()]);
-		nn_pipeline->run(offscreen_image_buffer, offscreen_views.at(i_offscreen_color).get_image().get_extent());
+		has_history = false;
+	}
+	else if (has_history && offscreen_index == history_offscreen_index)
+	{
+		offscreen_index = (offscreen_index + 1) % static_cast<uint32_t>(offscreen_render_targets.size());
 	}
 
-	auto &views = render_target.get_views();
+	render_offscreen(offscreen_index, VK_NULL_HANDLE);
+	device->get_suitable_graphics_queue().wait_idle();
 
+	if (disocclusion_readback_pending)
 	{
-		vkb::ImageMemoryBarrier memory_barrier{};
-		memory_barrier.old_layout      = VK_IMAGE_LAYOUT_UNDEFINED;
-		memory_barrier.new_layout      = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-		memory_barrier.src_access_mask = 0;
-		memory_barrier.dst_access_mask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-		memory_barrier.src_stage_mask  = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-		memory_barrier.dst_stage_mask  = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+		// The previous frame is complete, as the queue is idle. The memory may not be host-coherent, so the copy is made visible first.
+		vmaInvalidateAllocation(device->get_memory_allocator(), disocclusion_readback->get_allocation(), 0, sizeof(uint32_t));
+		uint32_t disoccluded_samples = *reinterpret_cast<const uint32_t *>(disocclusion_readback->get_data());
+		disoccluded_fraction         = static_cast<float>(disoccluded_samples) / static_cast<float>(std::max(disocclusion_sample_count, 1u));
+		disocclusion_readback_pending = false;
+	}
 
-		command_buffer.image_memory_barrier(views.at(i_swapchain), memory_barrier);
+	if (gui_run_postprocessing)
+	{
+		// A frame is processed once per interval, or earlier when too much of the last reprojected frame was disoccluded.
+		bool refresh = !has_history || frames_since_inference + 1 >= static_cast<uint32_t>(inference_interval) ||
+		               disoccluded_fraction > MAX_DISOCCLUDED_FRACTION;
+		if (refresh)
+		{
+			auto &offscreen_image = offscreen_render_targets[offscreen_index]->get_views().at(i_offscreen_color).get_image();
+
+			vkb::Timer inference_timer;
+			inference_timer.start();
+			nn_pipeline->run(offscreen_hardware_buffers[offscreen_index], offscreen_image.get_extent());
+			auto inference_time = static_cast<float>(inference_timer.stop());
+			resolution_controller->add_inference_time(inference_time);
+
+			inference_cost.inference_time += inference_time;
+			inference_cost.inference_count++;
+
+			if (temporal)
+			{
+				history_offscreen_index = offscreen_index;
+				history_view_proj       = get_view_proj(*camera);
+				has_history             = true;
+			}
+			frames_since_inference = 0;
+			disoccluded_fraction   = 0.0f;
+		}
+		else
+		{
+			reproject_frame = true;
+			frames_since_inference++;
+		}
+		inference_cost.frame_count++;
 	}
 
-	final_renderpass(command_buffer, render_target);
+	displayed_offscreen_index = offscreen_index;
+}
 
+void style_transfer_post_processing::draw_offscreen_pipelined()
+{
+	// The scene of the current frame is rendered while the neural network processes the previous frame,
+	// and the image displayed in this frame was submitted 'frames_in_flight' frames ago.
+	uint32_t offscreen_index = next_offscreen_index;
+	next_offscreen_index     = (next_offscreen_index + 1) % static_cast<uint32_t>(offscreen_render_targets.size());
+
+	auto &frame        = pipelined_frames[offscreen_index];
+	frame.render_fence = render_context->get_active_frame().request_fence();
+	frame.processed    = false;
+	render_offscreen(offscreen_index, frame.render_fence);
+	frames_in_pipeline.push_back(offscreen_index);
+
+	// Earlier frames are handed to OpenCL in order once their scene is rendered, which is checked without blocking.
+	for (size_t i = 0; i + 1 < frames_in_pipeline.size(); i++)
 	{
-		vkb::ImageMemoryBarrier memory_barrier{};
-		memory_barrier.old_layout      = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-		memory_barrier.new_layout      = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
-		memory_barrier.src_access_mask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-		memory_barrier.src_stage_mask  = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-		memory_barrier.dst_stage_mask  = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+		auto &earlier_frame = pipelined_frames[frames_in_pipeline[i]];
+		if (earlier_frame.processed)
+		{
+			continue;
+		}
+		if (vkGetFenceStatus(device->get_handle(), earlier_frame.render_fence) != VK_SUCCESS)
+		{
+			break;
+		}
+		process_pipelined_frame(frames_in_pipeline[i]);
+	}
 
-		command_buffer.image_memory_barrier(views.at(i_swapchain), memory_barrier);
+	// The host waits only when the displayed frame is late: for its scene if it's still rendering, and for the neural network.
+	// While the pipeline is filling up, i.e. for 'frames_in_flight' frames after a flush, which already waits for the device,
+	// the oldest frame is processed at once and kept on screen. Frames are displayed in order, and none of them is read by
+	// the display while OpenCL writes it.
+	displayed_offscreen_index = frames_in_pipeline.front();
+	process_pipelined_frame(displayed_offscreen_index);
+	auto &displayed_frame = pipelined_frames[displayed_offscreen_index];
+	if (displayed_frame.has_inference)
+	{
+		displayed_frame.inference_event.wait();
+		displayed_frame.has_inference = false;
+	}
+
+	if (frames_in_pipeline.size() > frames_in_flight)
+	{
+		frames_in_pipeline.pop_front();
+	}
+}
+
+void style_transfer_post_processing::process_pipelined_frame(uint32_t offscreen_index)
+{
+	auto &frame = pipelined_frames[offscreen_index];
+	if (frame.processed)
+	{
+		return;
+	}
+
+	// The scene must be rendered before OpenCL can read the image, the fence is usually signaled already.
+	VK_CHECK(vkWaitForFences(device->get_handle(), 1, &frame.render_fence, VK_TRUE, UINT64_MAX));
+
+	if (gui_run_postprocessing)
+	{
+		auto &offscreen_image = offscreen_render_targets[offscreen_index]->get_views().at(i_offscreen_color).get_image();
+		frame.inference_event = nn_pipeline->run_async(offscreen_hardware_buffers[offscreen_index], offscreen_image.get_extent());
+		frame.has_inference   = true;
+	}
+
+	frame.processed = true;
+}
+
+void style_transfer_post_processing::flush_pipelined_frames()
+{
+	for (auto offscreen_index : frames_in_pipeline)
+	{
+		auto &frame = pipelined_frames[offscreen_index];
+		if (frame.has_inference)
+		{
+			frame.inference_event.wait();
+			frame.has_inference = false;
+		}
 	}
+	frames_in_pipeline.clear();
+	device->wait_idle();
 }
 
 void style_transfer_post_processing::final_renderpass(vkb::CommandBuffer &command_buffer, vkb::RenderTarget &render_target)
 {
-	auto &offscreen_render_target = *offscreen_render_targets[render_context->get_active_frame_index()];
+	auto &offscreen_render_target = *offscreen_render_targets[displayed_offscreen_index];
 	auto &offscreen_views = offscreen_render_target.get_views();
-	vkb::core::SampledImage sampled_image(offscreen_views[i_offscreen_color]);
 
-	glm::vec4 near_far = {camera->get_far_plane(), camera->get_near_plane(), -1.0f, -1.0f};
+	if (reproject_frame)
+	{
+		auto &history_views = offscreen_render_targets[history_offscreen_index]->get_views();
+
+		ReprojectionUniform reprojection_uniform{};
+		reprojection_uniform.inv_view_proj         = glm::inverse(get_view_proj(*camera));
+		reprojection_uniform.history_view_proj     = history_view_proj;
+		reprojection_uniform.history_inv_view_proj = glm::inverse(history_view_proj);
+		reprojection_uniform.params                = {REPROJECTION_DEPTH_TOLERANCE, 0.0f, 0.0f, 0.0f};
+
+		auto &reprojection_pass = reprojection_pipeline->get_pass(0);
+		reprojection_pass.set_uniform_data(reprojection_uniform);
+
+		auto &reprojection_subpass = reprojection_pass.get_subpass(0);
+		reprojection_subpass.bind_sampled_image("color_sampler", vkb::core::SampledImage(offscreen_views[i_offscreen_color]));
+		reprojection_subpass.bind_sampled_image("depth_sampler", vkb::core::SampledImage(offscreen_views[i_offscreen_depth]));
+		reprojection_subpass.bind_sampled_image("history_color_sampler", vkb::core::SampledImage(history_views[i_offscreen_color]));
+		reprojection_subpass.bind_sampled_image("history_depth_sampler", vkb::core::SampledImage(history_views[i_offscreen_depth]));
+		if (disocclusion_counter)
+		{
+			reprojection_subpass.bind_storage_image("disocclusion_counter", *disocclusion_counter_view);
+		}
+
+		reprojection_pipeline->draw(command_buffer, render_target);
+	}
+	else
+	{
+		vkb::core::SampledImage sampled_image(offscreen_views[i_offscreen_color]);
 
-	auto &postprocessing_pass = final_pipeline->get_pass(0);
-	postprocessing_pass.set_uniform_data(near_far);
+		glm::vec4 near_far = {camera->get_far_plane(), camera->get_near_plane(), -1.0f, -1.0f};
 
-	auto &postprocessing_subpass = postprocessing_pass.get_subpass(0);
-	postprocessing_subpass.bind_sampled_image("color_sampler", std::move(sampled_image));
+		auto &postprocessing_pass = final_pipeline->get_pass(0);
+		postprocessing_pass.set_uniform_data(near_far);
 
-	final_pipeline->draw(command_buffer, render_target);
+		auto &postprocessing_subpass = postprocessing_pass.get_subpass(0);
+		postprocessing_subpass.bind_sampled_image("color_sampler", std::move(sampled_image));
+
+		final_pipeline->draw(command_buffer, render_target);
+	}
 
 	if (gui)
 	{
@@ -285,6 +765,70 @@ void style_transfer_post_processing::final_renderpass(vkb::CommandBuffer &comman
 	command_buffer.end_render_pass();
 }
 
+void style_transfer_post_processing::clear_disocclusion_counter(vkb::CommandBuffer &command_buffer)
+{
+	{
+		vkb::ImageMemoryBarrier memory_barrier{};
+		memory_barrier.old_layout      = VK_IMAGE_LAYOUT_UNDEFINED;
+		memory_barrier.new_layout      = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		memory_barrier.src_access_mask = 0;
+		memory_barrier.dst_access_mask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		memory_barrier.src_stage_mask  = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+		memory_barrier.dst_stage_mask  = VK_PIPELINE_STAGE_TRANSFER_BIT;
+
+		command_buffer.image_memory_barrier(*disocclusion_counter_view, memory_barrier);
+	}
+
+	VkClearColorValue       clear_value{};
+	VkImageSubresourceRange subresource_range = disocclusion_counter_view->get_subresource_range();
+	vkCmdClearColorImage(command_buffer.get_handle(), disocclusion_counter->get_handle(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &clear_value, 1, &subresource_range);
+
+	{
+		vkb::ImageMemoryBarrier memory_barrier{};
+		memory_barrier.old_layout      = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		memory_barrier.new_layout      = VK_IMAGE_LAYOUT_GENERAL;
+		memory_barrier.src_access_mask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		memory_barrier.dst_access_mask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+		memory_barrier.src_stage_mask  = VK_PIPELINE_STAGE_TRANSFER_BIT;
+		memory_barrier.dst_stage_mask  = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+
+		command_buffer.image_memory_barrier(*disocclusion_counter_view, memory_barrier);
+	}
+}
+
+void style_transfer_post_processing::read_back_disocclusion_counter(vkb::CommandBuffer &command_buffer, const VkExtent2D &extent)
+{
+	{
+		vkb::ImageMemoryBarrier memory_barrier{};
+		memory_barrier.old_layout      = VK_IMAGE_LAYOUT_GENERAL;
+		memory_barrier.new_layout      = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+		memory_barrier.src_access_mask = VK_ACCESS_SHADER_WRITE_BIT;
+		memory_barrier.dst_access_mask = VK_ACCESS_TRANSFER_READ_BIT;
+		memory_barrier.src_stage_mask  = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+		memory_barrier.dst_stage_mask  = VK_PIPELINE_STAGE_TRANSFER_BIT;
+
+		command_buffer.image_memory_barrier(*disocclusion_counter_view, memory_barrier);
+	}
+
+	VkBufferImageCopy copy_region{};
+	copy_region.imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+	copy_region.imageExtent      = {1, 1, 1};
+	command_buffer.copy_image_to_buffer(*disocclusion_counter, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, *disocclusion_readback, {copy_region});
+
+	{
+		vkb::BufferMemoryBarrier memory_barrier{};
+		memory_barrier.src_access_mask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		memory_barrier.dst_access_mask = VK_ACCESS_HOST_READ_BIT;
+		memory_barrier.src_stage_mask  = VK_PIPELINE_STAGE_TRANSFER_BIT;
+		memory_barrier.dst_stage_mask  = VK_PIPELINE_STAGE_HOST_BIT;
+
+		command_buffer.buffer_memory_barrier(*disocclusion_readback, 0, sizeof(uint32_t), memory_barrier);
+	}
+
+	disocclusion_sample_count     = ((extent.width + DISOCCLUSION_SAMPLE_SIZE - 1) / DISOCCLUSION_SAMPLE_SIZE) * ((extent.height + DISOCCLUSION_SAMPLE_SIZE - 1) / DISOCCLUSION_SAMPLE_SIZE);
+	disocclusion_readback_pending = true;
+}
+
 AHardwareBuffer* style_transfer_post_processing::get_hardware_buffer_from_image(VkDeviceMemory memory)
 {
 	AHardwareBuffer* hardware_buffer = nullptr;
@@ -307,8 +851,94 @@ void style_transfer_post_processing::draw_gui()
 	gui->show_options_window(
 			[this]() {
 				ImGui::Checkbox("Enable post-processing", &gui_run_postprocessing);
+				ImGui::SliderInt("Frames in flight", &gui_frames_in_flight, 0, MAX_FRAMES_IN_FLIGHT);
+
+				ImGui::Combo("Resolution", &gui_resolution, "256x512\0192x384\0128x256\0");
+				ImGui::Checkbox("Adaptive resolution", &gui_adaptive_resolution);
+				if (gui_adaptive_resolution)
+				{
+					ImGui::SameLine();
+					ImGui::SliderFloat("Target frame time (ms)", &gui_target_frame_time_ms, 8.0f, 100.0f, "%.1f");
+				}
+
+				ImGui::Combo("Precision", &gui_precision, "FP32\0FP16\0INT8\0");
+				ImGui::SameLine();
+				if (ImGui::Button("Measure PSNR"))
+				{
+					nn_pipeline->request_psnr_measurement();
+				}
+				if (nn_pipeline->get_psnr() >= 0.0f)
+				{
+					ImGui::SameLine();
+					ImGui::Text("PSNR vs FP32: %.2f dB", nn_pipeline->get_psnr());
+				}
+
+				ImGui::Combo("Tuning", &gui_tuning_mode, "Rapid\0Normal\0Exhaustive\0");
+				ImGui::SameLine();
+				if (ImGui::Button("Tune"))
+				{
+					gui_tune_requested = true;
+				}
+
+				ImGui::SliderInt("Inference interval", &gui_inference_interval, 1, MAX_INFERENCE_INTERVAL);
+				if (inference_cost.frame_count > 0)
+				{
+					// Inference time per displayed frame, including the frames processed early because of disocclusion.
+					ImGui::SameLine();
+					ImGui::Text("NN per frame: %.2f ms (%.0f%% of frames)",
+					            inference_cost.inference_time * 1000.0f / inference_cost.frame_count,
+					            100.0f * inference_cost.inference_count / inference_cost.frame_count);
+				}
+
+				ImGui::Checkbox("Tiled inference", &gui_tiled_inference);
+				ImGui::SameLine();
+				ImGui::Checkbox("Split between GPU and CPU", &gui_split_execution);
+				if (nn_pipeline->is_split_execution())
+				{
+					ImGui::SameLine();
+					ImGui::Text("GPU rows: %.0f%%", nn_pipeline->get_gpu_split_ratio() * 100.0f);
+				}
+
+				ImGui::Checkbox("Skip unchanged tiles", &gui_skip_unchanged_tiles);
+				if (nn_pipeline->is_skipping_unchanged_tiles())
+				{
+					ImGui::SameLine();
+					ImGui::Text("Skipped tiles: %.0f%%", nn_pipeline->get_skipped_tile_ratio() * 100.0f);
+				}
+
+				if (available_styles.size() > 1)
+				{
+					ImGui::Combo("Style", &gui_style, available_styles.data(), static_cast<int>(available_styles.size()));
+					size_t resident_styles = 0;
+					size_t resident_size   = 0;
+					for (const auto &info : nn_pipeline->get_styles())
+					{
+						resident_styles += info.loaded ? 1 : 0;
+						resident_size += info.weights_memory_size;
+					}
+					ImGui::SameLine();
+					ImGui::Text("Switch: %.2f ms, %zu styles resident (%.1f MB)", nn_pipeline->get_style_switch_milliseconds(), resident_styles,
+					            resident_size / (1024.0f * 1024.0f));
+
+					ImGui::Combo("Blend with", &gui_blend_style, available_styles.data(), static_cast<int>(available_styles.size()));
+					ImGui::SameLine();
+					ImGui::SliderFloat("Blend", &gui_blend_factor, 0.0f, 1.0f, "%.2f");
+				}
+
+				// Throughput of the current mode compared to the synchronous path (0 frames in flight).
+				float average_frame_time = frame_time_stats[frames_in_flight].get_average();
+				float synchronous_frame_time = frame_time_stats[0].get_average();
+				if (average_frame_time > 0.0f && synchronous_frame_time > 0.0f)
+				{
+					ImGui::Text("Frame time: %.2f ms (synchronous: %.2f ms, speedup: %.2fx)",
+					            average_frame_time * 1000.0f, synchronous_frame_time * 1000.0f, synchronous_frame_time / average_frame_time);
+				}
+				else
+				{
+					ImGui::Text("Frame time: %.2f ms", average_frame_time * 1000.0f);
+				}
 			},
-			1);
+			available_styles.size() > 1 ? 10 : 8);
 }
 
 std::unique_ptr<vkb::VulkanSample> create_style_transfer_post_processing()
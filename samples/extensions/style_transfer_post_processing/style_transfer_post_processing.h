@@ -21,13 +21,17 @@
 #include <rendering/postprocessing_pipeline.h>
 #include <scene_graph/components/perspective_camera.h>
 #include "acl_pipeline.h"
+#include "resolution_controller.h"
+#include <array>
+#include <deque>
+#include <map>
 
 class style_transfer_post_processing : public vkb::VulkanSample
 {
 public:
     style_transfer_post_processing();
 
-	virtual ~style_transfer_post_processing() = default;
+	virtual ~style_transfer_post_processing();
 
 	virtual bool prepare(vkb::Platform &platform) override;
 
@@ -40,15 +44,44 @@ public:
 private:
 	virtual void prepare_render_context() override;
 
+	virtual void request_gpu_features(vkb::PhysicalDevice &gpu) override;
+
 	// Create main render target which is associated with the swapchain and is used for displaying the result.
 	std::unique_ptr<vkb::RenderTarget> create_render_target(vkb::core::Image &&swapchain_image);
 
 	// Create an offscreen target, which is used for rendering the scene and post-processing.
 	std::unique_ptr<vkb::RenderTarget> create_offscreen_render_target(const VkExtent3D& extent);
 
-	// This renderpass displays the post-processed offscreen render target.
+	// Creates the offscreen targets and exports their hardware buffers.
+	void create_offscreen_render_targets(const VkExtent3D &extent, uint32_t count);
+
+	// Destroys the offscreen targets with their memory, they must not be used by the GPU or the neural network.
+	void destroy_offscreen_render_targets();
+
+	// Records and submits the scene rendering into the given offscreen render target.
+	void render_offscreen(uint32_t offscreen_index, VkFence fence);
+
+	// Renders the scene, runs the neural network and waits for both before the final renderpass.
+	void draw_offscreen_synchronous();
+
+	// Renders the scene of the current frame while previous frames are processed by the neural network.
+	void draw_offscreen_pipelined();
+
+	// Waits for the scene of the given offscreen render target and enqueues the neural network inference.
+	void process_pipelined_frame(uint32_t offscreen_index);
+
+	// Waits for all the frames in the pipeline, it is used when the number of frames in flight changes.
+	void flush_pipelined_frames();
+
+	// This renderpass displays the post-processed offscreen render target, or reprojects the last post-processed one.
 	void final_renderpass(vkb::CommandBuffer &command_buffer, vkb::RenderTarget &render_target);
 
+	// Clears the disocclusion counter before it is incremented by the reprojection.
+	void clear_disocclusion_counter(vkb::CommandBuffer &command_buffer);
+
+	// Copies the disocclusion counter to a host visible buffer, which is read in the next frame.
+	void read_back_disocclusion_counter(vkb::CommandBuffer &command_buffer, const VkExtent2D &extent);
+
 	// Helper function to export AHardwareBuffer handle from Vulkan image memory.
 	AHardwareBuffer* get_hardware_buffer_from_image(VkDeviceMemory memory);
 
@@ -58,12 +91,60 @@ private:
 	// Memory allocations for offscreen render targets. These allocations support AHardwareBuffer export.
 	std::vector<VkDeviceMemory> offscreen_memory_allocations;
 
+	// AHardwareBuffer handles exported from offscreen memory allocations, one for each offscreen render target.
+	std::vector<AHardwareBuffer *> offscreen_hardware_buffers;
+
+	// State of an offscreen render target in the pipelined mode.
+	struct PipelinedFrame
+	{
+		// Signaled when the scene is rendered.
+		VkFence render_fence{VK_NULL_HANDLE};
+
+		// Complete when the neural network has processed the image.
+		cl::Event inference_event;
+
+		bool has_inference{false};
+
+		bool processed{false};
+	};
+
+	std::vector<PipelinedFrame> pipelined_frames;
+
+	// Offscreen render targets which are rendered but not yet displayed, from the oldest to the newest.
+	std::deque<uint32_t> frames_in_pipeline;
+
+	uint32_t next_offscreen_index{0};
+
+	// Offscreen render target that is displayed in the current frame.
+	uint32_t displayed_offscreen_index{0};
+
+	// 0 means the synchronous mode.
+	uint32_t frames_in_flight{0};
+
+	struct FrameTimeStats
+	{
+		float total_time{0.0f};
+
+		uint32_t frame_count{0};
+
+		float get_average() const
+		{
+			return frame_count > 0 ? total_time / frame_count : 0.0f;
+		}
+	};
+
+	// Frame times with post-processing enabled for each number of frames in flight.
+	std::map<uint32_t, FrameTimeStats> frame_time_stats;
+
 	// Used to render the scene to the offscreen render target.
 	std::unique_ptr<vkb::RenderPipeline> scene_pipeline{};
 
 	// Ued to display the reult onto the screen.
 	std::unique_ptr<vkb::PostProcessingPipeline> final_pipeline{};
 
+	// Used instead of the final pipeline in frames which are not processed by the neural network.
+	std::unique_ptr<vkb::PostProcessingPipeline> reprojection_pipeline{};
+
 	// Post processing using a neural network.
 	std::unique_ptr<ACLPipeline> nn_pipeline{};
 
@@ -79,6 +160,105 @@ private:
 	uint32_t i_offscreen_color{0};
 
 	bool gui_run_postprocessing{false};
+
+	int gui_frames_in_flight{0};
+
+	// Index of the offscreen image size selected in the GUI and the one currently used.
+	int gui_resolution{0};
+
+	int resolution{0};
+
+	// The resolution is chosen by the controller to keep the frame time below the target set in the GUI.
+	bool gui_adaptive_resolution{false};
+
+	float gui_target_frame_time_ms{33.3f};
+
+	std::unique_ptr<ResolutionController> resolution_controller{};
+
+	// Index of the network precision (FP32, FP16 or INT8) selected in the GUI and the one currently used.
+	int gui_precision{0};
+
+	int precision{0};
+
+	// Index of the kernel tuning mode (Rapid, Normal or Exhaustive) selected in the GUI.
+	int gui_tuning_mode{0};
+
+	// The network is created again with the kernels tuned in the next frame.
+	bool gui_tune_requested{false};
+
+	// Each frame is split between the GPU and the CPU.
+	bool gui_split_execution{false};
+
+	// The network is created for a tile and processes the image tile by tile, selected in the GUI and currently used.
+	bool gui_tiled_inference{false};
+
+	bool tiled_inference{false};
+
+	// In tiled mode, the tiles whose input didn't change since the last frame reuse their output.
+	bool gui_skip_unchanged_tiles{false};
+
+	// Styles whose models are in the assets, the first one is the style the pipeline is created with.
+	std::vector<const char *> available_styles;
+
+	// Index of the style selected in the GUI and the one requested from the pipeline.
+	int gui_style{0};
+
+	int style{0};
+
+	// Style whose weights are blended with the selected style and the blend factor, selected in the GUI and requested from the pipeline.
+	int gui_blend_style{0};
+
+	float gui_blend_factor{0.0f};
+
+	int blend_style{0};
+
+	float blend_factor{0.0f};
+
+	// Frames displayed per frame processed by the neural network in the synchronous mode, selected in the GUI and currently used.
+	// The frames in between reproject the last processed image.
+	int gui_inference_interval{1};
+
+	int inference_interval{1};
+
+	// Offscreen render target with the last processed image, it is not rendered to while it is reprojected.
+	uint32_t history_offscreen_index{0};
+
+	bool has_history{false};
+
+	// View projection matrix the history image was rendered with.
+	glm::mat4 history_view_proj{1.0f};
+
+	uint32_t frames_since_inference{0};
+
+	// The current frame is reprojected from the history image instead of processed.
+	bool reproject_frame{false};
+
+	// Counts the disoccluded pixels of the reprojected frame, null if fragment shader atomics are not supported.
+	std::unique_ptr<vkb::core::Image> disocclusion_counter{};
+
+	std::unique_ptr<vkb::core::ImageView> disocclusion_counter_view{};
+
+	std::unique_ptr<vkb::core::Buffer> disocclusion_readback{};
+
+	bool disocclusion_readback_pending{false};
+
+	// Number of pixels the counter samples in the reprojected frame.
+	uint32_t disocclusion_sample_count{0};
+
+	// Fraction of the last reprojected frame which was disoccluded.
+	float disoccluded_fraction{0.0f};
+
+	struct InferenceCost
+	{
+		float inference_time{0.0f};
+
+		uint32_t inference_count{0};
+
+		uint32_t frame_count{0};
+	};
+
+	// Inference time per displayed frame in the synchronous mode since the inference interval was changed.
+	InferenceCost inference_cost;
 };
 
 std::unique_ptr<vkb::VulkanSample> create_style_transfer_post_processing();
@@ -0,0 +1,399 @@
+/* Copyright (c) 2022, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 the "License";
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Stylizes all the PNG images in a directory (e.g. network/dataset/x) and writes the results as PNG images to another directory,
+// without a window or a Vulkan device. The stages overlap: images are decoded and encoded on thread pools, while the GPU
+// processes batches of images in two tensors that alternate, so that one batch is filled while the other one is processed.
+// Build with -DSTYLE_TRANSFER_OFFLINE_TOOL=ON. It doesn't link the sample framework, so it runs on the host (with ACL_LIBS_DIR
+// pointing to a host build of ACL) as well as on the device from adb shell.
+
+#include "../acl_utils/graph_optimizer.h"
+#include "../acl_utils/quantization_calibrator.h"
+#include "../acl_utils/tflite_parser.h"
+#include <arm_compute/core/CL/CLKernelLibrary.h>
+#include <arm_compute/runtime/CL/CLScheduler.h>
+#include <ctpl_stl.h>
+// The framework, which has the stb implementations for the sample, isn't linked into the tool.
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include <stb_image_write.h>
+#include <sys/stat.h>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <mutex>
+
+namespace
+{
+using Clock = std::chrono::steady_clock;
+
+// Images are processed as RGBA8, the network keeps the alpha channel unchanged.
+const uint32_t CHANNELS = 4;
+
+struct Options
+{
+    std::string model_path;
+
+    std::string input_directory;
+
+    std::string output_directory;
+
+    arm_compute::DataType data_type{arm_compute::DataType::F32};
+
+    uint32_t batch_size{4};
+
+    // Threads of each of the decoding and encoding pools.
+    uint32_t threads{std::max(1u, std::thread::hardware_concurrency())};
+};
+
+bool parse_options(int argc, char** argv, Options& options)
+{
+    std::vector<std::string> positional;
+    for(int i = 1; i < argc; i++)
+    {
+        std::string argument = argv[i];
+        if(argument == "--fp16")
+        {
+            options.data_type = arm_compute::DataType::F16;
+        }
+        else if(argument == "--batch" && i + 1 < argc)
+        {
+            options.batch_size = static_cast<uint32_t>(std::max(1, std::atoi(argv[++i])));
+        }
+        else if(argument == "--threads" && i + 1 < argc)
+        {
+            options.threads = static_cast<uint32_t>(std::max(1, std::atoi(argv[++i])));
+        }
+        else
+        {
+            positional.push_back(argument);
+        }
+    }
+    if(positional.size() != 3)
+    {
+        return false;
+    }
+
+    // Paths of the images are the directory followed by the file name.
+    options.model_path = positional[0];
+    options.input_directory = positional[1].back() == '/' ? positional[1] : positional[1] + "/";
+    options.output_directory = positional[2].back() == '/' ? positional[2] : positional[2] + "/";
+    return true;
+}
+
+// Images and time processed by a stage. Workers of the thread pools add their times concurrently.
+class StageStatistics
+{
+public:
+    StageStatistics(const char* name, uint32_t workers) :
+        name(name),
+        workers(workers)
+    {}
+
+    void add(uint32_t stage_images, double stage_seconds)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        images += stage_images;
+        seconds += stage_seconds;
+    }
+
+    // Throughput of the stage on its own, with all its workers busy.
+    void print()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        double milliseconds_per_image = images > 0 ? seconds * 1000.0 / images : 0.0;
+        double images_per_second = seconds > 0.0 ? images * workers / seconds : 0.0;
+        printf("%-10s %8u %12.2f %8u %12.1f\n", name, images, milliseconds_per_image, workers, images_per_second);
+    }
+
+private:
+    const char* name;
+
+    uint32_t workers;
+
+    std::mutex mutex;
+
+    uint32_t images{0};
+
+    double seconds{0.0};
+};
+
+double get_seconds(Clock::time_point start)
+{
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// Profiling times are in nanoseconds on the device timeline.
+double get_profiling_seconds(cl_ulong start, cl_ulong end)
+{
+    return end > start ? static_cast<double>(end - start) * 1e-9 : 0.0;
+}
+
+// The images are in sRGB, which is the color space the model works in, so the conversions between the rendered
+// linear image and sRGB that the parser adds for the sample are replaced by plain copies.
+void use_srgb_images(NetworkGraph& graph)
+{
+    for(auto& node : graph.get_nodes())
+    {
+        if(node.type == GraphNodeType::ColorConversion && (node.inputs[0] == graph.get_input() || node.output == graph.get_output()))
+        {
+            node.color_conversion = ColorConversionInfo();
+        }
+    }
+}
+
+struct Image
+{
+    std::string name;
+
+    // Empty if the image cannot be used.
+    std::vector<uint8_t> pixels;
+};
+
+Image decode_image(const std::string& path, uint32_t width, uint32_t height, StageStatistics& statistics)
+{
+    auto start = Clock::now();
+    Image image;
+    image.name = path.substr(path.find_last_of('/') + 1);
+
+    int image_width = 0;
+    int image_height = 0;
+    int image_channels = 0;
+    auto* pixels = stbi_load(path.c_str(), &image_width, &image_height, &image_channels, CHANNELS);
+    if(pixels == nullptr)
+    {
+        fprintf(stderr, "Cannot load image %s\n", path.c_str());
+        return image;
+    }
+    if(image_width != static_cast<int>(width) || image_height != static_cast<int>(height))
+    {
+        fprintf(stderr, "Image %s is %dx%d, expected %ux%u\n", path.c_str(), image_width, image_height, width, height);
+        stbi_image_free(pixels);
+        return image;
+    }
+    image.pixels.assign(pixels, pixels + static_cast<size_t>(width) * height * CHANNELS);
+    stbi_image_free(pixels);
+
+    statistics.add(1, get_seconds(start));
+    return image;
+}
+
+void encode_image(const std::string& path, const std::vector<uint8_t>& pixels, uint32_t width, uint32_t height, StageStatistics& statistics)
+{
+    auto start = Clock::now();
+    if(!stbi_write_png(path.c_str(), static_cast<int>(width), static_cast<int>(height), CHANNELS, pixels.data(), static_cast<int>(width * CHANNELS)))
+    {
+        fprintf(stderr, "Cannot write image %s\n", path.c_str());
+        return;
+    }
+    statistics.add(1, get_seconds(start));
+}
+
+// Tensor for a batch of images and the network processing it, with the host memory the images are uploaded from and read back to.
+struct BatchSlot
+{
+    arm_compute::CLTensor tensor;
+
+    std::unique_ptr<ACLNetwork> net;
+
+    std::vector<uint8_t> pixels;
+
+    // Names of the images in the batch, empty if the slot is not processing any batch.
+    std::vector<std::string> names;
+
+    cl::Event upload;
+
+    cl::Event readback;
+};
+}        // namespace
+
+int main(int argc, char** argv)
+{
+    Options options;
+    if(!parse_options(argc, argv, options))
+    {
+        printf("Usage: %s <model.tflite> <input directory> <output directory> [--fp16] [--batch <images>] [--threads <threads>]\n", argv[0]);
+        return 1;
+    }
+
+    auto image_paths = QuantizationCalibrator::find_images(options.input_directory);
+    if(image_paths.empty())
+    {
+        printf("No PNG images in %s\n", options.input_directory.c_str());
+        return 1;
+    }
+
+    // The network is created for the size of the first image, images of other sizes are skipped.
+    int first_width = 0;
+    int first_height = 0;
+    int first_channels = 0;
+    if(!stbi_info(image_paths[0].c_str(), &first_width, &first_height, &first_channels))
+    {
+        printf("Cannot read %s\n", image_paths[0].c_str());
+        return 1;
+    }
+    auto width = static_cast<uint32_t>(first_width);
+    auto height = static_cast<uint32_t>(first_height);
+    size_t image_size = static_cast<size_t>(width) * height * CHANNELS;
+    mkdir(options.output_directory.c_str(), 0755);
+
+    // The queue is profiled to measure the GPU stages, the networks enqueue their kernels on the queue of the scheduler.
+    auto& scheduler = arm_compute::CLScheduler::get();
+    scheduler.default_init();
+    cl::CommandQueue queue(scheduler.context(), arm_compute::CLKernelLibrary::get().get_device(), CL_QUEUE_PROFILING_ENABLE);
+    scheduler.set_queue(queue);
+
+    // Both networks share the weights, and they share the activation memory, because the queue runs them one at a time.
+    auto create_start = Clock::now();
+    ModelFile model(options.model_path);
+    arm_compute::TensorInfo batch_info(arm_compute::TensorShape(CHANNELS, width, height, options.batch_size), 1, arm_compute::DataType::QASYMM8,
+                                       arm_compute::QuantizationInfo(1.0f, 0));
+    batch_info.set_data_layout(arm_compute::DataLayout::NHWC);
+    auto graph = TFLiteParser::parse_graph(model, batch_info, options.data_type);
+    use_srgb_images(graph);
+    GraphOptimizer::optimize(graph);
+    auto weights = std::make_shared<ACLNetwork::SharedWeights>(options.data_type, ACLNetwork::Backend::CL);
+    auto activations = std::make_shared<ACLNetwork::SharedActivations>(ACLNetwork::ActivationMemoryMode::Offset, ACLNetwork::Backend::CL);
+    std::array<BatchSlot, 2> slots;
+    for(auto& slot : slots)
+    {
+        slot.tensor.allocator()->init(batch_info);
+        slot.net = graph.create_network(slot.tensor, options.data_type, ACLNetwork::ActivationMemoryMode::Offset, true, weights);
+        slot.net->set_shared_activations(activations);
+        slot.net->prepare();
+        slot.tensor.allocator()->allocate();
+        slot.pixels.resize(image_size * options.batch_size);
+    }
+    printf("Networks for batches of %u %ux%u images created in %.2f ms\n", options.batch_size, width, height, get_seconds(create_start) * 1000.0);
+
+    ctpl::thread_pool decode_pool(static_cast<int>(options.threads));
+    ctpl::thread_pool encode_pool(static_cast<int>(options.threads));
+    StageStatistics decode_statistics("decode", options.threads);
+    StageStatistics upload_statistics("upload", 1);
+    StageStatistics inference_statistics("inference", 1);
+    StageStatistics readback_statistics("readback", 1);
+    StageStatistics encode_statistics("encode", options.threads);
+
+    // Decoding runs ahead of the GPU by the images of both slots, and the encoding can fall behind by the same number of images,
+    // which keeps all the stages busy while limiting the memory of the images in flight.
+    size_t images_in_flight = slots.size() * options.batch_size + options.threads;
+    std::deque<std::future<Image>> decoded_images;
+    size_t next_image = 0;
+    auto decode_next_images = [&]()
+    {
+        while(next_image < image_paths.size() && decoded_images.size() < images_in_flight)
+        {
+            decoded_images.push_back(decode_pool.push([&, path = image_paths[next_image]](int)
+            {
+                return decode_image(path, width, height, decode_statistics);
+            }));
+            next_image++;
+        }
+    };
+
+    std::deque<std::future<void>> encoded_images;
+    uint32_t processed_images = 0;
+    auto finish_batch = [&](BatchSlot& slot)
+    {
+        if(slot.names.empty())
+        {
+            return;
+        }
+        slot.readback.wait();
+
+        // The network runs between the upload and the readback, which are enqueued right before and after it.
+        auto batch_images = static_cast<uint32_t>(slot.names.size());
+        auto upload_end = slot.upload.getProfilingInfo<CL_PROFILING_COMMAND_END>();
+        auto readback_start = slot.readback.getProfilingInfo<CL_PROFILING_COMMAND_START>();
+        upload_statistics.add(batch_images, get_profiling_seconds(slot.upload.getProfilingInfo<CL_PROFILING_COMMAND_START>(), upload_end));
+        inference_statistics.add(batch_images, get_profiling_seconds(upload_end, readback_start));
+        readback_statistics.add(batch_images, get_profiling_seconds(readback_start, slot.readback.getProfilingInfo<CL_PROFILING_COMMAND_END>()));
+
+        for(size_t i = 0; i < slot.names.size(); i++)
+        {
+            std::vector<uint8_t> pixels(slot.pixels.begin() + i * image_size, slot.pixels.begin() + (i + 1) * image_size);
+            encoded_images.push_back(encode_pool.push([&, path = options.output_directory + slot.names[i], pixels = std::move(pixels)](int)
+            {
+                encode_image(path, pixels, width, height, encode_statistics);
+            }));
+        }
+        while(encoded_images.size() > images_in_flight)
+        {
+            encoded_images.front().get();
+            encoded_images.pop_front();
+        }
+        processed_images += batch_images;
+        slot.names.clear();
+    };
+
+    auto start = Clock::now();
+    uint32_t skipped_images = 0;
+    size_t slot_index = 0;
+    decode_next_images();
+    while(!decoded_images.empty())
+    {
+        // The slot is filled again once its previous batch is read back, while the GPU processes the other slot.
+        auto& slot = slots[slot_index];
+        slot_index = (slot_index + 1) % slots.size();
+        finish_batch(slot);
+
+        while(slot.names.size() < options.batch_size && !decoded_images.empty())
+        {
+            auto image = decoded_images.front().get();
+            decoded_images.pop_front();
+            decode_next_images();
+            if(image.pixels.empty())
+            {
+                skipped_images++;
+                continue;
+            }
+            memcpy(slot.pixels.data() + slot.names.size() * image_size, image.pixels.data(), image_size);
+            slot.names.push_back(image.name);
+        }
+        if(slot.names.empty())
+        {
+            continue;
+        }
+
+        // Only the images of the batch are copied, the rest of a partial batch is processed but not read back.
+        size_t batch_bytes = slot.names.size() * image_size;
+        queue.enqueueWriteBuffer(slot.tensor.cl_buffer(), CL_FALSE, 0, batch_bytes, slot.pixels.data(), nullptr, &slot.upload);
+        slot.net->run();
+        queue.enqueueReadBuffer(slot.tensor.cl_buffer(), CL_FALSE, 0, batch_bytes, slot.pixels.data(), nullptr, &slot.readback);
+        queue.flush();
+    }
+    for(auto& slot : slots)
+    {
+        finish_batch(slot);
+    }
+    for(auto& encoded_image : encoded_images)
+    {
+        encoded_image.get();
+    }
+
+    double seconds = get_seconds(start);
+    printf("%u images stylized in %.2f s (%.1f images/s), %u skipped\n", processed_images, seconds, seconds > 0.0 ? processed_images / seconds : 0.0, skipped_images);
+    printf("%-10s %8s %12s %8s %12s\n", "stage", "images", "ms/image", "workers", "images/s");
+    for(auto* statistics : {&decode_statistics, &upload_statistics, &inference_statistics, &readback_statistics, &encode_statistics})
+    {
+        statistics->print();
+    }
+    return 0;
+}
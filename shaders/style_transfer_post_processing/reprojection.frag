@@ -0,0 +1,93 @@
+#version 450
+/* Copyright (c) 2022, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 the "License";
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+precision highp float;
+
+layout(set = 0, binding = 0) uniform ReprojectionUniform
+{
+	// Transforms the normalized device coordinates of the current frame to world space.
+	mat4 inv_view_proj;
+	// Transforms between world space and the clip space of the frame processed by the neural network.
+	mat4 history_view_proj;
+	mat4 history_inv_view_proj;
+	// x: maximum distance between the reprojected and the processed surface, relative to their distance from the camera.
+	vec4 params;
+}
+reprojection_uniform;
+
+// The current frame, which was not processed.
+layout(set = 0, binding = 1) uniform sampler2D color_sampler;
+layout(set = 0, binding = 2) uniform sampler2D depth_sampler;
+
+// The last frame processed by the neural network.
+layout(set = 0, binding = 3) uniform sampler2D history_color_sampler;
+layout(set = 0, binding = 4) uniform sampler2D history_depth_sampler;
+
+#ifdef COUNT_DISOCCLUSION
+// Counts one of every 4x4 disoccluded pixels, which keeps the atomics on a single texel low.
+layout(set = 0, binding = 5, r32ui) uniform uimage2D disocclusion_counter;
+#endif
+
+layout(location = 0) in vec2 in_uv;
+
+layout(location = 0) out vec4 o_color;
+
+vec3 get_world_position(mat4 inv_view_proj, vec2 uv, float depth)
+{
+	vec4 position = inv_view_proj * vec4(uv * 2.0 - 1.0, depth, 1.0);
+	return position.xyz / position.w;
+}
+
+void main(void)
+{
+	// Depth is fetched without filtering, as depth formats may not support linear filtering.
+	vec2  depth_size = vec2(textureSize(depth_sampler, 0));
+	ivec2 texel      = min(ivec2(in_uv * depth_size), ivec2(depth_size) - 1);
+	float depth      = texelFetch(depth_sampler, texel, 0).r;
+	vec3  position   = get_world_position(reprojection_uniform.inv_view_proj, in_uv, depth);
+
+	vec4 history_clip = reprojection_uniform.history_view_proj * vec4(position, 1.0);
+	vec2 history_uv   = history_clip.xy / history_clip.w * 0.5 + 0.5;
+
+	// The surface was not visible in the processed frame if it was outside of the view or covered by another surface.
+	bool visible = history_clip.w > 0.0 && all(greaterThanEqual(history_uv, vec2(0.0))) && all(lessThanEqual(history_uv, vec2(1.0)));
+	if (visible)
+	{
+		vec2  history_size     = vec2(textureSize(history_depth_sampler, 0));
+		ivec2 history_texel    = min(ivec2(history_uv * history_size), ivec2(history_size) - 1);
+		float history_depth    = texelFetch(history_depth_sampler, history_texel, 0).r;
+		vec3  history_position = get_world_position(reprojection_uniform.history_inv_view_proj, history_uv, history_depth);
+		visible                = distance(position, history_position) <= reprojection_uniform.params.x * history_clip.w;
+	}
+
+	if (visible)
+	{
+		o_color = texture(history_color_sampler, history_uv);
+	}
+	else
+	{
+		// Disoccluded pixels show the current frame until the next processed frame.
+		o_color = texture(color_sampler, in_uv);
+#ifdef COUNT_DISOCCLUSION
+		if (all(equal(ivec2(gl_FragCoord.xy) & 3, ivec2(0))))
+		{
+			imageAtomicAdd(disocclusion_counter, ivec2(0), 1u);
+		}
+#endif
+	}
+}
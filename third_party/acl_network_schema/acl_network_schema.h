@@ -0,0 +1,904 @@
+// automatically generated by the FlatBuffers compiler, do not modify
+
+#ifndef FLATBUFFERS_GENERATED_ACLNETWORKSCHEMA_ACLNET_H_
+#define FLATBUFFERS_GENERATED_ACLNETWORKSCHEMA_ACLNET_H_
+
+#include "flatbuffers/flatbuffers.h"
+
+namespace aclnet {
+
+struct Tensor;
+struct TensorBuilder;
+
+struct Constant;
+struct ConstantBuilder;
+
+struct ColorConversion;
+struct ColorConversionBuilder;
+
+struct Layer;
+struct LayerBuilder;
+
+struct Network;
+struct NetworkBuilder;
+
+enum DataType {
+  DataType_F32 = 0,
+  DataType_F16 = 1,
+  DataType_QASYMM8 = 2,
+  DataType_QSYMM8_PER_CHANNEL = 3,
+  DataType_S32 = 4,
+  DataType_MIN = DataType_F32,
+  DataType_MAX = DataType_S32
+};
+
+inline const DataType (&EnumValuesDataType())[5] {
+  static const DataType values[] = {
+    DataType_F32,
+    DataType_F16,
+    DataType_QASYMM8,
+    DataType_QSYMM8_PER_CHANNEL,
+    DataType_S32
+  };
+  return values;
+}
+
+inline const char * const *EnumNamesDataType() {
+  static const char * const names[6] = {
+    "F32",
+    "F16",
+    "QASYMM8",
+    "QSYMM8_PER_CHANNEL",
+    "S32",
+    nullptr
+  };
+  return names;
+}
+
+inline const char *EnumNameDataType(DataType e) {
+  if (flatbuffers::IsOutRange(e, DataType_F32, DataType_S32)) return "";
+  const size_t index = static_cast<size_t>(e);
+  return EnumNamesDataType()[index];
+}
+
+enum LayerType {
+  LayerType_ColorConversion = 0,
+  LayerType_Activation = 1,
+  LayerType_Addition = 2,
+  LayerType_Conv2D = 3,
+  LayerType_DepthwiseConv2D = 4,
+  LayerType_TransposeConv2D = 5,
+  LayerType_MIN = LayerType_ColorConversion,
+  LayerType_MAX = LayerType_TransposeConv2D
+};
+
+inline const LayerType (&EnumValuesLayerType())[6] {
+  static const LayerType values[] = {
+    LayerType_ColorConversion,
+    LayerType_Activation,
+    LayerType_Addition,
+    LayerType_Conv2D,
+    LayerType_DepthwiseConv2D,
+    LayerType_TransposeConv2D
+  };
+  return values;
+}
+
+inline const char * const *EnumNamesLayerType() {
+  static const char * const names[7] = {
+    "ColorConversion",
+    "Activation",
+    "Addition",
+    "Conv2D",
+    "DepthwiseConv2D",
+    "TransposeConv2D",
+    nullptr
+  };
+  return names;
+}
+
+inline const char *EnumNameLayerType(LayerType e) {
+  if (flatbuffers::IsOutRange(e, LayerType_ColorConversion, LayerType_TransposeConv2D)) return "";
+  const size_t index = static_cast<size_t>(e);
+  return EnumNamesLayerType()[index];
+}
+
+enum ActivationFunction {
+  ActivationFunction_IDENTITY = 0,
+  ActivationFunction_RELU = 1,
+  ActivationFunction_LINEAR = 2,
+  ActivationFunction_MIN = ActivationFunction_IDENTITY,
+  ActivationFunction_MAX = ActivationFunction_LINEAR
+};
+
+inline const ActivationFunction (&EnumValuesActivationFunction())[3] {
+  static const ActivationFunction values[] = {
+    ActivationFunction_IDENTITY,
+    ActivationFunction_RELU,
+    ActivationFunction_LINEAR
+  };
+  return values;
+}
+
+inline const char * const *EnumNamesActivationFunction() {
+  static const char * const names[4] = {
+    "IDENTITY",
+    "RELU",
+    "LINEAR",
+    nullptr
+  };
+  return names;
+}
+
+inline const char *EnumNameActivationFunction(ActivationFunction e) {
+  if (flatbuffers::IsOutRange(e, ActivationFunction_IDENTITY, ActivationFunction_LINEAR)) return "";
+  const size_t index = static_cast<size_t>(e);
+  return EnumNamesActivationFunction()[index];
+}
+
+enum ConvolutionMethod {
+  ConvolutionMethod_DEFAULT = 0,
+  ConvolutionMethod_GEMM = 1,
+  ConvolutionMethod_DIRECT = 2,
+  ConvolutionMethod_WINOGRAD = 3,
+  ConvolutionMethod_MIN = ConvolutionMethod_DEFAULT,
+  ConvolutionMethod_MAX = ConvolutionMethod_WINOGRAD
+};
+
+inline const ConvolutionMethod (&EnumValuesConvolutionMethod())[4] {
+  static const ConvolutionMethod values[] = {
+    ConvolutionMethod_DEFAULT,
+    ConvolutionMethod_GEMM,
+    ConvolutionMethod_DIRECT,
+    ConvolutionMethod_WINOGRAD
+  };
+  return values;
+}
+
+inline const char * const *EnumNamesConvolutionMethod() {
+  static const char * const names[5] = {
+    "DEFAULT",
+    "GEMM",
+    "DIRECT",
+    "WINOGRAD",
+    nullptr
+  };
+  return names;
+}
+
+inline const char *EnumNameConvolutionMethod(ConvolutionMethod e) {
+  if (flatbuffers::IsOutRange(e, ConvolutionMethod_DEFAULT, ConvolutionMethod_WINOGRAD)) return "";
+  const size_t index = static_cast<size_t>(e);
+  return EnumNamesConvolutionMethod()[index];
+}
+
+struct Tensor FLATBUFFERS_FINAL_CLASS : private flatbuffers::Table {
+  typedef TensorBuilder Builder;
+  enum FlatBuffersVTableOffset FLATBUFFERS_VTABLE_UNDERLYING_TYPE {
+    VT_SHAPE = 4,
+    VT_DATA_TYPE = 6,
+    VT_SCALE = 8,
+    VT_OFFSET = 10,
+    VT_MODEL_INDEX = 12
+  };
+  const flatbuffers::Vector<uint32_t> *shape() const {
+    return GetPointer<const flatbuffers::Vector<uint32_t> *>(VT_SHAPE);
+  }
+  aclnet::DataType data_type() const {
+    return static_cast<aclnet::DataType>(GetField<int8_t>(VT_DATA_TYPE, 0));
+  }
+  float scale() const {
+    return GetField<float>(VT_SCALE, 0.0f);
+  }
+  int32_t offset() const {
+    return GetField<int32_t>(VT_OFFSET, 0);
+  }
+  int32_t model_index() const {
+    return GetField<int32_t>(VT_MODEL_INDEX, -1);
+  }
+  bool Verify(flatbuffers::Verifier &verifier) const {
+    return VerifyTableStart(verifier) &&
+           VerifyOffset(verifier, VT_SHAPE) &&
+           verifier.VerifyVector(shape()) &&
+           VerifyField<int8_t>(verifier, VT_DATA_TYPE) &&
+           VerifyField<float>(verifier, VT_SCALE) &&
+           VerifyField<int32_t>(verifier, VT_OFFSET) &&
+           VerifyField<int32_t>(verifier, VT_MODEL_INDEX) &&
+           verifier.EndTable();
+  }
+};
+
+struct TensorBuilder {
+  typedef Tensor Table;
+  flatbuffers::FlatBufferBuilder &fbb_;
+  flatbuffers::uoffset_t start_;
+  void add_shape(flatbuffers::Offset<flatbuffers::Vector<uint32_t>> shape) {
+    fbb_.AddOffset(Tensor::VT_SHAPE, shape);
+  }
+  void add_data_type(aclnet::DataType data_type) {
+    fbb_.AddElement<int8_t>(Tensor::VT_DATA_TYPE, static_cast<int8_t>(data_type), 0);
+  }
+  void add_scale(float scale) {
+    fbb_.AddElement<float>(Tensor::VT_SCALE, scale, 0.0f);
+  }
+  void add_offset(int32_t offset) {
+    fbb_.AddElement<int32_t>(Tensor::VT_OFFSET, offset, 0);
+  }
+  void add_model_index(int32_t model_index) {
+    fbb_.AddElement<int32_t>(Tensor::VT_MODEL_INDEX, model_index, -1);
+  }
+  explicit TensorBuilder(flatbuffers::FlatBufferBuilder &_fbb)
+        : fbb_(_fbb) {
+    start_ = fbb_.StartTable();
+  }
+  TensorBuilder &operator=(const TensorBuilder &);
+  flatbuffers::Offset<Tensor> Finish() {
+    const auto end = fbb_.EndTable(start_);
+    auto o = flatbuffers::Offset<Tensor>(end);
+    return o;
+  }
+};
+
+inline flatbuffers::Offset<Tensor> CreateTensor(
+    flatbuffers::FlatBufferBuilder &_fbb,
+    flatbuffers::Offset<flatbuffers::Vector<uint32_t>> shape = 0,
+    aclnet::DataType data_type = aclnet::DataType_F32,
+    float scale = 0.0f,
+    int32_t offset = 0,
+    int32_t model_index = -1) {
+  TensorBuilder builder_(_fbb);
+  builder_.add_model_index(model_index);
+  builder_.add_offset(offset);
+  builder_.add_scale(scale);
+  builder_.add_shape(shape);
+  builder_.add_data_type(data_type);
+  return builder_.Finish();
+}
+
+inline flatbuffers::Offset<Tensor> CreateTensorDirect(
+    flatbuffers::FlatBufferBuilder &_fbb,
+    const std::vector<uint32_t> *shape = nullptr,
+    aclnet::DataType data_type = aclnet::DataType_F32,
+    float scale = 0.0f,
+    int32_t offset = 0,
+    int32_t model_index = -1) {
+  auto shape__ = shape ? _fbb.CreateVector<uint32_t>(*shape) : 0;
+  return aclnet::CreateTensor(
+      _fbb,
+      shape__,
+      data_type,
+      scale,
+      offset,
+      model_index);
+}
+
+struct Constant FLATBUFFERS_FINAL_CLASS : private flatbuffers::Table {
+  typedef ConstantBuilder Builder;
+  enum FlatBuffersVTableOffset FLATBUFFERS_VTABLE_UNDERLYING_TYPE {
+    VT_DATA_TYPE = 4,
+    VT_SCALES = 6,
+    VT_DATA = 8
+  };
+  aclnet::DataType data_type() const {
+    return static_cast<aclnet::DataType>(GetField<int8_t>(VT_DATA_TYPE, 0));
+  }
+  const flatbuffers::Vector<float> *scales() const {
+    return GetPointer<const flatbuffers::Vector<float> *>(VT_SCALES);
+  }
+  const flatbuffers::Vector<uint8_t> *data() const {
+    return GetPointer<const flatbuffers::Vector<uint8_t> *>(VT_DATA);
+  }
+  bool Verify(flatbuffers::Verifier &verifier) const {
+    return VerifyTableStart(verifier) &&
+           VerifyField<int8_t>(verifier, VT_DATA_TYPE) &&
+           VerifyOffset(verifier, VT_SCALES) &&
+           verifier.VerifyVector(scales()) &&
+           VerifyOffset(verifier, VT_DATA) &&
+           verifier.VerifyVector(data()) &&
+           verifier.EndTable();
+  }
+};
+
+struct ConstantBuilder {
+  typedef Constant Table;
+  flatbuffers::FlatBufferBuilder &fbb_;
+  flatbuffers::uoffset_t start_;
+  void add_data_type(aclnet::DataType data_type) {
+    fbb_.AddElement<int8_t>(Constant::VT_DATA_TYPE, static_cast<int8_t>(data_type), 0);
+  }
+  void add_scales(flatbuffers::Offset<flatbuffers::Vector<float>> scales) {
+    fbb_.AddOffset(Constant::VT_SCALES, scales);
+  }
+  void add_data(flatbuffers::Offset<flatbuffers::Vector<uint8_t>> data) {
+    fbb_.AddOffset(Constant::VT_DATA, data);
+  }
+  explicit ConstantBuilder(flatbuffers::FlatBufferBuilder &_fbb)
+        : fbb_(_fbb) {
+    start_ = fbb_.StartTable();
+  }
+  ConstantBuilder &operator=(const ConstantBuilder &);
+  flatbuffers::Offset<Constant> Finish() {
+    const auto end = fbb_.EndTable(start_);
+    auto o = flatbuffers::Offset<Constant>(end);
+    return o;
+  }
+};
+
+inline flatbuffers::Offset<Constant> CreateConstant(
+    flatbuffers::FlatBufferBuilder &_fbb,
+    aclnet::DataType data_type = aclnet::DataType_F32,
+    flatbuffers::Offset<flatbuffers::Vector<float>> scales = 0,
+    flatbuffers::Offset<flatbuffers::Vector<uint8_t>> data = 0) {
+  ConstantBuilder builder_(_fbb);
+  builder_.add_data(data);
+  builder_.add_scales(scales);
+  builder_.add_data_type(data_type);
+  return builder_.Finish();
+}
+
+inline flatbuffers::Offset<Constant> CreateConstantDirect(
+    flatbuffers::FlatBufferBuilder &_fbb,
+    aclnet::DataType data_type = aclnet::DataType_F32,
+    const std::vector<float> *scales = nullptr,
+    const std::vector<uint8_t> *data = nullptr) {
+  auto scales__ = scales ? _fbb.CreateVector<float>(*scales) : 0;
+  if (data) { _fbb.ForceVectorAlignment(data->size(), sizeof(uint8_t), 16); }
+  auto data__ = data ? _fbb.CreateVector<uint8_t>(*data) : 0;
+  return aclnet::CreateConstant(
+      _fbb,
+      data_type,
+      scales__,
+      data__);
+}
+
+struct ColorConversion FLATBUFFERS_FINAL_CLASS : private flatbuffers::Table {
+  typedef ColorConversionBuilder Builder;
+  enum FlatBuffersVTableOffset FLATBUFFERS_VTABLE_UNDERLYING_TYPE {
+    VT_PRE_SCALE = 4,
+    VT_PRE_BIAS = 6,
+    VT_EXPONENT = 8,
+    VT_POST_SCALE = 10,
+    VT_POST_BIAS = 12
+  };
+  float pre_scale() const {
+    return GetField<float>(VT_PRE_SCALE, 1.0f);
+  }
+  float pre_bias() const {
+    return GetField<float>(VT_PRE_BIAS, 0.0f);
+  }
+  float exponent() const {
+    return GetField<float>(VT_EXPONENT, 1.0f);
+  }
+  float post_scale() const {
+    return GetField<float>(VT_POST_SCALE, 1.0f);
+  }
+  float post_bias() const {
+    return GetField<float>(VT_POST_BIAS, 0.0f);
+  }
+  bool Verify(flatbuffers::Verifier &verifier) const {
+    return VerifyTableStart(verifier) &&
+           VerifyField<float>(verifier, VT_PRE_SCALE) &&
+           VerifyField<float>(verifier, VT_PRE_BIAS) &&
+           VerifyField<float>(verifier, VT_EXPONENT) &&
+           VerifyField<float>(verifier, VT_POST_SCALE) &&
+           VerifyField<float>(verifier, VT_POST_BIAS) &&
+           verifier.EndTable();
+  }
+};
+
+struct ColorConversionBuilder {
+  typedef ColorConversion Table;
+  flatbuffers::FlatBufferBuilder &fbb_;
+  flatbuffers::uoffset_t start_;
+  void add_pre_scale(float pre_scale) {
+    fbb_.AddElement<float>(ColorConversion::VT_PRE_SCALE, pre_scale, 1.0f);
+  }
+  void add_pre_bias(float pre_bias) {
+    fbb_.AddElement<float>(ColorConversion::VT_PRE_BIAS, pre_bias, 0.0f);
+  }
+  void add_exponent(float exponent) {
+    fbb_.AddElement<float>(ColorConversion::VT_EXPONENT, exponent, 1.0f);
+  }
+  void add_post_scale(float post_scale) {
+    fbb_.AddElement<float>(ColorConversion::VT_POST_SCALE, post_scale, 1.0f);
+  }
+  void add_post_bias(float post_bias) {
+    fbb_.AddElement<float>(ColorConversion::VT_POST_BIAS, post_bias, 0.0f);
+  }
+  explicit ColorConversionBuilder(flatbuffers::FlatBufferBuilder &_fbb)
+        : fbb_(_fbb) {
+    start_ = fbb_.StartTable();
+  }
+  ColorConversionBuilder &operator=(const ColorConversionBuilder &);
+  flatbuffers::Offset<ColorConversion> Finish() {
+    const auto end = fbb_.EndTable(start_);
+    auto o = flatbuffers::Offset<ColorConversion>(end);
+    return o;
+  }
+};
+
+inline flatbuffers::Offset<ColorConversion> CreateColorConversion(
+    flatbuffers::FlatBufferBuilder &_fbb,
+    float pre_scale = 1.0f,
+    float pre_bias = 0.0f,
+    float exponent = 1.0f,
+    float post_scale = 1.0f,
+    float post_bias = 0.0f) {
+  ColorConversionBuilder builder_(_fbb);
+  builder_.add_post_bias(post_bias);
+  builder_.add_post_scale(post_scale);
+  builder_.add_exponent(exponent);
+  builder_.add_pre_bias(pre_bias);
+  builder_.add_pre_scale(pre_scale);
+  return builder_.Finish();
+}
+
+struct Layer FLATBUFFERS_FINAL_CLASS : private flatbuffers::Table {
+  typedef LayerBuilder Builder;
+  enum FlatBuffersVTableOffset FLATBUFFERS_VTABLE_UNDERLYING_TYPE {
+    VT_TYPE = 4,
+    VT_INPUTS = 6,
+    VT_OUTPUT = 8,
+    VT_ACTIVATION = 10,
+    VT_ACTIVATION_A = 12,
+    VT_ACTIVATION_B = 14,
+    VT_KERNEL_WIDTH = 16,
+    VT_KERNEL_HEIGHT = 18,
+    VT_OUTPUT_FEATURES = 20,
+    VT_PAD_X_FRONT = 22,
+    VT_PAD_X_BACK = 24,
+    VT_PAD_Y_FRONT = 26,
+    VT_PAD_Y_BACK = 28,
+    VT_STRIDE_X = 30,
+    VT_STRIDE_Y = 32,
+    VT_DILATION_X = 34,
+    VT_DILATION_Y = 36,
+    VT_CONVOLUTION_METHOD = 38,
+    VT_KERNEL = 40,
+    VT_BIAS = 42,
+    VT_COLOR_CONVERSION = 44,
+    VT_IN_PLACE = 46
+  };
+  aclnet::LayerType type() const {
+    return static_cast<aclnet::LayerType>(GetField<int8_t>(VT_TYPE, 0));
+  }
+  const flatbuffers::Vector<uint32_t> *inputs() const {
+    return GetPointer<const flatbuffers::Vector<uint32_t> *>(VT_INPUTS);
+  }
+  uint32_t output() const {
+    return GetField<uint32_t>(VT_OUTPUT, 0);
+  }
+  aclnet::ActivationFunction activation() const {
+    return static_cast<aclnet::ActivationFunction>(GetField<int8_t>(VT_ACTIVATION, 0));
+  }
+  float activation_a() const {
+    return GetField<float>(VT_ACTIVATION_A, 0.0f);
+  }
+  float activation_b() const {
+    return GetField<float>(VT_ACTIVATION_B, 0.0f);
+  }
+  uint32_t kernel_width() const {
+    return GetField<uint32_t>(VT_KERNEL_WIDTH, 0);
+  }
+  uint32_t kernel_height() const {
+    return GetField<uint32_t>(VT_KERNEL_HEIGHT, 0);
+  }
+  uint32_t output_features() const {
+    return GetField<uint32_t>(VT_OUTPUT_FEATURES, 0);
+  }
+  uint32_t pad_x_front() const {
+    return GetField<uint32_t>(VT_PAD_X_FRONT, 0);
+  }
+  uint32_t pad_x_back() const {
+    return GetField<uint32_t>(VT_PAD_X_BACK, 0);
+  }
+  uint32_t pad_y_front() const {
+    return GetField<uint32_t>(VT_PAD_Y_FRONT, 0);
+  }
+  uint32_t pad_y_back() const {
+    return GetField<uint32_t>(VT_PAD_Y_BACK, 0);
+  }
+  uint32_t stride_x() const {
+    return GetField<uint32_t>(VT_STRIDE_X, 1);
+  }
+  uint32_t stride_y() const {
+    return GetField<uint32_t>(VT_STRIDE_Y, 1);
+  }
+  uint32_t dilation_x() const {
+    return GetField<uint32_t>(VT_DILATION_X, 1);
+  }
+  uint32_t dilation_y() const {
+    return GetField<uint32_t>(VT_DILATION_Y, 1);
+  }
+  aclnet::ConvolutionMethod convolution_method() const {
+    return static_cast<aclnet::ConvolutionMethod>(GetField<int8_t>(VT_CONVOLUTION_METHOD, 0));
+  }
+  const aclnet::Constant *kernel() const {
+    return GetPointer<const aclnet::Constant *>(VT_KERNEL);
+  }
+  const aclnet::Constant *bias() const {
+    return GetPointer<const aclnet::Constant *>(VT_BIAS);
+  }
+  const aclnet::ColorConversion *color_conversion() const {
+    return GetPointer<const aclnet::ColorConversion *>(VT_COLOR_CONVERSION);
+  }
+  bool in_place() const {
+    return GetField<uint8_t>(VT_IN_PLACE, 0) != 0;
+  }
+  bool Verify(flatbuffers::Verifier &verifier) const {
+    return VerifyTableStart(verifier) &&
+           VerifyField<int8_t>(verifier, VT_TYPE) &&
+           VerifyOffset(verifier, VT_INPUTS) &&
+           verifier.VerifyVector(inputs()) &&
+           VerifyField<uint32_t>(verifier, VT_OUTPUT) &&
+           VerifyField<int8_t>(verifier, VT_ACTIVATION) &&
+           VerifyField<float>(verifier, VT_ACTIVATION_A) &&
+           VerifyField<float>(verifier, VT_ACTIVATION_B) &&
+           VerifyField<uint32_t>(verifier, VT_KERNEL_WIDTH) &&
+           VerifyField<uint32_t>(verifier, VT_KERNEL_HEIGHT) &&
+           VerifyField<uint32_t>(verifier, VT_OUTPUT_FEATURES) &&
+           VerifyField<uint32_t>(verifier, VT_PAD_X_FRONT) &&
+           VerifyField<uint32_t>(verifier, VT_PAD_X_BACK) &&
+           VerifyField<uint32_t>(verifier, VT_PAD_Y_FRONT) &&
+           VerifyField<uint32_t>(verifier, VT_PAD_Y_BACK) &&
+           VerifyField<uint32_t>(verifier, VT_STRIDE_X) &&
+           VerifyField<uint32_t>(verifier, VT_STRIDE_Y) &&
+           VerifyField<uint32_t>(verifier, VT_DILATION_X) &&
+           VerifyField<uint32_t>(verifier, VT_DILATION_Y) &&
+           VerifyField<int8_t>(verifier, VT_CONVOLUTION_METHOD) &&
+           VerifyOffset(verifier, VT_KERNEL) &&
+           verifier.VerifyTable(kernel()) &&
+           VerifyOffset(verifier, VT_BIAS) &&
+           verifier.VerifyTable(bias()) &&
+           VerifyOffset(verifier, VT_COLOR_CONVERSION) &&
+           verifier.VerifyTable(color_conversion()) &&
+           VerifyField<uint8_t>(verifier, VT_IN_PLACE) &&
+           verifier.EndTable();
+  }
+};
+
+struct LayerBuilder {
+  typedef Layer Table;
+  flatbuffers::FlatBufferBuilder &fbb_;
+  flatbuffers::uoffset_t start_;
+  void add_type(aclnet::LayerType type) {
+    fbb_.AddElement<int8_t>(Layer::VT_TYPE, static_cast<int8_t>(type), 0);
+  }
+  void add_inputs(flatbuffers::Offset<flatbuffers::Vector<uint32_t>> inputs) {
+    fbb_.AddOffset(Layer::VT_INPUTS, inputs);
+  }
+  void add_output(uint32_t output) {
+    fbb_.AddElement<uint32_t>(Layer::VT_OUTPUT, output, 0);
+  }
+  void add_activation(aclnet::ActivationFunction activation) {
+    fbb_.AddElement<int8_t>(Layer::VT_ACTIVATION, static_cast<int8_t>(activation), 0);
+  }
+  void add_activation_a(float activation_a) {
+    fbb_.AddElement<float>(Layer::VT_ACTIVATION_A, activation_a, 0.0f);
+  }
+  void add_activation_b(float activation_b) {
+    fbb_.AddElement<float>(Layer::VT_ACTIVATION_B, activation_b, 0.0f);
+  }
+  void add_kernel_width(uint32_t kernel_width) {
+    fbb_.AddElement<uint32_t>(Layer::VT_KERNEL_WIDTH, kernel_width, 0);
+  }
+  void add_kernel_height(uint32_t kernel_height) {
+    fbb_.AddElement<uint32_t>(Layer::VT_KERNEL_HEIGHT, kernel_height, 0);
+  }
+  void add_output_features(uint32_t output_features) {
+    fbb_.AddElement<uint32_t>(Layer::VT_OUTPUT_FEATURES, output_features, 0);
+  }
+  void add_pad_x_front(uint32_t pad_x_front) {
+    fbb_.AddElement<uint32_t>(Layer::VT_PAD_X_FRONT, pad_x_front, 0);
+  }
+  void add_pad_x_back(uint32_t pad_x_back) {
+    fbb_.AddElement<uint32_t>(Layer::VT_PAD_X_BACK, pad_x_back, 0);
+  }
+  void add_pad_y_front(uint32_t pad_y_front) {
+    fbb_.AddElement<uint32_t>(Layer::VT_PAD_Y_FRONT, pad_y_front, 0);
+  }
+  void add_pad_y_back(uint32_t pad_y_back) {
+    fbb_.AddElement<uint32_t>(Layer::VT_PAD_Y_BACK, pad_y_back, 0);
+  }
+  void add_stride_x(uint32_t stride_x) {
+    fbb_.AddElement<uint32_t>(Layer::VT_STRIDE_X, stride_x, 1);
+  }
+  void add_stride_y(uint32_t stride_y) {
+    fbb_.AddElement<uint32_t>(Layer::VT_STRIDE_Y, stride_y, 1);
+  }
+  void add_dilation_x(uint32_t dilation_x) {
+    fbb_.AddElement<uint32_t>(Layer::VT_DILATION_X, dilation_x, 1);
+  }
+  void add_dilation_y(uint32_t dilation_y) {
+    fbb_.AddElement<uint32_t>(Layer::VT_DILATION_Y, dilation_y, 1);
+  }
+  void add_convolution_method(aclnet::ConvolutionMethod convolution_method) {
+    fbb_.AddElement<int8_t>(Layer::VT_CONVOLUTION_METHOD, static_cast<int8_t>(convolution_method), 0);
+  }
+  void add_kernel(flatbuffers::Offset<aclnet::Constant> kernel) {
+    fbb_.AddOffset(Layer::VT_KERNEL, kernel);
+  }
+  void add_bias(flatbuffers::Offset<aclnet::Constant> bias) {
+    fbb_.AddOffset(Layer::VT_BIAS, bias);
+  }
+  void add_color_conversion(flatbuffers::Offset<aclnet::ColorConversion> color_conversion) {
+    fbb_.AddOffset(Layer::VT_COLOR_CONVERSION, color_conversion);
+  }
+  void add_in_place(bool in_place) {
+    fbb_.AddElement<uint8_t>(Layer::VT_IN_PLACE, static_cast<uint8_t>(in_place), 0);
+  }
+  explicit LayerBuilder(flatbuffers::FlatBufferBuilder &_fbb)
+        : fbb_(_fbb) {
+    start_ = fbb_.StartTable();
+  }
+  LayerBuilder &operator=(const LayerBuilder &);
+  flatbuffers::Offset<Layer> Finish() {
+    const auto end = fbb_.EndTable(start_);
+    auto o = flatbuffers::Offset<Layer>(end);
+    return o;
+  }
+};
+
+inline flatbuffers::Offset<Layer> CreateLayer(
+    flatbuffers::FlatBufferBuilder &_fbb,
+    aclnet::LayerType type = aclnet::LayerType_ColorConversion,
+    flatbuffers::Offset<flatbuffers::Vector<uint32_t>> inputs = 0,
+    uint32_t output = 0,
+    aclnet::ActivationFunction activation = aclnet::ActivationFunction_IDENTITY,
+    float activation_a = 0.0f,
+    float activation_b = 0.0f,
+    uint32_t kernel_width = 0,
+    uint32_t kernel_height = 0,
+    uint32_t output_features = 0,
+    uint32_t pad_x_front = 0,
+    uint32_t pad_x_back = 0,
+    uint32_t pad_y_front = 0,
+    uint32_t pad_y_back = 0,
+    uint32_t stride_x = 1,
+    uint32_t stride_y = 1,
+    uint32_t dilation_x = 1,
+    uint32_t dilation_y = 1,
+    aclnet::ConvolutionMethod convolution_method = aclnet::ConvolutionMethod_DEFAULT,
+    flatbuffers::Offset<aclnet::Constant> kernel = 0,
+    flatbuffers::Offset<aclnet::Constant> bias = 0,
+    flatbuffers::Offset<aclnet::ColorConversion> color_conversion = 0,
+    bool in_place = false) {
+  LayerBuilder builder_(_fbb);
+  builder_.add_color_conversion(color_conversion);
+  builder_.add_bias(bias);
+  builder_.add_kernel(kernel);
+  builder_.add_dilation_y(dilation_y);
+  builder_.add_dilation_x(dilation_x);
+  builder_.add_stride_y(stride_y);
+  builder_.add_stride_x(stride_x);
+  builder_.add_pad_y_back(pad_y_back);
+  builder_.add_pad_y_front(pad_y_front);
+  builder_.add_pad_x_back(pad_x_back);
+  builder_.add_pad_x_front(pad_x_front);
+  builder_.add_output_features(output_features);
+  builder_.add_kernel_height(kernel_height);
+  builder_.add_kernel_width(kernel_width);
+  builder_.add_activation_b(activation_b);
+  builder_.add_activation_a(activation_a);
+  builder_.add_output(output);
+  builder_.add_inputs(inputs);
+  builder_.add_in_place(in_place);
+  builder_.add_convolution_method(convolution_method);
+  builder_.add_activation(activation);
+  builder_.add_type(type);
+  return builder_.Finish();
+}
+
+inline flatbuffers::Offset<Layer> CreateLayerDirect(
+    flatbuffers::FlatBufferBuilder &_fbb,
+    aclnet::LayerType type = aclnet::LayerType_ColorConversion,
+    const std::vector<uint32_t> *inputs = nullptr,
+    uint32_t output = 0,
+    aclnet::ActivationFunction activation = aclnet::ActivationFunction_IDENTITY,
+    float activation_a = 0.0f,
+    float activation_b = 0.0f,
+    uint32_t kernel_width = 0,
+    uint32_t kernel_height = 0,
+    uint32_t output_features = 0,
+    uint32_t pad_x_front = 0,
+    uint32_t pad_x_back = 0,
+    uint32_t pad_y_front = 0,
+    uint32_t pad_y_back = 0,
+    uint32_t stride_x = 1,
+    uint32_t stride_y = 1,
+    uint32_t dilation_x = 1,
+    uint32_t dilation_y = 1,
+    aclnet::ConvolutionMethod convolution_method = aclnet::ConvolutionMethod_DEFAULT,
+    flatbuffers::Offset<aclnet::Constant> kernel = 0,
+    flatbuffers::Offset<aclnet::Constant> bias = 0,
+    flatbuffers::Offset<aclnet::ColorConversion> color_conversion = 0,
+    bool in_place = false) {
+  auto inputs__ = inputs ? _fbb.CreateVector<uint32_t>(*inputs) : 0;
+  return aclnet::CreateLayer(
+      _fbb,
+      type,
+      inputs__,
+      output,
+      activation,
+      activation_a,
+      activation_b,
+      kernel_width,
+      kernel_height,
+      output_features,
+      pad_x_front,
+      pad_x_back,
+      pad_y_front,
+      pad_y_back,
+      stride_x,
+      stride_y,
+      dilation_x,
+      dilation_y,
+      convolution_method,
+      kernel,
+      bias,
+      color_conversion,
+      in_place);
+}
+
+struct Network FLATBUFFERS_FINAL_CLASS : private flatbuffers::Table {
+  typedef NetworkBuilder Builder;
+  enum FlatBuffersVTableOffset FLATBUFFERS_VTABLE_UNDERLYING_TYPE {
+    VT_DATA_TYPE = 4,
+    VT_SOURCE_HASH = 6,
+    VT_TENSORS = 8,
+    VT_LAYERS = 10,
+    VT_INPUT = 12,
+    VT_OUTPUT = 14
+  };
+  aclnet::DataType data_type() const {
+    return static_cast<aclnet::DataType>(GetField<int8_t>(VT_DATA_TYPE, 0));
+  }
+  uint64_t source_hash() const {
+    return GetField<uint64_t>(VT_SOURCE_HASH, 0);
+  }
+  const flatbuffers::Vector<flatbuffers::Offset<aclnet::Tensor>> *tensors() const {
+    return GetPointer<const flatbuffers::Vector<flatbuffers::Offset<aclnet::Tensor>> *>(VT_TENSORS);
+  }
+  const flatbuffers::Vector<flatbuffers::Offset<aclnet::Layer>> *layers() const {
+    return GetPointer<const flatbuffers::Vector<flatbuffers::Offset<aclnet::Layer>> *>(VT_LAYERS);
+  }
+  uint32_t input() const {
+    return GetField<uint32_t>(VT_INPUT, 0);
+  }
+  uint32_t output() const {
+    return GetField<uint32_t>(VT_OUTPUT, 0);
+  }
+  bool Verify(flatbuffers::Verifier &verifier) const {
+    return VerifyTableStart(verifier) &&
+           VerifyField<int8_t>(verifier, VT_DATA_TYPE) &&
+           VerifyField<uint64_t>(verifier, VT_SOURCE_HASH) &&
+           VerifyOffset(verifier, VT_TENSORS) &&
+           verifier.VerifyVector(tensors()) &&
+           verifier.VerifyVectorOfTables(tensors()) &&
+           VerifyOffset(verifier, VT_LAYERS) &&
+           verifier.VerifyVector(layers()) &&
+           verifier.VerifyVectorOfTables(layers()) &&
+           VerifyField<uint32_t>(verifier, VT_INPUT) &&
+           VerifyField<uint32_t>(verifier, VT_OUTPUT) &&
+           verifier.EndTable();
+  }
+};
+
+struct NetworkBuilder {
+  typedef Network Table;
+  flatbuffers::FlatBufferBuilder &fbb_;
+  flatbuffers::uoffset_t start_;
+  void add_data_type(aclnet::DataType data_type) {
+    fbb_.AddElement<int8_t>(Network::VT_DATA_TYPE, static_cast<int8_t>(data_type), 0);
+  }
+  void add_source_hash(uint64_t source_hash) {
+    fbb_.AddElement<uint64_t>(Network::VT_SOURCE_HASH, source_hash, 0);
+  }
+  void add_tensors(flatbuffers::Offset<flatbuffers::Vector<flatbuffers::Offset<aclnet::Tensor>>> tensors) {
+    fbb_.AddOffset(Network::VT_TENSORS, tensors);
+  }
+  void add_layers(flatbuffers::Offset<flatbuffers::Vector<flatbuffers::Offset<aclnet::Layer>>> layers) {
+    fbb_.AddOffset(Network::VT_LAYERS, layers);
+  }
+  void add_input(uint32_t input) {
+    fbb_.AddElement<uint32_t>(Network::VT_INPUT, input, 0);
+  }
+  void add_output(uint32_t output) {
+    fbb_.AddElement<uint32_t>(Network::VT_OUTPUT, output, 0);
+  }
+  explicit NetworkBuilder(flatbuffers::FlatBufferBuilder &_fbb)
+        : fbb_(_fbb) {
+    start_ = fbb_.StartTable();
+  }
+  NetworkBuilder &operator=(const NetworkBuilder &);
+  flatbuffers::Offset<Network> Finish() {
+    const auto end = fbb_.EndTable(start_);
+    auto o = flatbuffers::Offset<Network>(end);
+    return o;
+  }
+};
+
+inline flatbuffers::Offset<Network> CreateNetwork(
+    flatbuffers::FlatBufferBuilder &_fbb,
+    aclnet::DataType data_type = aclnet::DataType_F32,
+    uint64_t source_hash = 0,
+    flatbuffers::Offset<flatbuffers::Vector<flatbuffers::Offset<aclnet::Tensor>>> tensors = 0,
+    flatbuffers::Offset<flatbuffers::Vector<flatbuffers::Offset<aclnet::Layer>>> layers = 0,
+    uint32_t input = 0,
+    uint32_t output = 0) {
+  NetworkBuilder builder_(_fbb);
+  builder_.add_source_hash(source_hash);
+  builder_.add_output(output);
+  builder_.add_input(input);
+  builder_.add_layers(layers);
+  builder_.add_tensors(tensors);
+  builder_.add_data_type(data_type);
+  return builder_.Finish();
+}
+
+inline flatbuffers::Offset<Network> CreateNetworkDirect(
+    flatbuffers::FlatBufferBuilder &_fbb,
+    aclnet::DataType data_type = aclnet::DataType_F32,
+    uint64_t source_hash = 0,
+    const std::vector<flatbuffers::Offset<aclnet::Tensor>> *tensors = nullptr,
+    const std::vector<flatbuffers::Offset<aclnet::Layer>> *layers = nullptr,
+    uint32_t input = 0,
+    uint32_t output = 0) {
+  auto tensors__ = tensors ? _fbb.CreateVector<flatbuffers::Offset<aclnet::Tensor>>(*tensors) : 0;
+  auto layers__ = layers ? _fbb.CreateVector<flatbuffers::Offset<aclnet::Layer>>(*layers) : 0;
+  return aclnet::CreateNetwork(
+      _fbb,
+      data_type,
+      source_hash,
+      tensors__,
+      layers__,
+      input,
+      output);
+}
+
+inline const aclnet::Network *GetNetwork(const void *buf) {
+  return flatbuffers::GetRoot<aclnet::Network>(buf);
+}
+
+inline const aclnet::Network *GetSizePrefixedNetwork(const void *buf) {
+  return flatbuffers::GetSizePrefixedRoot<aclnet::Network>(buf);
+}
+
+inline const char *NetworkIdentifier() {
+  return "ACLN";
+}
+
+inline bool NetworkBufferHasIdentifier(const void *buf) {
+  return flatbuffers::BufferHasIdentifier(
+      buf, NetworkIdentifier());
+}
+
+inline bool VerifyNetworkBuffer(
+    flatbuffers::Verifier &verifier) {
+  return verifier.VerifyBuffer<aclnet::Network>(NetworkIdentifier());
+}
+
+inline bool VerifySizePrefixedNetworkBuffer(
+    flatbuffers::Verifier &verifier) {
+  return verifier.VerifySizePrefixedBuffer<aclnet::Network>(NetworkIdentifier());
+}
+
+inline const char *NetworkExtension() {
+  return "acln";
+}
+
+inline void FinishNetworkBuffer(
+    flatbuffers::FlatBufferBuilder &fbb,
+    flatbuffers::Offset<aclnet::Network> root) {
+  fbb.Finish(root, NetworkIdentifier());
+}
+
+inline void FinishSizePrefixedNetworkBuffer(
+    flatbuffers::FlatBufferBuilder &fbb,
+    flatbuffers::Offset<aclnet::Network> root) {
+  fbb.FinishSizePrefixed(root, NetworkIdentifier());
+}
+
+}  // namespace aclnet
+
+#endif  // FLATBUFFERS_GENERATED_ACLNETWORKSCHEMA_ACLNET_H_